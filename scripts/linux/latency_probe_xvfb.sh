@@ -0,0 +1,58 @@
+#!/bin/bash
+set -e
+
+# Click-to-pixels latency of a host capturing a private Xvfb display, for CI.
+# Needs bench_viewers, built with the loopback transport:
+#   xmake f --loopback_transport=y && xmake build bench_viewers
+# Usage: latency_probe_xvfb.sh [SAMPLES] [MAX_P95_MS]
+
+SAMPLES="${1:-50}"
+MAX_P95_MS="${2:-250}"
+DISPLAY_NUM="${DISPLAY_NUM:-99}"
+BENCH_VIEWERS="${BENCH_VIEWERS:-$(find build -type f -name bench_viewers | head -n 1)}"
+
+if [ -z "$BENCH_VIEWERS" ] || [ ! -x "$BENCH_VIEWERS" ]; then
+  echo "bench_viewers not found, build it or set BENCH_VIEWERS" >&2
+  exit 1
+fi
+
+Xvfb ":$DISPLAY_NUM" -screen 0 1280x720x24 -nolisten tcp &
+XVFB_PID=$!
+trap 'kill $XVFB_PID 2>/dev/null || true' EXIT
+
+for _ in $(seq 50); do
+  if [ -e "/tmp/.X11-unix/X$DISPLAY_NUM" ]; then
+    break
+  fi
+  sleep 0.1
+done
+
+# a run without samples fails too, the summary says why
+OUTPUT=$(DISPLAY=":$DISPLAY_NUM" "$BENCH_VIEWERS" --latency-probe "$SAMPLES") ||
+  true
+SUMMARY=$(echo "$OUTPUT" | grep "Latency probe done:" || true)
+if [ -z "$SUMMARY" ]; then
+  echo "No latency probe summary" >&2
+  echo "$OUTPUT" >&2
+  exit 1
+fi
+echo "$SUMMARY"
+
+# samples=48 lost=2 min=21.3ms p50=30.1ms p95=44.0ms max=61.2ms
+SAMPLE_COUNT=$(echo "$SUMMARY" | sed -E 's/.*samples=([0-9]+).*/\1/')
+LOST_COUNT=$(echo "$SUMMARY" | sed -E 's/.*lost=([0-9]+).*/\1/')
+P95_MS=$(echo "$SUMMARY" | sed -E 's/.*p95=([0-9.]+)ms.*/\1/')
+
+if [ "$SAMPLE_COUNT" -eq 0 ]; then
+  echo "No marker was ever detected" >&2
+  exit 1
+fi
+# a few lost probes are noise, many mean markers do not reach the viewer
+if [ $((LOST_COUNT * 10)) -gt "$SAMPLES" ]; then
+  echo "Lost $LOST_COUNT of $SAMPLES probes" >&2
+  exit 1
+fi
+if awk -v p95="$P95_MS" -v max="$MAX_P95_MS" 'BEGIN { exit !(p95 > max) }'; then
+  echo "p95 ${P95_MS}ms is above ${MAX_P95_MS}ms" >&2
+  exit 1
+fi
@@ -76,6 +76,7 @@ Daemon::Daemon(const std::string& name)
       running_(true)
 #endif
 {
+  random_.seed(std::random_device{}());
 }
 
 void Daemon::stop() { running_ = false; }
@@ -188,6 +189,77 @@ static int RunLoopWithSEH(Daemon::MainLoopFunc& loop) {
 }
 #endif
 
+bool Daemon::backOff(int restart_count,
+                     std::chrono::steady_clock::time_point child_start) {
+  auto now = std::chrono::steady_clock::now();
+  int64_t exit_time_ns = crossdesk::DaemonState::NowNs();
+  auto run_time = now - child_start;
+  if (run_time >= std::chrono::milliseconds(DAEMON_STABLE_RUN_MS)) {
+    consecutive_failures_ = 0;
+  }
+  consecutive_failures_++;
+
+  crash_times_.push_back(now);
+  while (now - crash_times_.front() >
+         std::chrono::milliseconds(DAEMON_CRASH_LOOP_WINDOW_MS)) {
+    crash_times_.pop_front();
+  }
+  bool crash_loop = crash_times_.size() >= DAEMON_CRASH_LOOP_COUNT;
+
+  int shift = consecutive_failures_ - 1 < 16 ? consecutive_failures_ - 1 : 16;
+  int64_t delay_ms = (int64_t)DAEMON_DEFAULT_RESTART_DELAY_MS << shift;
+  if (crash_loop || delay_ms > DAEMON_MAX_RESTART_DELAY_MS) {
+    delay_ms = DAEMON_MAX_RESTART_DELAY_MS;
+  }
+  // half fixed, half random, so hosts hit by the same bad push do not come
+  // back to the signal server in lockstep
+  std::uniform_int_distribution<int64_t> jitter(0, delay_ms / 2);
+  delay_ms = delay_ms - delay_ms / 2 + jitter(random_);
+
+  if (crash_loop) {
+    // the snapshot may be what brings the child down, start cold next time
+    state_.Clear();
+    std::cerr << "Crash loop detected (" << crash_times_.size()
+              << " crashes within " << DAEMON_CRASH_LOOP_WINDOW_MS / 1000
+              << "s), cold restart in " << delay_ms << " ms" << std::endl;
+  } else {
+    std::cerr << "Child ran for "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     run_time)
+                     .count()
+              << " ms, next attempt in " << delay_ms << " ms" << std::endl;
+  }
+
+  // stays responsive to stop() during a long backoff
+  auto deadline = now + std::chrono::milliseconds(delay_ms);
+  while (isRunning() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  if (!isRunning()) {
+    return false;
+  }
+
+  state_.SetLastHang(child_hung_, hung_subsystem_, hung_silent_ms_);
+  child_hung_ = false;
+  state_.MarkRestart(restart_count, exit_time_ns);
+  return true;
+}
+
+bool Daemon::childHung() {
+  if (!watchdog_enabled_ ||
+      !state_.FindStalled(&hung_subsystem_, &hung_silent_ms_)) {
+    return false;
+  }
+
+  // stderr may be /dev/null, the next child logs it again from the state
+  child_hung_ = true;
+  std::cerr << "Child hung in "
+            << crossdesk::DaemonState::SubsystemName(hung_subsystem_)
+            << ", no heartbeat for " << hung_silent_ms_ << " ms, killing it"
+            << std::endl;
+  return true;
+}
+
 // run with restart logic: parent monitors child process and restarts on crash
 bool Daemon::runWithRestart(MainLoopFunc loop) {
   int restart_count = 0;
@@ -197,6 +269,7 @@ bool Daemon::runWithRestart(MainLoopFunc loop) {
         << "Failed to get executable path, falling back to direct execution"
         << std::endl;
     while (isRunning()) {
+      auto child_start = std::chrono::steady_clock::now();
       try {
         loop();
         break;
@@ -204,14 +277,29 @@ bool Daemon::runWithRestart(MainLoopFunc loop) {
         restart_count++;
         std::cerr << "Exception caught, restarting... (attempt "
                   << restart_count << ")" << std::endl;
-        std::this_thread::sleep_for(
-            std::chrono::milliseconds(DAEMON_DEFAULT_RESTART_DELAY_MS));
+        backOff(restart_count, child_start);
       }
     }
     return true;
   }
 
+  // outlives every child, so a restarted one finds what the last one left
+#ifdef _WIN32
+  unsigned long pid = GetCurrentProcessId();
+#else
+  unsigned long pid = (unsigned long)getpid();
+#endif
+  if (0 != state_.Create("crossdesk-daemon-" + std::to_string(pid))) {
+    std::cerr << "Failed to create daemon state, children start cold"
+              << std::endl;
+  }
+  // a debugger holding the child at a breakpoint would look like a hang
+  const char* watchdog_env = getenv("CROSSDESK_WATCHDOG");
+  watchdog_enabled_ = !(watchdog_env && strcmp(watchdog_env, "0") == 0);
+
   while (isRunning()) {
+    auto child_start = std::chrono::steady_clock::now();
+    state_.ResetHeartbeats();
 #ifdef _WIN32
     // windows: use CreateProcess to create child process
     STARTUPINFOA si = {sizeof(si)};
@@ -237,14 +325,20 @@ bool Daemon::runWithRestart(MainLoopFunc loop) {
     if (!success) {
       std::cerr << "Failed to create child process, error: " << GetLastError()
                 << std::endl;
-      std::this_thread::sleep_for(
-          std::chrono::milliseconds(DAEMON_DEFAULT_RESTART_DELAY_MS));
       restart_count++;
+      backOff(restart_count, child_start);
       continue;
     }
 
     DWORD exit_code = 0;
-    WaitForSingleObject(pi.hProcess, INFINITE);
+    while (WaitForSingleObject(pi.hProcess, DAEMON_WATCHDOG_POLL_MS) ==
+           WAIT_TIMEOUT) {
+      if (childHung()) {
+        TerminateProcess(pi.hProcess, 3);
+        WaitForSingleObject(pi.hProcess, INFINITE);
+        break;
+      }
+    }
     GetExitCodeProcess(pi.hProcess, &exit_code);
     CloseHandle(pi.hProcess);
     CloseHandle(pi.hThread);
@@ -256,8 +350,7 @@ bool Daemon::runWithRestart(MainLoopFunc loop) {
     std::cerr << "Child process exited with code " << exit_code
               << ", restarting... (attempt " << restart_count << ")"
               << std::endl;
-    std::this_thread::sleep_for(
-        std::chrono::milliseconds(DAEMON_DEFAULT_RESTART_DELAY_MS));
+    backOff(restart_count, child_start);
 #else
     // linux: use fork + exec to create child process
     pid_t pid = fork();
@@ -266,15 +359,23 @@ bool Daemon::runWithRestart(MainLoopFunc loop) {
       _exit(1);  // exec failed
     } else if (pid > 0) {
       int status = 0;
-      pid_t waited_pid = waitpid(pid, &status, 0);
+      pid_t waited_pid = 0;
+      while ((waited_pid = waitpid(pid, &status, WNOHANG)) == 0) {
+        if (childHung()) {
+          kill(pid, SIGKILL);
+          waited_pid = waitpid(pid, &status, 0);
+          break;
+        }
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(DAEMON_WATCHDOG_POLL_MS));
+      }
 
       if (waited_pid < 0) {
         restart_count++;
         std::cerr << "waitpid failed, errno: " << errno
                   << ", restarting... (attempt " << restart_count << ")"
                   << std::endl;
-        std::this_thread::sleep_for(
-            std::chrono::milliseconds(DAEMON_DEFAULT_RESTART_DELAY_MS));
+        backOff(restart_count, child_start);
         continue;
       }
 
@@ -298,16 +399,15 @@ bool Daemon::runWithRestart(MainLoopFunc loop) {
                      "(attempt "
                   << restart_count << ")" << std::endl;
       }
-      std::this_thread::sleep_for(
-          std::chrono::milliseconds(DAEMON_DEFAULT_RESTART_DELAY_MS));
+      backOff(restart_count, child_start);
     } else {
       std::cerr << "Failed to fork child process" << std::endl;
-      std::this_thread::sleep_for(
-          std::chrono::milliseconds(DAEMON_DEFAULT_RESTART_DELAY_MS));
       restart_count++;
+      backOff(restart_count, child_start);
     }
 #endif
   }
 
+  state_.Close();
   return true;
 }
@@ -7,10 +7,21 @@
 #ifndef _DAEMON_H_
 #define _DAEMON_H_
 
+#include <chrono>
+#include <deque>
 #include <functional>
+#include <random>
 #include <string>
 
+#include "daemon_state.h"
+
 #define DAEMON_DEFAULT_RESTART_DELAY_MS 1000
+#define DAEMON_MAX_RESTART_DELAY_MS 30000
+// a child that lived this long resets the backoff
+#define DAEMON_STABLE_RUN_MS 60000
+#define DAEMON_CRASH_LOOP_COUNT 5
+#define DAEMON_CRASH_LOOP_WINDOW_MS 60000
+#define DAEMON_WATCHDOG_POLL_MS 500
 
 class Daemon {
  public:
@@ -27,6 +38,21 @@ class Daemon {
  private:
   std::string name_;
   bool runWithRestart(MainLoopFunc loop);
+  // sleeps before the next attempt, returns false once stopped meanwhile
+  bool backOff(int restart_count,
+               std::chrono::steady_clock::time_point child_start);
+  // true once a watched subsystem of the child stopped beating
+  bool childHung();
+
+  crossdesk::DaemonState state_;
+  int consecutive_failures_ = 0;
+  std::deque<std::chrono::steady_clock::time_point> crash_times_;
+  std::mt19937 random_;
+  bool watchdog_enabled_ = true;
+  bool child_hung_ = false;
+  crossdesk::DaemonState::Subsystem hung_subsystem_ =
+      crossdesk::DaemonState::Subsystem::kMainLoop;
+  int64_t hung_silent_ms_ = 0;
 
 #ifdef _WIN32
   bool running_;
@@ -13,9 +13,20 @@
 #include "config_center.h"
 #include "daemon.h"
 #include "path_manager.h"
+#include "rd_log.h"
 #include "render.h"
+#ifdef __linux__
+#include "screen_capture_helper.h"
+#endif
 
 int main(int argc, char* argv[]) {
+#ifdef __linux__
+  int helper_exit_code = 0;
+  if (crossdesk::MaybeRunScreenCaptureHelper(argc, argv, &helper_exit_code)) {
+    return helper_exit_code;
+  }
+#endif
+
   // check if running as child process
   bool is_child = false;
   for (int i = 1; i < argc; i++) {
@@ -27,8 +38,11 @@ int main(int argc, char* argv[]) {
 
   if (is_child) {
     // child process: run render directly
-    crossdesk::Render render;
-    render.Run();
+    {
+      crossdesk::Render render;
+      render.Run();
+    }
+    crossdesk::ShutdownLogger();
     return 0;
   }
 
@@ -56,11 +70,15 @@ int main(int argc, char* argv[]) {
 
     // start daemon and return result
     bool success = daemon.start(main_loop);
+    crossdesk::ShutdownLogger();
     return success ? 0 : 1;
   }
 
   // run without daemon: direct execution
-  crossdesk::Render render;
-  render.Run();
+  {
+    crossdesk::Render render;
+    render.Run();
+  }
+  crossdesk::ShutdownLogger();
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,236 @@
+#include "audio_jitter_buffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace crossdesk {
+
+AudioJitterBuffer::AudioJitterBuffer(int sample_rate, int channels)
+    : sample_rate_(sample_rate > 0 ? sample_rate : 48000),
+      channels_(channels > 0 ? channels : 1) {
+  // enough room for the largest target plus the allowed excess
+  capacity_frames_ =
+      FramesFromMs(kMaxTargetMs + kMaxExtraDelayMs + kMaxExcessMs * 2);
+  ring_.resize(capacity_frames_ * channels_, 0);
+  history_.resize(FramesFromMs(10) * channels_, 0);
+  conceal_frames_ = FramesFromMs(kConcealFadeMs);
+  conceal_pos_ = conceal_frames_;
+}
+
+AudioJitterBuffer::~AudioJitterBuffer() {}
+
+size_t AudioJitterBuffer::FramesFromMs(int ms) const {
+  return (size_t)sample_rate_ * ms / 1000;
+}
+
+int AudioJitterBuffer::MsFromFrames(size_t frames) const {
+  return (int)(frames * 1000 / sample_rate_);
+}
+
+void AudioJitterBuffer::Push(const int16_t* samples, size_t frame_count) {
+  if (!samples || frame_count == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (dtx_) {
+    // talk spurt after a dtx gap, the gap says nothing about network jitter
+    dtx_ = false;
+    has_last_arrival_ = false;
+  }
+  UpdateJitter();
+  last_packet_frames_ = frame_count;
+
+  if (frame_count > capacity_frames_) {
+    samples += (frame_count - capacity_frames_) * channels_;
+    dropped_frames_ += frame_count - capacity_frames_;
+    frame_count = capacity_frames_;
+  }
+
+  if (size_frames_ + frame_count > capacity_frames_) {
+    DropOldest(size_frames_ + frame_count - capacity_frames_);
+  }
+
+  size_t tail = (head_ + size_frames_) % capacity_frames_;
+  size_t first = std::min(frame_count, capacity_frames_ - tail);
+  memcpy(&ring_[tail * channels_], samples,
+         first * channels_ * sizeof(int16_t));
+  if (first < frame_count) {
+    memcpy(&ring_[0], samples + first * channels_,
+           (frame_count - first) * channels_ * sizeof(int16_t));
+  }
+  size_frames_ += frame_count;
+
+  size_t target_frames = FramesFromMs(target_ms_);
+  if (size_frames_ > FramesFromMs(target_ms_ + kMaxExcessMs)) {
+    // too far behind to catch up by stretching, cut straight back to target
+    DropOldest(size_frames_ - target_frames);
+  }
+
+  if (prebuffering_ && size_frames_ >= target_frames) {
+    prebuffering_ = false;
+  }
+}
+
+void AudioJitterBuffer::UpdateJitter() {
+  auto now = std::chrono::steady_clock::now();
+  if (has_last_arrival_) {
+    double interval_ms =
+        std::chrono::duration<double, std::milli>(now - last_arrival_).count();
+    double expected_ms = (double)last_packet_frames_ * 1000 / sample_rate_;
+    double deviation = std::fabs(interval_ms - expected_ms);
+    jitter_ms_ += (deviation - jitter_ms_) / 16;
+
+    int target = (int)(expected_ms + jitter_ms_ * 4);
+    jitter_target_ms_ = std::clamp(target, kMinTargetMs, kMaxTargetMs);
+    target_ms_ = jitter_target_ms_ + extra_delay_ms_;
+  }
+  last_arrival_ = now;
+  has_last_arrival_ = true;
+}
+
+void AudioJitterBuffer::DropOldest(size_t frame_count) {
+  frame_count = std::min(frame_count, size_frames_);
+  head_ = (head_ + frame_count) % capacity_frames_;
+  size_frames_ -= frame_count;
+  read_pos_ = 0;
+  dropped_frames_ += frame_count;
+}
+
+void AudioJitterBuffer::Pull(int16_t* out, size_t frame_count) {
+  if (!out || frame_count == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (prebuffering_) {
+    if (dtx_) {
+      memset(out, 0, frame_count * channels_ * sizeof(int16_t));
+    } else {
+      Conceal(out, frame_count);
+    }
+    return;
+  }
+
+  // nudge the playout rate towards the target depth, the +-2% change in
+  // pitch is not audible for speech or system sounds
+  int depth_ms = MsFromFrames(size_frames_);
+  double ratio = 1.0;
+  if (depth_ms > target_ms_ + kStretchThresholdMs) {
+    ratio += kMaxStretch;
+  } else if (depth_ms < target_ms_ - kStretchThresholdMs) {
+    ratio -= kMaxStretch;
+  }
+
+  for (size_t i = 0; i < frame_count; ++i) {
+    size_t index = (size_t)read_pos_;
+    if (index + 1 >= size_frames_) {
+      prebuffering_ = true;
+      if (dtx_) {
+        // drained the tail of a talk spurt, play plain silence
+        conceal_pos_ = conceal_frames_;
+        memset(out + i * channels_, 0,
+               (frame_count - i) * channels_ * sizeof(int16_t));
+        return;
+      }
+
+      ++underruns_;
+      conceal_pos_ = 0;
+      Conceal(out + i * channels_, frame_count - i);
+      return;
+    }
+
+    double frac = read_pos_ - index;
+    const int16_t* a = &ring_[((head_ + index) % capacity_frames_) * channels_];
+    const int16_t* b =
+        &ring_[((head_ + index + 1) % capacity_frames_) * channels_];
+    int16_t* frame = out + i * channels_;
+    for (int c = 0; c < channels_; ++c) {
+      frame[c] = (int16_t)std::lrint(a[c] + (b[c] - a[c]) * frac);
+    }
+    Remember(frame);
+
+    read_pos_ += ratio;
+    size_t consumed = (size_t)read_pos_;
+    head_ = (head_ + consumed) % capacity_frames_;
+    size_frames_ -= consumed;
+    read_pos_ -= consumed;
+  }
+}
+
+void AudioJitterBuffer::Remember(const int16_t* frame) {
+  memcpy(&history_[history_pos_ * channels_], frame,
+         channels_ * sizeof(int16_t));
+  history_pos_ = (history_pos_ + 1) % (history_.size() / channels_);
+}
+
+void AudioJitterBuffer::Conceal(int16_t* out, size_t frame_count) {
+  size_t history_frames = history_.size() / channels_;
+  for (size_t i = 0; i < frame_count; ++i) {
+    int16_t* frame = out + i * channels_;
+    if (conceal_pos_ >= conceal_frames_) {
+      memset(frame, 0, channels_ * sizeof(int16_t));
+      continue;
+    }
+
+    // replay the last played period, oldest first, with a linear fade out
+    double gain = 1.0 - (double)conceal_pos_ / conceal_frames_;
+    const int16_t* src =
+        &history_[((history_pos_ + conceal_pos_) % history_frames) * channels_];
+    for (int c = 0; c < channels_; ++c) {
+      frame[c] = (int16_t)(src[c] * gain);
+    }
+    ++conceal_pos_;
+  }
+
+  if (has_last_arrival_) {
+    concealed_frames_ += frame_count;
+  }
+}
+
+void AudioJitterBuffer::MarkDtx() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  dtx_ = true;
+}
+
+void AudioJitterBuffer::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  head_ = 0;
+  size_frames_ = 0;
+  read_pos_ = 0;
+  prebuffering_ = true;
+  dtx_ = false;
+  has_last_arrival_ = false;
+  last_packet_frames_ = 0;
+  jitter_ms_ = 0;
+  jitter_target_ms_ = kMinTargetMs;
+  extra_delay_ms_ = 0;
+  target_ms_ = kMinTargetMs;
+  std::fill(history_.begin(), history_.end(), 0);
+  history_pos_ = 0;
+  conceal_pos_ = conceal_frames_;
+  underruns_ = 0;
+  concealed_frames_ = 0;
+  dropped_frames_ = 0;
+}
+
+void AudioJitterBuffer::SetExtraDelayMs(int delay_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  extra_delay_ms_ = std::clamp(delay_ms, 0, kMaxExtraDelayMs);
+  target_ms_ = jitter_target_ms_ + extra_delay_ms_;
+}
+
+AudioJitterBuffer::Stats AudioJitterBuffer::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats;
+  stats.depth_ms = MsFromFrames(size_frames_);
+  stats.target_ms = target_ms_;
+  stats.extra_delay_ms = extra_delay_ms_;
+  stats.jitter_ms = (int)jitter_ms_;
+  stats.underruns = underruns_;
+  stats.concealed_ms = concealed_frames_ * 1000 / sample_rate_;
+  stats.dropped_ms = dropped_frames_ * 1000 / sample_rate_;
+  return stats;
+}
+}  // namespace crossdesk
@@ -0,0 +1,106 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _AUDIO_JITTER_BUFFER_H_
+#define _AUDIO_JITTER_BUFFER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace crossdesk {
+
+// Per-session playout buffer for received S16 PCM. The network thread pushes
+// packets as they arrive and the audio device callback pulls exactly what the
+// device needs. A small controller keeps the buffered depth close to a target
+// derived from the measured arrival jitter: it plays slightly faster or slower
+// (up to kMaxStretch) to converge, drops audio when far above target and
+// conceals underruns by replaying the last period with a fade out.
+class AudioJitterBuffer {
+ public:
+  struct Stats {
+    int depth_ms = 0;
+    int target_ms = 0;
+    int extra_delay_ms = 0;
+    int jitter_ms = 0;
+    uint64_t underruns = 0;
+    uint64_t concealed_ms = 0;
+    uint64_t dropped_ms = 0;
+  };
+
+ public:
+  AudioJitterBuffer(int sample_rate = 48000, int channels = 1);
+  ~AudioJitterBuffer();
+
+ public:
+  // frame_count counts sample frames, i.e. channels interleaved samples each
+  void Push(const int16_t* samples, size_t frame_count);
+  // always writes frame_count frames, with silence or concealment as needed
+  void Pull(int16_t* out, size_t frame_count);
+  // the sender stopped transmitting on purpose, running dry is not an underrun
+  void MarkDtx();
+  void Reset();
+  // added on top of the jitter target, used to hold audio back for lip sync.
+  // the depth follows through the normal playout stretching
+  void SetExtraDelayMs(int delay_ms);
+
+  Stats GetStats();
+  int Channels() const { return channels_; }
+
+ private:
+  size_t FramesFromMs(int ms) const;
+  int MsFromFrames(size_t frames) const;
+  void UpdateJitter();
+  void DropOldest(size_t frame_count);
+  void Conceal(int16_t* out, size_t frame_count);
+  void Remember(const int16_t* frame);
+
+ private:
+  static constexpr int kMinTargetMs = 40;
+  static constexpr int kMaxTargetMs = 300;
+  static constexpr int kMaxExtraDelayMs = 200;
+  static constexpr int kMaxExcessMs = 200;
+  static constexpr int kStretchThresholdMs = 20;
+  static constexpr double kMaxStretch = 0.02;
+  static constexpr int kConcealFadeMs = 20;
+
+  const int sample_rate_;
+  const int channels_;
+
+  std::mutex mutex_;
+  // ring buffer of interleaved frames
+  std::vector<int16_t> ring_;
+  size_t capacity_frames_ = 0;
+  size_t head_ = 0;
+  size_t size_frames_ = 0;
+  double read_pos_ = 0;
+  bool prebuffering_ = true;
+  bool dtx_ = false;
+
+  // arrival jitter, RFC 3550 style estimator in ms
+  // dtx gaps are not measured as jitter
+  std::chrono::steady_clock::time_point last_arrival_;
+  size_t last_packet_frames_ = 0;
+  bool has_last_arrival_ = false;
+  double jitter_ms_ = 0;
+  int jitter_target_ms_ = kMinTargetMs;
+  int extra_delay_ms_ = 0;
+  int target_ms_ = kMinTargetMs;
+
+  // last played period, replayed with a fade out on underrun
+  std::vector<int16_t> history_;
+  size_t history_pos_ = 0;
+  size_t conceal_pos_ = 0;
+  size_t conceal_frames_ = 0;
+
+  uint64_t underruns_ = 0;
+  uint64_t concealed_frames_ = 0;
+  uint64_t dropped_frames_ = 0;
+};
+}  // namespace crossdesk
+#endif
@@ -0,0 +1,152 @@
+#include "audio_mixer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_MIXER_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AUDIO_MIXER_NEON 1
+#endif
+
+namespace crossdesk {
+
+namespace {
+
+#if defined(AUDIO_MIXER_SSE2)
+// adds 8 scaled samples to acc[0..7]
+inline void Accumulate8(int32_t* acc, __m128i v, __m128i gain, bool unity) {
+  __m128i low;
+  __m128i high;
+  if (unity) {
+    __m128i sign = _mm_srai_epi16(v, 15);
+    low = _mm_unpacklo_epi16(v, sign);
+    high = _mm_unpackhi_epi16(v, sign);
+  } else {
+    // full 32 bit products from the low and high halves
+    __m128i lo16 = _mm_mullo_epi16(v, gain);
+    __m128i hi16 = _mm_mulhi_epi16(v, gain);
+    low = _mm_srai_epi32(_mm_unpacklo_epi16(lo16, hi16), 14);
+    high = _mm_srai_epi32(_mm_unpackhi_epi16(lo16, hi16), 14);
+  }
+
+  __m128i* dst = (__m128i*)acc;
+  _mm_storeu_si128(dst, _mm_add_epi32(_mm_loadu_si128(dst), low));
+  _mm_storeu_si128(dst + 1, _mm_add_epi32(_mm_loadu_si128(dst + 1), high));
+}
+#elif defined(AUDIO_MIXER_NEON)
+inline void Accumulate8(int32_t* acc, int16x8_t v, int16x4_t gain) {
+  int32x4_t low = vshrq_n_s32(vmull_s16(vget_low_s16(v), gain), 14);
+  int32x4_t high = vshrq_n_s32(vmull_s16(vget_high_s16(v), gain), 14);
+  vst1q_s32(acc, vaddq_s32(vld1q_s32(acc), low));
+  vst1q_s32(acc + 4, vaddq_s32(vld1q_s32(acc + 4), high));
+}
+#endif
+
+}  // namespace
+
+AudioMixer::AudioMixer() {}
+
+AudioMixer::~AudioMixer() {}
+
+void AudioMixer::Begin(size_t frame_count, int channels) {
+  frame_count_ = frame_count;
+  channels_ = channels > 0 ? channels : 1;
+  size_t count = frame_count_ * channels_;
+  if (acc_.size() < count) {
+    acc_.resize(count);
+  }
+  memset(acc_.data(), 0, count * sizeof(int32_t));
+}
+
+void AudioMixer::Add(const int16_t* src, int src_channels, int gain_q14) {
+  if (!src || gain_q14 <= 0) {
+    return;
+  }
+
+  gain_q14 = std::min(gain_q14, kMaxGain);
+  if (src_channels == channels_) {
+    Accumulate(acc_.data(), src, frame_count_ * channels_, gain_q14);
+  } else if (src_channels == 1 && channels_ == 2) {
+    AccumulateMonoToStereo(acc_.data(), src, frame_count_, gain_q14);
+  }
+}
+
+void AudioMixer::End(int16_t* out) {
+  Saturate(out, acc_.data(), frame_count_ * channels_);
+}
+
+void AudioMixer::Accumulate(int32_t* acc, const int16_t* src, size_t count,
+                            int gain_q14) {
+  size_t i = 0;
+#if defined(AUDIO_MIXER_SSE2)
+  bool unity = gain_q14 == kUnityGain;
+  __m128i gain = _mm_set1_epi16((int16_t)gain_q14);
+  for (; i + 8 <= count; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+    Accumulate8(acc + i, v, gain, unity);
+  }
+#elif defined(AUDIO_MIXER_NEON)
+  int16x4_t gain = vdup_n_s16((int16_t)gain_q14);
+  for (; i + 8 <= count; i += 8) {
+    Accumulate8(acc + i, vld1q_s16(src + i), gain);
+  }
+#endif
+
+  for (; i < count; ++i) {
+    acc[i] += (src[i] * gain_q14) >> 14;
+  }
+}
+
+void AudioMixer::AccumulateMonoToStereo(int32_t* acc, const int16_t* src,
+                                        size_t frame_count, int gain_q14) {
+  size_t i = 0;
+#if defined(AUDIO_MIXER_SSE2)
+  bool unity = gain_q14 == kUnityGain;
+  __m128i gain = _mm_set1_epi16((int16_t)gain_q14);
+  for (; i + 8 <= frame_count; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+    Accumulate8(acc + i * 2, _mm_unpacklo_epi16(v, v), gain, unity);
+    Accumulate8(acc + i * 2 + 8, _mm_unpackhi_epi16(v, v), gain, unity);
+  }
+#elif defined(AUDIO_MIXER_NEON)
+  int16x4_t gain = vdup_n_s16((int16_t)gain_q14);
+  for (; i + 8 <= frame_count; i += 8) {
+    int16x8x2_t v = vzipq_s16(vld1q_s16(src + i), vld1q_s16(src + i));
+    Accumulate8(acc + i * 2, v.val[0], gain);
+    Accumulate8(acc + i * 2 + 8, v.val[1], gain);
+  }
+#endif
+
+  for (; i < frame_count; ++i) {
+    int32_t value = (src[i] * gain_q14) >> 14;
+    acc[i * 2] += value;
+    acc[i * 2 + 1] += value;
+  }
+}
+
+void AudioMixer::Saturate(int16_t* dst, const int32_t* acc, size_t count) {
+  size_t i = 0;
+#if defined(AUDIO_MIXER_SSE2)
+  for (; i + 8 <= count; i += 8) {
+    __m128i low = _mm_loadu_si128((const __m128i*)(acc + i));
+    __m128i high = _mm_loadu_si128((const __m128i*)(acc + i + 4));
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(low, high));
+  }
+#elif defined(AUDIO_MIXER_NEON)
+  for (; i + 8 <= count; i += 8) {
+    int16x4_t low = vqmovn_s32(vld1q_s32(acc + i));
+    int16x4_t high = vqmovn_s32(vld1q_s32(acc + i + 4));
+    vst1q_s16(dst + i, vcombine_s16(low, high));
+  }
+#endif
+
+  for (; i < count; ++i) {
+    dst[i] = (int16_t)std::clamp(acc[i], (int32_t)INT16_MIN,
+                                 (int32_t)INT16_MAX);
+  }
+}
+}  // namespace crossdesk
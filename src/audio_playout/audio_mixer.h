@@ -0,0 +1,51 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _AUDIO_MIXER_H_
+#define _AUDIO_MIXER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace crossdesk {
+
+// Sums several S16 sources into one output period. Every source is scaled by
+// its own Q14 gain and added into 32 bit accumulators, the result is
+// saturated back to S16 once at the end so a loud session does not wrap
+// around. Mono sources are duplicated onto both channels of a stereo output.
+class AudioMixer {
+ public:
+  static constexpr int kUnityGain = 1 << 14;
+  static constexpr int kMaxGain = 2 * kUnityGain - 1;
+
+ public:
+  AudioMixer();
+  ~AudioMixer();
+
+ public:
+  // starts a period of frame_count frames of channels interleaved samples
+  void Begin(size_t frame_count, int channels);
+  // src holds frame_count frames of src_channels samples, src_channels is
+  // either 1 or the output channel count
+  void Add(const int16_t* src, int src_channels, int gain_q14);
+  void End(int16_t* out);
+
+  // acc[i] += src[i] * gain_q14 >> 14
+  static void Accumulate(int32_t* acc, const int16_t* src, size_t count,
+                         int gain_q14);
+  // acc[2i] and acc[2i + 1] += src[i] * gain_q14 >> 14
+  static void AccumulateMonoToStereo(int32_t* acc, const int16_t* src,
+                                     size_t frame_count, int gain_q14);
+  static void Saturate(int16_t* dst, const int32_t* acc, size_t count);
+
+ private:
+  std::vector<int32_t> acc_;
+  size_t frame_count_ = 0;
+  int channels_ = 1;
+};
+}  // namespace crossdesk
+#endif
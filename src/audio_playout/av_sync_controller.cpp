@@ -0,0 +1,109 @@
+#include "av_sync_controller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace crossdesk {
+
+AvSyncController::AvSyncController(int latency_budget_ms)
+    : latency_budget_ms_(latency_budget_ms > 0 ? latency_budget_ms : 0) {}
+
+AvSyncController::~AvSyncController() {}
+
+void AvSyncController::OnAudioFrame(int64_t captured_us, int64_t local_us,
+                                    int jitter_target_ms, int buffered_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  double network_ms = (local_us - captured_us) / 1000.0;
+  double transit_ms = network_ms + jitter_target_ms;
+  double heard_ms = network_ms + buffered_ms;
+  if (!has_audio_ || (local_us - last_audio_us_) / 1000 > kStaleMs) {
+    audio_transit_ms_ = transit_ms;
+    audio_heard_ms_ = heard_ms;
+  } else {
+    audio_transit_ms_ += (transit_ms - audio_transit_ms_) / 16;
+    audio_heard_ms_ += (heard_ms - audio_heard_ms_) / 16;
+  }
+  last_audio_us_ = local_us;
+  has_audio_ = true;
+
+  Update(local_us);
+}
+
+void AvSyncController::OnVideoFrame(int64_t captured_us, int64_t local_us) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  double transit_ms = (local_us - captured_us) / 1000.0;
+  if (!has_video_ || (local_us - last_video_us_) / 1000 > kStaleMs) {
+    video_transit_ms_ = transit_ms;
+  } else {
+    video_transit_ms_ += (transit_ms - video_transit_ms_) / 8;
+  }
+  last_video_us_ = local_us;
+  has_video_ = true;
+
+  Update(local_us);
+}
+
+void AvSyncController::Update(int64_t local_us) {
+  // a stream that stopped, e.g. audio in dtx or a static screen, cannot be
+  // synced against, play the other one as early as possible
+  bool audio_live =
+      has_audio_ && (local_us - last_audio_us_) / 1000 <= kStaleMs;
+  bool video_live =
+      has_video_ && (local_us - last_video_us_) / 1000 <= kStaleMs;
+  if (!audio_live || !video_live) {
+    audio_delay_ms_ = 0;
+    video_delay_ms_ = 0;
+    return;
+  }
+
+  int diff_ms = (int)std::lround(audio_transit_ms_ - video_transit_ms_);
+  int audio_delay_ms = std::clamp(-diff_ms, 0, latency_budget_ms_);
+  int video_delay_ms = std::clamp(diff_ms, 0, latency_budget_ms_);
+
+  // small changes are not worth a playout rate change or a repeated frame
+  if (std::abs(audio_delay_ms - audio_delay_ms_) > kHysteresisMs ||
+      std::abs(video_delay_ms - video_delay_ms_) > kHysteresisMs) {
+    audio_delay_ms_ = audio_delay_ms;
+    video_delay_ms_ = video_delay_ms;
+  }
+}
+
+int AvSyncController::AudioDelayMs() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return audio_delay_ms_;
+}
+
+int AvSyncController::VideoDelayMs() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return video_delay_ms_;
+}
+
+AvSyncController::Stats AvSyncController::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats;
+  stats.active = has_audio_ && has_video_;
+  if (stats.active) {
+    int diff_ms = (int)std::lround(audio_transit_ms_ - video_transit_ms_);
+    stats.raw_offset_ms = diff_ms;
+    stats.offset_ms = (int)std::lround(audio_heard_ms_ - video_transit_ms_) -
+                      video_delay_ms_;
+  }
+  stats.audio_delay_ms = audio_delay_ms_;
+  stats.video_delay_ms = video_delay_ms_;
+  return stats;
+}
+
+void AvSyncController::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  audio_transit_ms_ = 0;
+  audio_heard_ms_ = 0;
+  video_transit_ms_ = 0;
+  last_audio_us_ = 0;
+  last_video_us_ = 0;
+  has_audio_ = false;
+  has_video_ = false;
+  audio_delay_ms_ = 0;
+  video_delay_ms_ = 0;
+}
+}  // namespace crossdesk
@@ -0,0 +1,79 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _AV_SYNC_CONTROLLER_H_
+#define _AV_SYNC_CONTROLLER_H_
+
+#include <cstdint>
+#include <mutex>
+
+namespace crossdesk {
+
+// Lip sync for one remote session. Both streams are stamped by the host with
+// the same capture clock, so (local presentation time - capture time) of each
+// stream differs only by how much later one of them reaches the screen or the
+// speaker. The unknown offset between host and local clocks cancels out. The
+// stream that is ahead gets delayed by the difference, never by more than the
+// latency budget.
+class AvSyncController {
+ public:
+  struct Stats {
+    bool active = false;
+    // audio presentation minus video presentation, positive means audio
+    // lags, measured before and after the compensating delay
+    int raw_offset_ms = 0;
+    int offset_ms = 0;
+    int audio_delay_ms = 0;
+    int video_delay_ms = 0;
+  };
+
+ public:
+  explicit AvSyncController(int latency_budget_ms = 200);
+  ~AvSyncController();
+
+ public:
+  // local_us is any monotonic local clock in microseconds, the same one for
+  // both streams. jitter_target_ms is the playout delay the jitter buffer
+  // wants for itself, without the delay added here, buffered_ms is what it
+  // currently holds.
+  void OnAudioFrame(int64_t captured_us, int64_t local_us,
+                    int jitter_target_ms, int buffered_ms);
+  void OnVideoFrame(int64_t captured_us, int64_t local_us);
+
+  // extra delay to add on top of what each stream already does
+  int AudioDelayMs();
+  int VideoDelayMs();
+
+  Stats GetStats();
+  void Reset();
+
+ private:
+  void Update(int64_t local_us);
+
+ private:
+  static constexpr int kStaleMs = 2000;
+  static constexpr int kHysteresisMs = 15;
+
+  const int latency_budget_ms_;
+
+  std::mutex mutex_;
+  // smoothed transit of each stream without the delay added here, in ms.
+  // the target based audio figure drives the controller so it does not chase
+  // the buffer while it is still filling up, the depth based one is what is
+  // actually heard and feeds the reported offset
+  double audio_transit_ms_ = 0;
+  double audio_heard_ms_ = 0;
+  double video_transit_ms_ = 0;
+  int64_t last_audio_us_ = 0;
+  int64_t last_video_us_ = 0;
+  bool has_audio_ = false;
+  bool has_video_ = false;
+
+  int audio_delay_ms_ = 0;
+  int video_delay_ms_ = 0;
+};
+}  // namespace crossdesk
+#endif
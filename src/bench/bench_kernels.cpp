@@ -0,0 +1,329 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "audio_frame_slicer.h"
+#include "device_controller.h"
+#include "keyboard_converter.h"
+#include "libyuv.h"
+#include "remote_action_codec.h"
+#include "thumbnail.h"
+#if defined(__linux__)
+#include "screen_capturer_x11.h"
+#endif
+
+#define BENCH_FRAME_WIDTH 1920
+#define BENCH_FRAME_HEIGHT 1080
+#define BENCH_CURSOR_SIZE 32
+#define BENCH_THUMBNAIL_WIDTH 160
+#define BENCH_THUMBNAIL_HEIGHT 90
+// 10 ms of 48 kHz stereo s16, what the Linux speaker capturer slices
+#define BENCH_AUDIO_FRAME_BYTES 1920
+
+using namespace crossdesk;
+using json = nlohmann::json;
+
+namespace {
+
+// keeps the compiler from dropping work whose result is never read
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const void* sink;
+  sink = &value;
+#endif
+}
+
+struct BenchResult {
+  std::string name;
+  uint64_t iterations = 0;
+  double ns_per_op = 0;
+  // 0 when an op does not process a meaningful amount of bytes
+  double bytes_per_second = 0;
+};
+
+class Harness {
+ public:
+  Harness(double min_time_s, const std::string& filter)
+      : min_time_s_(min_time_s), filter_(filter) {}
+
+  // bytes_per_op is what one call of op reads, for the throughput column
+  void Run(const std::string& name, size_t bytes_per_op,
+           const std::function<void()>& op) {
+    if (!filter_.empty() && name.find(filter_) == std::string::npos) {
+      return;
+    }
+
+    // warms caches and lazy allocations before anything is timed
+    op();
+
+    uint64_t iterations = 1;
+    double elapsed_s = 0;
+    while (true) {
+      auto start = std::chrono::steady_clock::now();
+      for (uint64_t i = 0; i < iterations; i++) {
+        op();
+      }
+      elapsed_s = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+      if (elapsed_s >= min_time_s_) {
+        break;
+      }
+      // aim a little past the minimum so the last round usually suffices
+      double scale = elapsed_s > 0 ? min_time_s_ * 1.2 / elapsed_s : 10;
+      iterations = (uint64_t)(iterations * (scale > 10 ? 10 : scale)) + 1;
+    }
+
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.ns_per_op = elapsed_s * 1e9 / iterations;
+    result.bytes_per_second =
+        bytes_per_op ? bytes_per_op * iterations / elapsed_s : 0;
+    fprintf(stderr, "%-40s %12.1f ns/op %10.1f MB/s\n", name.c_str(),
+            result.ns_per_op, result.bytes_per_second / 1e6);
+    results_.push_back(result);
+  }
+
+  std::string ToJson() const {
+    json benchmarks = json::array();
+    for (const auto& result : results_) {
+      benchmarks.push_back({{"name", result.name},
+                            {"iterations", result.iterations},
+                            {"ns_per_op", result.ns_per_op},
+                            {"bytes_per_second", result.bytes_per_second}});
+    }
+    return json({{"benchmarks", benchmarks}}).dump(2);
+  }
+
+ private:
+  double min_time_s_;
+  std::string filter_;
+  std::vector<BenchResult> results_;
+};
+
+// a desktop is mostly flat areas with some detail, not noise
+std::vector<uint8_t> MakeArgbFrame(int width, int height) {
+  std::vector<uint8_t> argb(width * height * 4);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      uint8_t* pixel = &argb[(y * width + x) * 4];
+      pixel[0] = (uint8_t)(x / 8);
+      pixel[1] = (uint8_t)(y / 4);
+      pixel[2] = (uint8_t)((x ^ y) & 0xFF);
+      pixel[3] = 0xFF;
+    }
+  }
+  return argb;
+}
+
+void BenchCapture(Harness& harness) {
+  const int width = BENCH_FRAME_WIDTH, height = BENCH_FRAME_HEIGHT;
+  std::vector<uint8_t> argb = MakeArgbFrame(width, height);
+  std::vector<uint8_t> nv12(width * height * 3 / 2);
+
+  // same call as ScreenCapturerX11::OnFrame
+  harness.Run("argb_to_nv12/1920x1080", argb.size(), [&]() {
+    libyuv::ARGBToNV12(argb.data(), width * 4, nv12.data(), width,
+                       nv12.data() + width * height, width, width, height);
+    DoNotOptimize(nv12.data());
+  });
+
+#if defined(__linux__)
+  // an arrow like cursor, opaque body, soft edge and a transparent rest
+  std::vector<unsigned long> cursor(BENCH_CURSOR_SIZE * BENCH_CURSOR_SIZE);
+  for (int y = 0; y < BENCH_CURSOR_SIZE; y++) {
+    for (int x = 0; x < BENCH_CURSOR_SIZE; x++) {
+      unsigned long alpha = x < y ? 0xFF : x == y ? 0x80 : 0x00;
+      cursor[y * BENCH_CURSOR_SIZE + x] = (alpha << 24) | 0x00FFFFFF;
+    }
+  }
+  harness.Run("draw_cursor/32x32", cursor.size() * 4, [&]() {
+    ScreenCapturerX11::BlendCursor(argb.data(), width * 4, width, height,
+                                   cursor.data(), BENCH_CURSOR_SIZE,
+                                   BENCH_CURSOR_SIZE, width / 2, height / 2);
+    DoNotOptimize(argb.data());
+  });
+#endif
+
+  // what a thumbnail costs when a session ends
+  std::vector<char> rgba(BENCH_THUMBNAIL_WIDTH * BENCH_THUMBNAIL_HEIGHT * 4);
+  harness.Run("scale_nv12_to_abgr/1920x1080->160x90", nv12.size(), [&]() {
+    ScaleNv12ToABGR((char*)nv12.data(), width, height, BENCH_THUMBNAIL_WIDTH,
+                    BENCH_THUMBNAIL_HEIGHT, rgba.data());
+    DoNotOptimize(rgba.data());
+  });
+}
+
+void BenchRemoteAction(Harness& harness) {
+  RemoteAction mouse;
+  mouse.type = ControlType::mouse;
+  mouse.m.x = 0.4375f;
+  mouse.m.y = 0.8125f;
+  mouse.m.s = 0;
+  mouse.m.flag = MouseFlag::move;
+  mouse.timestamp = 1700000000123456;
+  std::string mouse_json = mouse.to_json();
+  harness.Run("remote_action_to_json/mouse", 0, [&]() {
+    std::string msg = RemoteAction::ToJson(mouse);
+    DoNotOptimize(msg);
+  });
+  harness.Run("remote_action_from_json/mouse", mouse_json.size(), [&]() {
+    RemoteAction remote_action;
+    bool ok = RemoteAction::FromJson(mouse_json, remote_action);
+    DoNotOptimize(ok);
+    DoNotOptimize(remote_action);
+  });
+
+  RemoteAction key;
+  key.type = ControlType::keyboard;
+  key.k.key_value = 0x41;
+  key.k.flag = KeyFlag::key_down;
+  key.timestamp = 1700000000123456;
+  std::string key_json = key.to_json();
+  harness.Run("remote_action_to_json/keyboard", 0, [&]() {
+    std::string msg = RemoteAction::ToJson(key);
+    DoNotOptimize(msg);
+  });
+  harness.Run("remote_action_from_json/keyboard", key_json.size(), [&]() {
+    RemoteAction remote_action;
+    bool ok = RemoteAction::FromJson(key_json, remote_action);
+    DoNotOptimize(ok);
+    DoNotOptimize(remote_action);
+  });
+
+  // host information as sent to every viewer, two displays
+  char display_0[] = "DisplayPort-0";
+  char display_1[] = "HDMI-A-1";
+  char* display_list[] = {display_0, display_1};
+  int left[] = {0, 1920}, top[] = {0, 0}, right[] = {1920, 4480},
+      bottom[] = {1080, 1440};
+  RemoteAction host_info;
+  host_info.type = ControlType::host_infomation;
+  strncpy(host_info.i.host_name, "workstation", sizeof(host_info.i.host_name));
+  host_info.i.host_name_size = strlen(host_info.i.host_name);
+  host_info.i.display_list = display_list;
+  host_info.i.display_num = 2;
+  host_info.i.left = left;
+  host_info.i.top = top;
+  host_info.i.right = right;
+  host_info.i.bottom = bottom;
+  std::vector<char> serialized = SerializeRemoteAction(host_info);
+  harness.Run("serialize_remote_action/host_info", 0, [&]() {
+    std::vector<char> buffer = SerializeRemoteAction(host_info);
+    DoNotOptimize(buffer.data());
+  });
+  harness.Run("deserialize_remote_action/host_info", serialized.size(), [&]() {
+    RemoteAction remote_action;
+    bool ok = DeserializeRemoteAction(serialized.data(), serialized.size(),
+                                      remote_action);
+    DoNotOptimize(ok);
+    if (ok) {
+      FreeRemoteAction(remote_action);
+    }
+  });
+}
+
+void BenchKeycodes(Harness& harness) {
+  // one op converts every vkCode there is, as a burst of typing would
+  std::vector<int> vk_codes(kVkCodeTableSize);
+  for (size_t i = 0; i < vk_codes.size(); i++) {
+    vk_codes[i] = (int)i;
+  }
+  harness.Run("keycode/vk_to_x11_keysym_x256", 0, [&]() {
+    int sum = 0;
+    for (int vk_code : vk_codes) {
+      sum += VkCodeToX11KeySym(vk_code);
+    }
+    DoNotOptimize(sum);
+  });
+  harness.Run("keycode/vk_to_cg_keycode_x256", 0, [&]() {
+    int sum = 0;
+    for (int vk_code : vk_codes) {
+      sum += VkCodeToCGKeyCode(vk_code);
+    }
+    DoNotOptimize(sum);
+  });
+
+  std::vector<int> key_syms;
+  for (const auto& pair : kVkCodeToX11KeySymPairs) {
+    key_syms.push_back(pair.to);
+  }
+  harness.Run("keycode/x11_keysym_to_vk_x" + std::to_string(key_syms.size()),
+              0, [&]() {
+                int sum = 0;
+                for (int key_sym : key_syms) {
+                  sum += X11KeySymToVkCode(key_sym);
+                }
+                DoNotOptimize(sum);
+              });
+}
+
+void BenchAudioSlicer(Harness& harness) {
+  // PulseAudio hands out fragments that rarely line up with our frames
+  const size_t fragments[] = {1764, 4410, 3528, 882, 7056, 2646, 1920, 5292};
+  size_t total = 0;
+  for (size_t fragment : fragments) {
+    total += fragment;
+  }
+  std::vector<uint8_t> stream(total);
+  for (size_t i = 0; i < stream.size(); i++) {
+    stream[i] = (uint8_t)(i * 31);
+  }
+
+  AudioFrameSlicer slicer(BENCH_AUDIO_FRAME_BYTES);
+  uint64_t frames = 0;
+  harness.Run("audio_frame_slicer/pulse_fragments", total, [&]() {
+    const uint8_t* data = stream.data();
+    for (size_t fragment : fragments) {
+      slicer.Push(data, fragment, [&](const uint8_t* frame, size_t size) {
+        frames++;
+        DoNotOptimize(frame);
+      });
+      data += fragment;
+    }
+  });
+  DoNotOptimize(frames);
+}
+
+void PrintUsage(const char* program) {
+  printf(
+      "Usage: %s [--filter SUBSTRING] [--min-time SECONDS]\n"
+      "Times the hot kernels and prints JSON with ns per op and bytes per "
+      "second\nto stdout, a readable summary goes to stderr.\n",
+      program);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string filter;
+  double min_time_s = 0.5;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+      min_time_s = atof(argv[++i]);
+    } else {
+      PrintUsage(argv[0]);
+      return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+    }
+  }
+
+  Harness harness(min_time_s, filter);
+  BenchCapture(harness);
+  BenchRemoteAction(harness);
+  BenchKeycodes(harness);
+  BenchAudioSlicer(harness);
+  printf("%s\n", harness.ToJson().c_str());
+  return 0;
+}
@@ -0,0 +1,438 @@
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "device_controller.h"
+#include "host_session.h"
+#include "latency_probe.h"
+#include "loopback_transport.h"
+#include "metrics.h"
+#include "minirtc.h"
+#include "path_manager.h"
+#include "rd_log.h"
+#include "server.h"
+#ifdef __linux__
+#include "screen_capture_helper.h"
+#endif
+
+#define BENCH_PASSWORD "bench1"
+#define BENCH_MOUSE_INTERVAL_MS 8
+#define BENCH_KEYBOARD_INTERVAL_MS 50
+#define BENCH_CLOCK_PING_INTERVAL_MS 500
+#define BENCH_PROBE_POLL_INTERVAL_MS 5
+// shift only, it does nothing on its own wherever the focus is
+#define BENCH_KEY_VALUE 0x10
+
+using namespace crossdesk;
+
+namespace {
+
+struct SimViewer {
+  std::string user_id;
+  Params params;
+  PeerPtr* peer = nullptr;
+  std::atomic<bool> connected{false};
+  std::atomic<uint64_t> frames_received{0};
+  LatencyProbe latency_probe;
+};
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// user plus system time of the whole process, host and viewers alike
+double ProcessCpuSeconds() {
+#ifdef _WIN32
+  FILETIME creation, exit, kernel, user;
+  GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+  auto to_seconds = [](const FILETIME& time) {
+    ULARGE_INTEGER value;
+    value.LowPart = time.dwLowDateTime;
+    value.HighPart = time.dwHighDateTime;
+    return value.QuadPart / 1e7;
+  };
+  return to_seconds(kernel) + to_seconds(user);
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#endif
+}
+
+void OnViewerVideoFrame(const XVideoFrame* video_frame, const char* user_id,
+                        size_t user_id_size, void* user_data) {
+  SimViewer* viewer = (SimViewer*)user_data;
+  viewer->frames_received++;
+  // the loopback hands over the captured NV12 as is, no decoder in between
+  if (viewer->latency_probe.IsWaiting()) {
+    uint8_t marker =
+        LatencyMarker::Detect((const uint8_t*)video_frame->data,
+                              video_frame->width, video_frame->height);
+    if (marker != 0) {
+      viewer->latency_probe.OnMarker(marker, NowUs());
+    }
+  }
+}
+
+void OnViewerConnectionStatus(ConnectionStatus status, const char* user_id,
+                              size_t user_id_size, void* user_data) {
+  SimViewer* viewer = (SimViewer*)user_data;
+  if (status == ConnectionStatus::Connected) {
+    viewer->connected = true;
+  } else if (status != ConnectionStatus::Connecting) {
+    viewer->connected = false;
+  }
+}
+
+void SendAction(SimViewer* viewer, const RemoteAction& remote_action) {
+  std::string msg = remote_action.to_json();
+  SendDataFrame(viewer->peer, msg.data(), msg.size(), "data");
+}
+
+// what a viewer sends while someone works on the remote desktop, the clock
+// pings are part of it since every real viewer keeps sending them
+void GenerateInput(std::vector<std::unique_ptr<SimViewer>>& viewers,
+                   int64_t duration_ms) {
+  int64_t start = NowMs();
+  int64_t last_keyboard = 0, last_ping = 0;
+  bool key_down = false;
+  for (int64_t now = start; now - start < duration_ms; now = NowMs()) {
+    bool keyboard = now - last_keyboard >= BENCH_KEYBOARD_INTERVAL_MS;
+    bool ping = now - last_ping >= BENCH_CLOCK_PING_INTERVAL_MS;
+    for (size_t i = 0; i < viewers.size(); i++) {
+      SimViewer* viewer = viewers[i].get();
+      RemoteAction remote_action;
+      remote_action.type = ControlType::mouse;
+      // small circles around the center, one phase per viewer
+      double angle = now / 200.0 + i;
+      remote_action.m.x = (float)(0.5 + 0.05 * cos(angle));
+      remote_action.m.y = (float)(0.5 + 0.05 * sin(angle));
+      remote_action.m.s = 0;
+      remote_action.m.flag = MouseFlag::move;
+      remote_action.timestamp = GetSystemTimeMicros(viewer->peer);
+      SendAction(viewer, remote_action);
+
+      if (keyboard) {
+        remote_action.type = ControlType::keyboard;
+        remote_action.k.key_value = BENCH_KEY_VALUE;
+        remote_action.k.flag = key_down ? KeyFlag::key_up : KeyFlag::key_down;
+        remote_action.timestamp = GetSystemTimeMicros(viewer->peer);
+        SendAction(viewer, remote_action);
+      }
+      if (ping) {
+        remote_action.type = ControlType::clock_ping;
+        remote_action.timestamp = 0;
+        remote_action.c.t0 = GetSystemTimeMicros(viewer->peer);
+        remote_action.c.t1 = remote_action.c.t2 = 0;
+        remote_action.c.input_latency_us = -1;
+        SendAction(viewer, remote_action);
+      }
+    }
+    if (keyboard) {
+      key_down = !key_down;
+      last_keyboard = now;
+    }
+    if (ping) {
+      last_ping = now;
+    }
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(BENCH_MOUSE_INTERVAL_MS));
+  }
+
+  // never leave shift held on the host
+  if (key_down) {
+    for (auto& viewer : viewers) {
+      RemoteAction remote_action;
+      remote_action.type = ControlType::keyboard;
+      remote_action.k.key_value = BENCH_KEY_VALUE;
+      remote_action.k.flag = KeyFlag::key_up;
+      SendAction(viewer.get(), remote_action);
+    }
+  }
+}
+
+std::unique_ptr<SimViewer> AddViewer(int index, const std::string& host) {
+  auto viewer = std::make_unique<SimViewer>();
+  viewer->user_id = "C-bench" + std::to_string(index);
+  memset(&viewer->params, 0, sizeof(viewer->params));
+  viewer->params.user_id = viewer->user_id.c_str();
+  viewer->params.user_data = viewer.get();
+  viewer->params.on_receive_video_frame = OnViewerVideoFrame;
+  viewer->params.on_connection_status = OnViewerConnectionStatus;
+  viewer->peer = CreatePeer(&viewer->params);
+  if (!viewer->peer) {
+    return nullptr;
+  }
+  Init(viewer->peer);
+  AddVideoStream(viewer->peer, "display");
+  AddAudioStream(viewer->peer, "audio");
+  AddDataStream(viewer->peer, "data");
+  JoinConnection(viewer->peer, host.c_str());
+  return viewer;
+}
+
+// the injection latency histogram is shared, so each step reads its delta
+struct LatencySample {
+  uint64_t count = 0;
+  double sum = 0;
+  std::vector<uint64_t> buckets;
+
+  static LatencySample Take(const Histogram& histogram) {
+    LatencySample sample;
+    sample.count = histogram.Count();
+    sample.sum = histogram.Sum();
+    for (size_t i = 0; i <= histogram.Bounds().size(); i++) {
+      sample.buckets.push_back(histogram.BucketCount(i));
+    }
+    return sample;
+  }
+};
+
+// upper bound of the bucket holding the given quantile, -1 above the last
+double QuantileMs(const Histogram& histogram, const LatencySample& begin,
+                  const LatencySample& end, double quantile) {
+  uint64_t count = end.count - begin.count;
+  if (count == 0) {
+    return 0;
+  }
+  uint64_t seen = 0;
+  for (size_t i = 0; i < histogram.Bounds().size(); i++) {
+    seen += end.buckets[i] - begin.buckets[i];
+    if (seen >= quantile * count) {
+      return histogram.Bounds()[i] * 1000;
+    }
+  }
+  return -1;
+}
+
+bool WaitConnected(std::vector<std::unique_ptr<SimViewer>>& viewers,
+                   int64_t timeout_ms) {
+  for (int64_t start = NowMs(); NowMs() - start < timeout_ms;) {
+    bool all_connected = true;
+    for (auto& viewer : viewers) {
+      all_connected = all_connected && viewer->connected;
+    }
+    if (all_connected) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  return false;
+}
+
+// one viewer runs the click-to-pixels probe of the GUI against the host and
+// prints the same summary line the GUI logs
+int RunLatencyProbe(const std::string& host, int samples) {
+  std::vector<std::unique_ptr<SimViewer>> viewers;
+  auto viewer = AddViewer(0, host);
+  if (!viewer) {
+    fprintf(stderr, "Failed to create viewer\n");
+    return 1;
+  }
+  viewers.push_back(std::move(viewer));
+  SimViewer* prober = viewers.front().get();
+  if (!WaitConnected(viewers, 5000)) {
+    fprintf(stderr, "Viewer did not connect, see the log for details\n");
+  }
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+
+  prober->latency_probe.Start(samples);
+  while (prober->latency_probe.GetResult().running) {
+    uint8_t probe_id = prober->latency_probe.NextProbe(NowUs());
+    if (probe_id != 0) {
+      RemoteAction remote_action;
+      remote_action.type = ControlType::latency_probe;
+      remote_action.d = probe_id;
+      remote_action.timestamp = GetSystemTimeMicros(prober->peer);
+      SendAction(prober, remote_action);
+    }
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(BENCH_PROBE_POLL_INTERVAL_MS));
+  }
+
+  LatencyProbe::Result result = prober->latency_probe.GetResult();
+  printf(
+      "Latency probe done: samples=%d lost=%d min=%.1fms p50=%.1fms "
+      "p95=%.1fms max=%.1fms\n",
+      result.sample_count, result.lost_count, result.min_ms, result.p50_ms,
+      result.p95_ms, result.max_ms);
+  fflush(stdout);
+
+  LeaveConnection(prober->peer, host.substr(0, host.find('@')).c_str());
+  DestroyPeer(&prober->peer);
+  return result.sample_count > 0 ? 0 : 1;
+}
+
+void PrintUsage(const char* program) {
+  printf(
+      "Usage: %s [--max-viewers N] [--duration SECONDS] [--latency-probe N]\n"
+      "Runs a host in this process and adds loopback viewers 1, 2, 4, ... up "
+      "to N (32).\nEvery viewer sends mouse moves at 125 Hz and shift key "
+      "presses at 20 Hz, so\nrun it on a display nobody is using, e.g. under "
+      "Xvfb.\nWith --latency-probe a single viewer measures N click-to-pixels "
+      "samples instead.\n",
+      program);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+#ifdef __linux__
+  int helper_exit_code = 0;
+  if (MaybeRunScreenCaptureHelper(argc, argv, &helper_exit_code)) {
+    return helper_exit_code;
+  }
+#endif
+
+  int max_viewers = 32;
+  int duration_s = 10;
+  int probe_samples = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--max-viewers") == 0 && i + 1 < argc) {
+      max_viewers = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+      duration_s = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--latency-probe") == 0 && i + 1 < argc) {
+      probe_samples = atoi(argv[++i]);
+      if (probe_samples < 1) {
+        PrintUsage(argv[0]);
+        return 1;
+      }
+    } else {
+      PrintUsage(argv[0]);
+      return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+    }
+  }
+  if (max_viewers < 1 || duration_s < 1) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  PathManager path_manager("CrossDesk");
+  InitLogger(path_manager.GetLogPath().string());
+
+  Server::Options options;
+  options.password = BENCH_PASSWORD;
+  options.metrics_port = 0;
+  Server server(options);
+  std::thread server_thread([&server]() { server.Run(); });
+
+  // the server rejoins with our password once it got an id
+  std::string host;
+  for (int64_t start = NowMs(); host.empty() && NowMs() - start < 10000;) {
+    for (const std::string& candidate : GetLoopbackHosts()) {
+      size_t at_pos = candidate.find('@');
+      if (at_pos != std::string::npos &&
+          candidate.substr(at_pos + 1) == BENCH_PASSWORD) {
+        host = candidate;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  if (host.empty()) {
+    fprintf(stderr, "Host did not come up, see the log for details\n");
+    server.Stop();
+    server_thread.join();
+    ShutdownLogger();
+    return 1;
+  }
+
+  if (probe_samples > 0) {
+    int ret = RunLatencyProbe(host, probe_samples);
+    server.Stop();
+    server_thread.join();
+    ShutdownLogger();
+    return ret;
+  }
+
+  // the very series the host in this process updates
+  std::shared_ptr<Histogram> input_latency = HostSession::InputLatencyMetric();
+  std::shared_ptr<Gauge> capture_fps = HostSession::CaptureFpsMetric();
+
+  printf("%8s %8s %12s %12s %14s %14s %14s\n", "viewers", "cpu%",
+         "capture_fps", "viewer_fps", "input_avg_ms", "input_p95_ms",
+         "input_p99_ms");
+
+  // doubling, and max_viewers itself when it is no power of two
+  std::vector<int> steps;
+  for (int step = 1; step < max_viewers; step *= 2) {
+    steps.push_back(step);
+  }
+  steps.push_back(max_viewers);
+
+  std::vector<std::unique_ptr<SimViewer>> viewers;
+  for (int step : steps) {
+    while ((int)viewers.size() < step) {
+      auto viewer = AddViewer((int)viewers.size(), host);
+      if (!viewer) {
+        fprintf(stderr, "Failed to create viewer %zu\n", viewers.size());
+        break;
+      }
+      viewers.push_back(std::move(viewer));
+    }
+    // newly joined viewers first wait for capture to come up for them
+    WaitConnected(viewers, 5000);
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    uint64_t frames_begin = 0;
+    for (auto& viewer : viewers) {
+      frames_begin += viewer->frames_received;
+    }
+    LatencySample latency_begin = LatencySample::Take(*input_latency);
+    double cpu_begin = ProcessCpuSeconds();
+    int64_t time_begin = NowMs();
+
+    GenerateInput(viewers, duration_s * 1000LL);
+
+    double elapsed_s = (NowMs() - time_begin) / 1000.0;
+    double cpu_percent = (ProcessCpuSeconds() - cpu_begin) / elapsed_s * 100;
+    uint64_t frames_end = 0;
+    for (auto& viewer : viewers) {
+      frames_end += viewer->frames_received;
+    }
+    double viewer_fps = (frames_end - frames_begin) / elapsed_s / viewers.size();
+    LatencySample latency_end = LatencySample::Take(*input_latency);
+    uint64_t latency_count = latency_end.count - latency_begin.count;
+    double latency_avg_ms =
+        latency_count
+            ? (latency_end.sum - latency_begin.sum) / latency_count * 1000
+            : 0;
+
+    printf("%8zu %8.1f %12.1f %12.1f %14.2f %14.1f %14.1f\n", viewers.size(),
+           cpu_percent, capture_fps->Value(), viewer_fps, latency_avg_ms,
+           QuantileMs(*input_latency, latency_begin, latency_end, 0.95),
+           QuantileMs(*input_latency, latency_begin, latency_end, 0.99));
+    fflush(stdout);
+  }
+
+  for (auto& viewer : viewers) {
+    LeaveConnection(viewer->peer, host.substr(0, host.find('@')).c_str());
+    DestroyPeer(&viewer->peer);
+  }
+  server.Stop();
+  server_thread.join();
+  ShutdownLogger();
+  return 0;
+}
@@ -0,0 +1,67 @@
+#include "clock_offset_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace crossdesk {
+
+ClockOffsetEstimator::ClockOffsetEstimator(size_t window_size)
+    : window_size_(window_size > 0 ? window_size : 1) {}
+
+ClockOffsetEstimator::~ClockOffsetEstimator() {}
+
+void ClockOffsetEstimator::OnPong(int64_t t0, int64_t t1, int64_t t2,
+                                  int64_t t3) {
+  int64_t rtt_us = (t3 - t0) - (t2 - t1);
+  if (t3 < t0 || rtt_us < 0) {
+    // a reordered pong or a remote that answered before it was asked
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  samples_.push_back({((t1 - t0) + (t2 - t3)) / 2, rtt_us});
+  if (samples_.size() > window_size_) {
+    samples_.pop_front();
+  }
+
+  const Sample& best =
+      *std::min_element(samples_.begin(), samples_.end(),
+                        [](const Sample& a, const Sample& b) {
+                          return a.rtt_us < b.rtt_us;
+                        });
+  if (!valid_) {
+    offset_us_ = (double)best.offset_us;
+    valid_ = true;
+  } else {
+    offset_us_ += (best.offset_us - offset_us_) / 4;
+  }
+  rtt_us_ = rtt_us;
+}
+
+int64_t ClockOffsetEstimator::RemoteToLocal(int64_t remote_us) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return remote_us - (int64_t)std::llround(offset_us_);
+}
+
+int64_t ClockOffsetEstimator::LocalToRemote(int64_t local_us) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return local_us + (int64_t)std::llround(offset_us_);
+}
+
+ClockOffsetEstimator::Stats ClockOffsetEstimator::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats;
+  stats.valid = valid_;
+  stats.offset_us = (int64_t)std::llround(offset_us_);
+  stats.rtt_us = rtt_us_;
+  return stats;
+}
+
+void ClockOffsetEstimator::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  samples_.clear();
+  valid_ = false;
+  offset_us_ = 0;
+  rtt_us_ = 0;
+}
+}  // namespace crossdesk
@@ -0,0 +1,63 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _CLOCK_OFFSET_ESTIMATOR_H_
+#define _CLOCK_OFFSET_ESTIMATOR_H_
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace crossdesk {
+
+// NTP style estimate of the remote clock relative to the local one. The
+// local side sends a ping stamped t0, the remote stamps its receive time t1
+// and send time t2, and the pong arrives at t3:
+//   rtt    = (t3 - t0) - (t2 - t1)
+//   offset = ((t1 - t0) + (t2 - t3)) / 2      remote minus local
+// Queueing makes samples asymmetric, so the offset is taken from the sample
+// with the lowest rtt among the recent ones, as the NTP clock filter does,
+// and then smoothed so a single lucky sample cannot make it jump.
+class ClockOffsetEstimator {
+ public:
+  struct Stats {
+    bool valid = false;
+    int64_t offset_us = 0;
+    int64_t rtt_us = 0;
+  };
+
+ public:
+  ClockOffsetEstimator(size_t window_size = 8);
+  ~ClockOffsetEstimator();
+
+ public:
+  void OnPong(int64_t t0, int64_t t1, int64_t t2, int64_t t3);
+
+  // converts a remote timestamp to the local clock, the input as is until
+  // the first pong arrived
+  int64_t RemoteToLocal(int64_t remote_us);
+  // converts a local timestamp to the remote clock
+  int64_t LocalToRemote(int64_t local_us);
+
+  Stats GetStats();
+  void Reset();
+
+ private:
+  struct Sample {
+    int64_t offset_us;
+    int64_t rtt_us;
+  };
+
+ private:
+  std::mutex mutex_;
+  const size_t window_size_;
+  std::deque<Sample> samples_;
+  bool valid_ = false;
+  double offset_us_ = 0;
+  int64_t rtt_us_ = 0;
+};
+}  // namespace crossdesk
+#endif
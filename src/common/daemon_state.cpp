@@ -0,0 +1,377 @@
+#include "daemon_state.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define DAEMON_STATE_MAGIC 0x43445354  // CDST
+#define DAEMON_STATE_VERSION 2
+
+namespace crossdesk {
+
+// plain old data only, both sides may be different builds of the same version
+struct DaemonState::Region {
+  uint32_t magic;
+  uint32_t version;
+  // odd while the child writes the snapshot
+  std::atomic<uint32_t> sequence;
+  uint32_t valid;
+  char client_id_with_password[17];
+  int32_t selected_display;
+  uint32_t session_count;
+  char session_ids[DAEMON_STATE_MAX_SESSIONS][DAEMON_STATE_SESSION_ID_SIZE];
+
+  // written by the daemon while no child runs
+  std::atomic<uint32_t> restart_count;
+  std::atomic<int64_t> spawn_time_ns;
+  std::atomic<int64_t> exit_time_ns;
+
+  // written by the child, read by the daemon
+  std::atomic<uint32_t> watched[(int)Subsystem::kCount];
+  std::atomic<int64_t> heartbeat_ns[(int)Subsystem::kCount];
+  // subsystem + 1, 0 when the previous child was not killed for a hang
+  std::atomic<uint32_t> last_hang;
+  std::atomic<int64_t> last_hang_silent_ms;
+};
+
+static const int64_t kHeartbeatTimeoutMs[] = {
+    DAEMON_HEARTBEAT_MAIN_LOOP_TIMEOUT_MS,
+    DAEMON_HEARTBEAT_CAPTURE_TIMEOUT_MS,
+    DAEMON_HEARTBEAT_CAPTURE_TIMEOUT_MS,
+};
+
+DaemonState::DaemonState() {}
+
+DaemonState::~DaemonState() { Close(); }
+
+int64_t DaemonState::NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int DaemonState::Create(const std::string& name) {
+  Close();
+#ifdef _WIN32
+  name_ = "Local\\" + name;
+  HANDLE mapping =
+      CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+                         sizeof(Region), name_.c_str());
+  if (!mapping) {
+    return -1;
+  }
+  void* region = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0,
+                               sizeof(Region));
+  if (!region) {
+    CloseHandle(mapping);
+    return -1;
+  }
+  mapping_ = mapping;
+#else
+  name_ = "/" + name;
+  shm_unlink(name_.c_str());
+  int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    return -1;
+  }
+  if (ftruncate(fd, sizeof(Region)) != 0) {
+    close(fd);
+    shm_unlink(name_.c_str());
+    return -1;
+  }
+  void* region = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+  close(fd);
+  if (region == MAP_FAILED) {
+    shm_unlink(name_.c_str());
+    return -1;
+  }
+#endif
+
+  memset(region, 0, sizeof(Region));
+  region_ = (Region*)region;
+  region_->magic = DAEMON_STATE_MAGIC;
+  region_->version = DAEMON_STATE_VERSION;
+  region_->spawn_time_ns = NowNs();
+  owner_ = true;
+
+#ifdef _WIN32
+  SetEnvironmentVariableA(DAEMON_STATE_ENV, name.c_str());
+#else
+  setenv(DAEMON_STATE_ENV, name.c_str(), 1);
+#endif
+  return 0;
+}
+
+int DaemonState::Open() {
+  Close();
+  const char* name = getenv(DAEMON_STATE_ENV);
+  if (!name || !*name) {
+    return -1;
+  }
+
+#ifdef _WIN32
+  name_ = std::string("Local\\") + name;
+  HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name_.c_str());
+  if (!mapping) {
+    return -1;
+  }
+  void* region = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0,
+                               sizeof(Region));
+  if (!region) {
+    CloseHandle(mapping);
+    return -1;
+  }
+  mapping_ = mapping;
+#else
+  name_ = std::string("/") + name;
+  int fd = shm_open(name_.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    return -1;
+  }
+  void* region = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+  close(fd);
+  if (region == MAP_FAILED) {
+    return -1;
+  }
+#endif
+
+  region_ = (Region*)region;
+  if (region_->magic != DAEMON_STATE_MAGIC ||
+      region_->version != DAEMON_STATE_VERSION) {
+    Close();
+    return -1;
+  }
+  return 0;
+}
+
+void DaemonState::Close() {
+  if (!region_) {
+    return;
+  }
+
+#ifdef _WIN32
+  UnmapViewOfFile(region_);
+  CloseHandle((HANDLE)mapping_);
+  mapping_ = nullptr;
+#else
+  munmap(region_, sizeof(Region));
+  if (owner_) {
+    shm_unlink(name_.c_str());
+  }
+#endif
+  region_ = nullptr;
+  owner_ = false;
+}
+
+void DaemonState::Write(const Snapshot& snapshot) {
+  if (!region_) {
+    return;
+  }
+
+  uint32_t sequence = region_->sequence.load(std::memory_order_relaxed);
+  region_->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  memset(region_->client_id_with_password, 0,
+         sizeof(region_->client_id_with_password));
+  strncpy(region_->client_id_with_password,
+          snapshot.client_id_with_password.c_str(),
+          sizeof(region_->client_id_with_password) - 1);
+  region_->selected_display = snapshot.selected_display;
+  size_t session_count = snapshot.session_ids.size();
+  if (session_count > DAEMON_STATE_MAX_SESSIONS) {
+    session_count = DAEMON_STATE_MAX_SESSIONS;
+  }
+  region_->session_count = (uint32_t)session_count;
+  memset(region_->session_ids, 0, sizeof(region_->session_ids));
+  for (size_t i = 0; i < session_count; i++) {
+    strncpy(region_->session_ids[i], snapshot.session_ids[i].c_str(),
+            DAEMON_STATE_SESSION_ID_SIZE - 1);
+  }
+  region_->valid = 1;
+
+  region_->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool DaemonState::Read(Snapshot* snapshot) const {
+  if (!region_ || !snapshot) {
+    return false;
+  }
+
+  // a child that died halfway through a write leaves the sequence odd
+  for (int attempt = 0; attempt < 100; attempt++) {
+    uint32_t before = region_->sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    Snapshot copy;
+    bool valid = region_->valid != 0;
+    char client_id_with_password[sizeof(region_->client_id_with_password)];
+    memcpy(client_id_with_password, region_->client_id_with_password,
+           sizeof(client_id_with_password));
+    client_id_with_password[sizeof(client_id_with_password) - 1] = '\0';
+    copy.client_id_with_password = client_id_with_password;
+    copy.selected_display = region_->selected_display;
+    uint32_t session_count = region_->session_count;
+    if (session_count > DAEMON_STATE_MAX_SESSIONS) {
+      session_count = DAEMON_STATE_MAX_SESSIONS;
+    }
+    for (uint32_t i = 0; i < session_count; i++) {
+      char session_id[DAEMON_STATE_SESSION_ID_SIZE];
+      memcpy(session_id, region_->session_ids[i], sizeof(session_id));
+      session_id[sizeof(session_id) - 1] = '\0';
+      copy.session_ids.push_back(session_id);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (region_->sequence.load(std::memory_order_relaxed) != before) {
+      continue;
+    }
+    if (!valid) {
+      return false;
+    }
+    *snapshot = std::move(copy);
+    return true;
+  }
+  return false;
+}
+
+void DaemonState::Clear() {
+  if (!region_) {
+    return;
+  }
+
+  uint32_t sequence = region_->sequence.load(std::memory_order_relaxed);
+  // also repairs a sequence left odd by a child that died mid write
+  sequence &= ~1u;
+  region_->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  region_->valid = 0;
+  region_->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void DaemonState::MarkRestart(uint32_t restart_count, int64_t exit_time_ns) {
+  if (!region_) {
+    return;
+  }
+
+  // nobody writes concurrently, the child is gone
+  uint32_t sequence = region_->sequence.load(std::memory_order_relaxed);
+  if (sequence & 1) {
+    region_->sequence.store(sequence + 1, std::memory_order_relaxed);
+    region_->valid = 0;
+  }
+  region_->restart_count = restart_count;
+  region_->exit_time_ns = exit_time_ns;
+  region_->spawn_time_ns = NowNs();
+}
+
+uint32_t DaemonState::RestartCount() const {
+  return region_ ? region_->restart_count.load() : 0;
+}
+
+int64_t DaemonState::SpawnTimeNs() const {
+  return region_ ? region_->spawn_time_ns.load() : 0;
+}
+
+int64_t DaemonState::ExitTimeNs() const {
+  return region_ ? region_->exit_time_ns.load() : 0;
+}
+
+void DaemonState::Beat(Subsystem subsystem) {
+  if (!region_) {
+    return;
+  }
+  region_->heartbeat_ns[(int)subsystem].store(NowNs(),
+                                              std::memory_order_relaxed);
+}
+
+void DaemonState::SetWatched(Subsystem subsystem, bool watched) {
+  if (!region_) {
+    return;
+  }
+  // beat first, the daemon must never see the flag with a stale timestamp
+  if (watched) {
+    region_->heartbeat_ns[(int)subsystem].store(NowNs(),
+                                                std::memory_order_relaxed);
+  }
+  region_->watched[(int)subsystem].store(watched ? 1 : 0,
+                                         std::memory_order_release);
+}
+
+bool DaemonState::FindStalled(Subsystem* subsystem, int64_t* silent_ms) const {
+  if (!region_) {
+    return false;
+  }
+
+  for (int i = 0; i < (int)Subsystem::kCount; i++) {
+    if (!region_->watched[i].load(std::memory_order_acquire)) {
+      continue;
+    }
+    int64_t silent_ns =
+        NowNs() - region_->heartbeat_ns[i].load(std::memory_order_relaxed);
+    if (silent_ns / 1000000 > kHeartbeatTimeoutMs[i]) {
+      *subsystem = (Subsystem)i;
+      *silent_ms = silent_ns / 1000000;
+      return true;
+    }
+  }
+  return false;
+}
+
+void DaemonState::ResetHeartbeats() {
+  if (!region_) {
+    return;
+  }
+  for (int i = 0; i < (int)Subsystem::kCount; i++) {
+    region_->watched[i].store(0, std::memory_order_relaxed);
+    region_->heartbeat_ns[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void DaemonState::SetLastHang(bool hung, Subsystem subsystem,
+                              int64_t silent_ms) {
+  if (!region_) {
+    return;
+  }
+  region_->last_hang_silent_ms = hung ? silent_ms : 0;
+  region_->last_hang = hung ? (uint32_t)subsystem + 1 : 0;
+}
+
+bool DaemonState::LastHang(Subsystem* subsystem, int64_t* silent_ms) const {
+  uint32_t last_hang = region_ ? region_->last_hang.load() : 0;
+  if (last_hang == 0 || last_hang > (uint32_t)Subsystem::kCount) {
+    return false;
+  }
+  *subsystem = (Subsystem)(last_hang - 1);
+  *silent_ms = region_->last_hang_silent_ms;
+  return true;
+}
+
+const char* DaemonState::SubsystemName(Subsystem subsystem) {
+  switch (subsystem) {
+    case Subsystem::kMainLoop:
+      return "main loop";
+    case Subsystem::kScreenCapture:
+      return "screen capture";
+    case Subsystem::kSpeakerCapture:
+      return "speaker capture";
+    default:
+      return "unknown";
+  }
+}
+}  // namespace crossdesk
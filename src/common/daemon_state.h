@@ -0,0 +1,97 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _DAEMON_STATE_H_
+#define _DAEMON_STATE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define DAEMON_STATE_ENV "CROSSDESK_DAEMON_STATE"
+#define DAEMON_STATE_MAX_SESSIONS 8
+#define DAEMON_STATE_SESSION_ID_SIZE 32
+// how long a watched subsystem may stay silent before the child is killed
+#define DAEMON_HEARTBEAT_MAIN_LOOP_TIMEOUT_MS 30000
+#define DAEMON_HEARTBEAT_CAPTURE_TIMEOUT_MS 10000
+
+namespace crossdesk {
+
+// Small shared memory region the daemon keeps alive across child restarts.
+// The child publishes what it needs to come back quickly, a restarted child
+// reads it before touching the network. Without a daemon nothing is opened
+// and every call is a no-op.
+//
+// The region also carries the child's heartbeats. A subsystem is only
+// watched between SetWatched(true) and SetWatched(false), the daemon kills
+// the child once a watched one stays silent for longer than its timeout.
+class DaemonState {
+ public:
+  enum class Subsystem {
+    kMainLoop = 0,
+    kScreenCapture,
+    kSpeakerCapture,
+    kCount
+  };
+
+  struct Snapshot {
+    std::string client_id_with_password;
+    int selected_display = 0;
+    std::vector<std::string> session_ids;
+  };
+
+ public:
+  DaemonState();
+  ~DaemonState();
+
+  // daemon side, the name is exported in DAEMON_STATE_ENV for children
+  int Create(const std::string& name);
+  // child side, attaches to the region named in DAEMON_STATE_ENV
+  int Open();
+  void Close();
+  bool IsOpen() const { return region_ != nullptr; }
+
+  // single writer, readers retry while a write is in progress
+  void Write(const Snapshot& snapshot);
+  bool Read(Snapshot* snapshot) const;
+  // forgets the snapshot, e.g. when it may be what makes the child crash
+  void Clear();
+
+  // daemon side, called right before a replacement child is spawned
+  void MarkRestart(uint32_t restart_count, int64_t exit_time_ns);
+  // 0 for the first child
+  uint32_t RestartCount() const;
+  // steady clock, comparable between processes of the same boot
+  int64_t SpawnTimeNs() const;
+  int64_t ExitTimeNs() const;
+
+  // child side, Beat is a single relaxed store and fine on hot paths
+  void Beat(Subsystem subsystem);
+  void SetWatched(Subsystem subsystem, bool watched);
+  // daemon side, finds the first watched subsystem past its timeout
+  bool FindStalled(Subsystem* subsystem, int64_t* silent_ms) const;
+  // daemon side, a new child starts with nothing watched
+  void ResetHeartbeats();
+  // daemon side, tells the next child why its predecessor was killed
+  void SetLastHang(bool hung, Subsystem subsystem, int64_t silent_ms);
+  bool LastHang(Subsystem* subsystem, int64_t* silent_ms) const;
+
+  static const char* SubsystemName(Subsystem subsystem);
+  static int64_t NowNs();
+
+ private:
+  struct Region;
+
+ private:
+  Region* region_ = nullptr;
+  bool owner_ = false;
+  std::string name_;
+#ifdef _WIN32
+  void* mapping_ = nullptr;
+#endif
+};
+}  // namespace crossdesk
+#endif
@@ -0,0 +1,191 @@
+#include "latency_probe.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "rd_log.h"
+
+namespace crossdesk {
+
+namespace {
+
+constexpr uint8_t kLumaHigh = 235;
+constexpr uint8_t kLumaLow = 16;
+constexpr uint8_t kSync[4] = {1, 0, 1, 0};
+
+void MarkerBits(uint8_t id, uint8_t* bits) {
+  memcpy(bits, kSync, sizeof(kSync));
+  int ones = 0;
+  for (int i = 0; i < 8; ++i) {
+    bits[4 + i] = (id >> (7 - i)) & 1;
+    ones += bits[4 + i];
+  }
+  bits[12] = ones & 1;
+}
+
+}  // namespace
+
+bool LatencyMarker::Stamp(uint8_t* nv12, int width, int height, uint8_t id) {
+  if (!nv12 || width < kCellSize * kCellCount || height < kCellSize) {
+    return false;
+  }
+
+  uint8_t bits[kCellCount];
+  MarkerBits(id, bits);
+
+  for (int y = 0; y < kCellSize; ++y) {
+    uint8_t* row = nv12 + (size_t)y * width;
+    for (int cell = 0; cell < kCellCount; ++cell) {
+      memset(row + cell * kCellSize, bits[cell] ? kLumaHigh : kLumaLow,
+             kCellSize);
+    }
+  }
+
+  // neutral chroma so the patch stays gray
+  uint8_t* uv = nv12 + (size_t)width * height;
+  for (int y = 0; y < kCellSize / 2; ++y) {
+    memset(uv + (size_t)y * width, 128, kCellSize * kCellCount);
+  }
+  return true;
+}
+
+uint8_t LatencyMarker::Detect(const uint8_t* nv12, int width, int height) {
+  if (!nv12 || width < kCellSize * kCellCount || height < kCellSize) {
+    return 0;
+  }
+
+  uint8_t bits[kCellCount];
+  for (int cell = 0; cell < kCellCount; ++cell) {
+    // sample the middle of the cell, edges bleed after compression
+    int sum = 0;
+    for (int y = kCellSize / 4; y < kCellSize * 3 / 4; ++y) {
+      const uint8_t* row = nv12 + (size_t)y * width + cell * kCellSize;
+      for (int x = kCellSize / 4; x < kCellSize * 3 / 4; ++x) {
+        sum += row[x];
+      }
+    }
+    int mean = sum / ((kCellSize / 2) * (kCellSize / 2));
+    bits[cell] = mean > (kLumaHigh + kLumaLow) / 2 ? 1 : 0;
+    // both levels are far from the middle, anything else is screen content
+    if (mean > 80 && mean < 170) {
+      return 0;
+    }
+  }
+
+  if (memcmp(bits, kSync, sizeof(kSync)) != 0) {
+    return 0;
+  }
+
+  uint8_t id = 0;
+  int ones = 0;
+  for (int i = 0; i < 8; ++i) {
+    id = (uint8_t)((id << 1) | bits[4 + i]);
+    ones += bits[4 + i];
+  }
+  if ((ones & 1) != bits[12]) {
+    return 0;
+  }
+  return id;
+}
+
+LatencyProbe::LatencyProbe() {}
+
+LatencyProbe::~LatencyProbe() {}
+
+void LatencyProbe::Start(int sample_count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  running_ = sample_count > 0;
+  target_count_ = sample_count;
+  lost_count_ = 0;
+  waiting_id_ = 0;
+  sent_us_ = 0;
+  last_done_us_ = 0;
+  samples_ms_.clear();
+}
+
+void LatencyProbe::Stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  running_ = false;
+  waiting_id_ = 0;
+}
+
+uint8_t LatencyProbe::NextProbe(int64_t now_us) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!running_) {
+    return 0;
+  }
+
+  if (waiting_id_ != 0) {
+    if (now_us - sent_us_ < kTimeoutUs) {
+      return 0;
+    }
+    ++lost_count_;
+    waiting_id_ = 0;
+    last_done_us_ = now_us;
+  }
+
+  if ((int)samples_ms_.size() + lost_count_ >= target_count_) {
+    running_ = false;
+    // a stable line for scripted runs to grep
+    Result result = ResultLocked();
+    LOG_INFO(
+        "Latency probe done: samples={} lost={} min={:.1f}ms p50={:.1f}ms "
+        "p95={:.1f}ms max={:.1f}ms",
+        result.sample_count, result.lost_count, result.min_ms, result.p50_ms,
+        result.p95_ms, result.max_ms);
+    return 0;
+  }
+
+  // lets the previous marker leave the screen before the next one
+  if (now_us - last_done_us_ < kIntervalUs) {
+    return 0;
+  }
+
+  // ids wrap but skip 0, which means no marker
+  waiting_id_ = next_id_;
+  next_id_ = next_id_ == 255 ? 1 : next_id_ + 1;
+  sent_us_ = now_us;
+  return waiting_id_;
+}
+
+bool LatencyProbe::IsWaiting() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return waiting_id_ != 0;
+}
+
+bool LatencyProbe::OnMarker(uint8_t id, int64_t now_us) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (waiting_id_ == 0 || id != waiting_id_) {
+    return false;
+  }
+
+  samples_ms_.push_back((now_us - sent_us_) / 1000.0f);
+  waiting_id_ = 0;
+  last_done_us_ = now_us;
+  return true;
+}
+
+LatencyProbe::Result LatencyProbe::GetResult() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return ResultLocked();
+}
+
+LatencyProbe::Result LatencyProbe::ResultLocked() {
+  Result result;
+  result.running = running_;
+  result.sample_count = (int)samples_ms_.size();
+  result.target_count = target_count_;
+  result.lost_count = lost_count_;
+  if (samples_ms_.empty()) {
+    return result;
+  }
+
+  std::vector<float> sorted = samples_ms_;
+  std::sort(sorted.begin(), sorted.end());
+  result.min_ms = sorted.front();
+  result.p50_ms = sorted[sorted.size() / 2];
+  result.p95_ms = sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)];
+  result.max_ms = sorted.back();
+  return result;
+}
+}  // namespace crossdesk
@@ -0,0 +1,83 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _LATENCY_PROBE_H_
+#define _LATENCY_PROBE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace crossdesk {
+
+// A row of flat luma cells stamped into the top left corner of an NV12
+// frame: a 1010 sync pattern, the 8 bit probe id and an even parity bit.
+// Cells are large and black or white so they survive the encoder.
+class LatencyMarker {
+ public:
+  static constexpr int kCellSize = 16;
+  static constexpr int kCellCount = 13;
+
+ public:
+  // returns false if the frame is too small to carry the marker
+  static bool Stamp(uint8_t* nv12, int width, int height, uint8_t id);
+  // returns the probe id, 0 if the frame carries no marker
+  static uint8_t Detect(const uint8_t* nv12, int width, int height);
+};
+
+// Viewer side of an input-to-photon measurement. Probes are sent one at a
+// time, the next one goes out once the marker of the previous one showed up
+// in a decoded frame or it timed out.
+class LatencyProbe {
+ public:
+  struct Result {
+    bool running = false;
+    int sample_count = 0;
+    int target_count = 0;
+    int lost_count = 0;
+    float min_ms = 0;
+    float p50_ms = 0;
+    float p95_ms = 0;
+    float max_ms = 0;
+  };
+
+ public:
+  LatencyProbe();
+  ~LatencyProbe();
+
+ public:
+  void Start(int sample_count);
+  void Stop();
+
+  // returns the id of the probe to send now, 0 if none is due
+  uint8_t NextProbe(int64_t now_us);
+  // true while a probe waits for its marker, frames are only scanned then
+  bool IsWaiting();
+  // returns true if id completed the outstanding probe
+  bool OnMarker(uint8_t id, int64_t now_us);
+
+  Result GetResult();
+
+ private:
+  Result ResultLocked();
+
+ private:
+  static constexpr int64_t kTimeoutUs = 2000000;
+  static constexpr int64_t kIntervalUs = 300000;
+
+  std::mutex mutex_;
+  bool running_ = false;
+  int target_count_ = 0;
+  int lost_count_ = 0;
+  uint8_t next_id_ = 1;
+  uint8_t waiting_id_ = 0;
+  int64_t sent_us_ = 0;
+  int64_t last_done_us_ = 0;
+  std::vector<float> samples_ms_;
+};
+}  // namespace crossdesk
+#endif
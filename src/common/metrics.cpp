@@ -0,0 +1,248 @@
+#include "metrics.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include "rd_log.h"
+
+namespace crossdesk {
+
+namespace {
+
+void AppendDouble(std::string& out, double value) {
+  if (std::isnan(value)) {
+    out += "NaN";
+  } else if (std::isinf(value)) {
+    out += value > 0 ? "+Inf" : "-Inf";
+  } else {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.15g", value);
+    out += buffer;
+  }
+}
+
+void AppendSeries(std::string& out, const std::string& name,
+                  const std::string& labels, const std::string& extra_label) {
+  out += name;
+  if (!labels.empty() || !extra_label.empty()) {
+    out += '{';
+    out += labels;
+    if (!labels.empty() && !extra_label.empty()) {
+      out += ',';
+    }
+    out += extra_label;
+    out += '}';
+  }
+  out += ' ';
+}
+
+bool HasLabel(const std::string& labels, const std::string& label) {
+  for (size_t pos = labels.find(label); pos != std::string::npos;
+       pos = labels.find(label, pos + 1)) {
+    size_t end = pos + label.size();
+    if ((pos == 0 || labels[pos - 1] == ',') &&
+        (end == labels.size() || labels[end] == ',')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename T>
+void EraseLabel(std::map<std::string, std::shared_ptr<T>>& series,
+                const std::string& label) {
+  for (auto it = series.begin(); it != series.end();) {
+    if (HasLabel(it->first, label)) {
+      it = series.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace
+
+void Gauge::Add(double delta) {
+  double current = value_.load(std::memory_order_relaxed);
+  while (!value_.compare_exchange_weak(current, current + delta,
+                                       std::memory_order_relaxed)) {
+  }
+}
+
+Histogram::Histogram(std::vector<double> bounds)
+    : bounds_(std::move(bounds)),
+      buckets_(new std::atomic<uint64_t>[bounds_.size() + 1]) {
+  for (size_t i = 0; i <= bounds_.size(); ++i) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void Histogram::Observe(double value) {
+  // bucket lists are short, a linear scan beats a binary search here
+  size_t index = 0;
+  while (index < bounds_.size() && value > bounds_[index]) {
+    ++index;
+  }
+  buckets_[index].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+
+  double sum = sum_.load(std::memory_order_relaxed);
+  while (!sum_.compare_exchange_weak(sum, sum + value,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+MetricsRegistry& MetricsRegistry::Instance() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+MetricsRegistry::Family* MetricsRegistry::GetFamily(const std::string& name,
+                                                    const std::string& help,
+                                                    Type type) {
+  auto it = families_.find(name);
+  if (it == families_.end()) {
+    Family family;
+    family.type = type;
+    family.help = help;
+    it = families_.emplace(name, std::move(family)).first;
+  }
+
+  if (it->second.type != type) {
+    LOG_ERROR("Metric [{}] registered with another type", name);
+    return nullptr;
+  }
+  return &it->second;
+}
+
+std::shared_ptr<Counter> MetricsRegistry::GetCounter(
+    const std::string& name, const std::string& help,
+    const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Family* family = GetFamily(name, help, Type::kCounter);
+  if (!family) {
+    // detached, keeps the caller working without being exported
+    return std::make_shared<Counter>();
+  }
+
+  auto& series = family->counters[labels];
+  if (!series) {
+    series = std::make_shared<Counter>();
+  }
+  return series;
+}
+
+std::shared_ptr<Gauge> MetricsRegistry::GetGauge(const std::string& name,
+                                                 const std::string& help,
+                                                 const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Family* family = GetFamily(name, help, Type::kGauge);
+  if (!family) {
+    return std::make_shared<Gauge>();
+  }
+
+  auto& series = family->gauges[labels];
+  if (!series) {
+    series = std::make_shared<Gauge>();
+  }
+  return series;
+}
+
+std::shared_ptr<Histogram> MetricsRegistry::GetHistogram(
+    const std::string& name, const std::string& help,
+    const std::vector<double>& bounds, const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Family* family = GetFamily(name, help, Type::kHistogram);
+  if (!family) {
+    return std::make_shared<Histogram>(bounds);
+  }
+
+  auto& series = family->histograms[labels];
+  if (!series) {
+    series = std::make_shared<Histogram>(bounds);
+  }
+  return series;
+}
+
+void MetricsRegistry::RemoveSeries(const std::string& label) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& [name, family] : families_) {
+    EraseLabel(family.counters, label);
+    EraseLabel(family.gauges, label);
+    EraseLabel(family.histograms, label);
+  }
+}
+
+std::string MetricsRegistry::Serialize() {
+  std::string out;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& [name, family] : families_) {
+    if (family.counters.empty() && family.gauges.empty() &&
+        family.histograms.empty()) {
+      continue;
+    }
+
+    out += "# HELP " + name + " " + family.help + "\n";
+    switch (family.type) {
+      case Type::kCounter:
+        out += "# TYPE " + name + " counter\n";
+        for (auto& [labels, counter] : family.counters) {
+          AppendSeries(out, name, labels, "");
+          out += std::to_string(counter->Value()) + "\n";
+        }
+        break;
+      case Type::kGauge:
+        out += "# TYPE " + name + " gauge\n";
+        for (auto& [labels, gauge] : family.gauges) {
+          AppendSeries(out, name, labels, "");
+          AppendDouble(out, gauge->Value());
+          out += "\n";
+        }
+        break;
+      case Type::kHistogram:
+        out += "# TYPE " + name + " histogram\n";
+        for (auto& [labels, histogram] : family.histograms) {
+          // buckets are read one by one, a scrape racing an update may be
+          // off by one sample which Prometheus tolerates
+          const auto& bounds = histogram->Bounds();
+          uint64_t cumulative = 0;
+          for (size_t i = 0; i <= bounds.size(); ++i) {
+            cumulative += histogram->BucketCount(i);
+            std::string le = "le=\"";
+            if (i < bounds.size()) {
+              AppendDouble(le, bounds[i]);
+            } else {
+              le += "+Inf";
+            }
+            le += "\"";
+            AppendSeries(out, name + "_bucket", labels, le);
+            out += std::to_string(cumulative) + "\n";
+          }
+          AppendSeries(out, name + "_sum", labels, "");
+          AppendDouble(out, histogram->Sum());
+          out += "\n";
+          AppendSeries(out, name + "_count", labels, "");
+          out += std::to_string(cumulative) + "\n";
+        }
+        break;
+    }
+  }
+  return out;
+}
+
+std::string MetricLabel(const std::string& key, const std::string& value) {
+  std::string label = key + "=\"";
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      label += '\\';
+      label += c;
+    } else if (c == '\n') {
+      label += "\\n";
+    } else {
+      label += c;
+    }
+  }
+  label += '"';
+  return label;
+}
+}  // namespace crossdesk
@@ -0,0 +1,114 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace crossdesk {
+
+// Metrics live as long as anyone holds them. Look a series up once, keep the
+// pointer and update it from the hot path: every update is a relaxed atomic
+// operation, the registry lock is only taken by lookups and by scrapes.
+
+class Counter {
+ public:
+  void Increment(uint64_t n = 1) {
+    value_.fetch_add(n, std::memory_order_relaxed);
+  }
+  uint64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> value_{0};
+};
+
+class Gauge {
+ public:
+  void Set(double value) { value_.store(value, std::memory_order_relaxed); }
+  void Add(double delta);
+  double Value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<double> value_{0};
+};
+
+// Fixed upper bounds given at creation, +Inf is implied.
+class Histogram {
+ public:
+  explicit Histogram(std::vector<double> bounds);
+
+  void Observe(double value);
+
+  const std::vector<double>& Bounds() const { return bounds_; }
+  // non cumulative, the last one counts values above every bound
+  uint64_t BucketCount(size_t index) const {
+    return buckets_[index].load(std::memory_order_relaxed);
+  }
+  uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+  double Sum() const { return sum_.load(std::memory_order_relaxed); }
+
+ private:
+  const std::vector<double> bounds_;
+  std::unique_ptr<std::atomic<uint64_t>[]> buckets_;
+  std::atomic<uint64_t> count_{0};
+  std::atomic<double> sum_{0};
+};
+
+class MetricsRegistry {
+ public:
+  static MetricsRegistry& Instance();
+
+  // labels is a preformatted label list, see MetricLabel. The same name and
+  // labels always return the same series.
+  std::shared_ptr<Counter> GetCounter(const std::string& name,
+                                      const std::string& help,
+                                      const std::string& labels = "");
+  std::shared_ptr<Gauge> GetGauge(const std::string& name,
+                                  const std::string& help,
+                                  const std::string& labels = "");
+  std::shared_ptr<Histogram> GetHistogram(const std::string& name,
+                                          const std::string& help,
+                                          const std::vector<double>& bounds,
+                                          const std::string& labels = "");
+
+  // drops every series carrying label, e.g. when a session ends
+  void RemoveSeries(const std::string& label);
+
+  // Prometheus text exposition format 0.0.4
+  std::string Serialize();
+
+ private:
+  enum class Type { kCounter, kGauge, kHistogram };
+
+  struct Family {
+    Type type;
+    std::string help;
+    std::map<std::string, std::shared_ptr<Counter>> counters;
+    std::map<std::string, std::shared_ptr<Gauge>> gauges;
+    std::map<std::string, std::shared_ptr<Histogram>> histograms;
+  };
+
+ private:
+  MetricsRegistry() = default;
+  Family* GetFamily(const std::string& name, const std::string& help,
+                    Type type);
+
+ private:
+  std::mutex mutex_;
+  std::map<std::string, Family> families_;
+};
+
+// key="value" with the value escaped, join several with ','
+std::string MetricLabel(const std::string& key, const std::string& value);
+}  // namespace crossdesk
+#endif
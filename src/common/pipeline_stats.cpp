@@ -0,0 +1,97 @@
+#include "pipeline_stats.h"
+
+#include <algorithm>
+
+namespace crossdesk {
+
+void PipelineStats::Push(History& history, float value) {
+  history.values[history.offset] = value;
+  history.offset = (history.offset + 1) % kHistorySize;
+  history.max = *std::max_element(history.values,
+                                  history.values + kHistorySize);
+}
+
+void PipelineStats::OnFrameReceived(int64_t now_us) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (last_received_us_ > 0) {
+    Push(receive_interval_ms_, (now_us - last_received_us_) / 1000.0f);
+  }
+  last_received_us_ = now_us;
+}
+
+void PipelineStats::OnFrameReady(int64_t received_us, int64_t captured_us) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (ready_received_us_ > 0) {
+    // the render loop did not get to the previous one
+    ++dropped_frames_;
+  }
+  ready_received_us_ = received_us;
+  ready_captured_us_ = captured_us;
+}
+
+void PipelineStats::OnFrameDropped() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++dropped_frames_;
+}
+
+void PipelineStats::OnTextureUploaded(int64_t upload_us) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Push(upload_ms_, upload_us / 1000.0f);
+  if (ready_received_us_ > 0) {
+    uploaded_received_us_ = ready_received_us_;
+    uploaded_captured_us_ = ready_captured_us_;
+    ready_received_us_ = 0;
+  }
+}
+
+void PipelineStats::OnPresented(int64_t now_us) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (uploaded_received_us_ == 0) {
+    // nothing new on screen
+    return;
+  }
+
+  if (last_presented_us_ > 0) {
+    Push(present_interval_ms_, (now_us - last_presented_us_) / 1000.0f);
+  }
+  receive_to_present_ms_ = (now_us - uploaded_received_us_) / 1000.0f;
+  if (uploaded_captured_us_ > 0) {
+    capture_to_present_ms_ = (now_us - uploaded_captured_us_) / 1000.0f;
+  }
+  last_presented_us_ = now_us;
+  uploaded_received_us_ = 0;
+}
+
+void PipelineStats::SetHostCaptureFps(int fps) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  host_capture_fps_ = fps;
+}
+
+void PipelineStats::GetSnapshot(Snapshot* snapshot) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  snapshot->receive_interval_ms = receive_interval_ms_;
+  snapshot->upload_ms = upload_ms_;
+  snapshot->present_interval_ms = present_interval_ms_;
+  snapshot->receive_to_present_ms = receive_to_present_ms_;
+  snapshot->capture_to_present_ms = capture_to_present_ms_;
+  snapshot->dropped_frames = dropped_frames_;
+  snapshot->host_capture_fps = host_capture_fps_;
+}
+
+void PipelineStats::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  receive_interval_ms_ = History();
+  upload_ms_ = History();
+  present_interval_ms_ = History();
+  receive_to_present_ms_ = 0;
+  capture_to_present_ms_ = -1;
+  dropped_frames_ = 0;
+  host_capture_fps_ = 0;
+  last_received_us_ = 0;
+  last_presented_us_ = 0;
+  ready_received_us_ = 0;
+  uploaded_received_us_ = 0;
+  ready_captured_us_ = 0;
+  uploaded_captured_us_ = 0;
+}
+}  // namespace crossdesk
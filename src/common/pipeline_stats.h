@@ -0,0 +1,78 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _PIPELINE_STATS_H_
+#define _PIPELINE_STATS_H_
+
+#include <cstdint>
+#include <mutex>
+
+namespace crossdesk {
+
+// Frame timing of one received video stream, fed from the receive callback
+// and the render loop and read back by the stream HUD. A frame is received,
+// becomes ready once any lip sync delay elapsed, is uploaded to the texture
+// and finally presented. A ready frame replaced before it was uploaded, or
+// dropped from the delay queue, counts as dropped.
+class PipelineStats {
+ public:
+  static constexpr int kHistorySize = 120;
+
+  struct History {
+    float values[kHistorySize] = {};
+    // index of the oldest sample, as ImGui::PlotLines expects
+    int offset = 0;
+    float max = 0;
+  };
+
+  struct Snapshot {
+    History receive_interval_ms;
+    History upload_ms;
+    History present_interval_ms;
+    float receive_to_present_ms = 0;
+    // needs the host clock offset, negative until it is known
+    float capture_to_present_ms = -1;
+    uint64_t dropped_frames = 0;
+    int host_capture_fps = 0;
+  };
+
+ public:
+  void OnFrameReceived(int64_t now_us);
+  // captured_us is the host capture time mapped onto the local clock, 0 if
+  // the clock offset is not known yet
+  void OnFrameReady(int64_t received_us, int64_t captured_us);
+  void OnFrameDropped();
+  void OnTextureUploaded(int64_t upload_us);
+  void OnPresented(int64_t now_us);
+  void SetHostCaptureFps(int fps);
+
+  void GetSnapshot(Snapshot* snapshot);
+  void Reset();
+
+ private:
+  static void Push(History& history, float value);
+
+ private:
+  std::mutex mutex_;
+  History receive_interval_ms_;
+  History upload_ms_;
+  History present_interval_ms_;
+  float receive_to_present_ms_ = 0;
+  float capture_to_present_ms_ = -1;
+  uint64_t dropped_frames_ = 0;
+  int host_capture_fps_ = 0;
+
+  int64_t last_received_us_ = 0;
+  int64_t last_presented_us_ = 0;
+  // received time of the frame waiting for upload, and of the uploaded one
+  // waiting for present, 0 when there is none
+  int64_t ready_received_us_ = 0;
+  int64_t uploaded_received_us_ = 0;
+  int64_t ready_captured_us_ = 0;
+  int64_t uploaded_captured_us_ = 0;
+};
+}  // namespace crossdesk
+#endif
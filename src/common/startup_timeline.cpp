@@ -0,0 +1,56 @@
+#include "startup_timeline.h"
+
+#include "rd_log.h"
+#include "trace.h"
+
+namespace crossdesk {
+
+namespace {
+
+// initialized during static init, the closest portable stand in for the
+// process start time
+const std::chrono::steady_clock::time_point kProcessLaunchTime =
+    std::chrono::steady_clock::now();
+
+}  // namespace
+
+StartupTimeline::StartupTimeline() : launch_time_(kProcessLaunchTime) {}
+
+int64_t StartupTimeline::ElapsedMs() const {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - launch_time_)
+      .count();
+}
+
+int64_t StartupTimeline::Mark(const char* phase) {
+  TRACE_INSTANT(phase);
+  int64_t at_ms = ElapsedMs();
+  std::lock_guard<std::mutex> lock(mutex_);
+  phases_.push_back({phase, at_ms});
+  return at_ms;
+}
+
+void StartupTimeline::Report(int64_t budget_ms) {
+  std::string timeline;
+  int64_t last_ms = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t previous_ms = 0;
+    for (const Phase& phase : phases_) {
+      if (!timeline.empty()) {
+        timeline += ", ";
+      }
+      timeline += phase.name;
+      timeline += " " + std::to_string(phase.at_ms) + " ms (+" +
+                  std::to_string(phase.at_ms - previous_ms) + ")";
+      previous_ms = phase.at_ms;
+    }
+    last_ms = previous_ms;
+  }
+
+  LOG_INFO("Startup timeline: {}", timeline);
+  if (last_ms > budget_ms) {
+    LOG_WARN("Startup took {} ms, over the {} ms budget", last_ms, budget_ms);
+  }
+}
+}  // namespace crossdesk
@@ -0,0 +1,44 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _STARTUP_TIMELINE_H_
+#define _STARTUP_TIMELINE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace crossdesk {
+
+// Milestones of the startup sequence measured from process launch. Marks are
+// buffered because the first ones are taken before the logger exists, Report
+// logs the whole timeline as one line.
+class StartupTimeline {
+ public:
+  StartupTimeline();
+
+  // returns the milliseconds since launch
+  int64_t Mark(const char* phase);
+  int64_t ElapsedMs() const;
+
+  // logs the phases marked so far and warns when budget_ms was exceeded
+  void Report(int64_t budget_ms);
+
+ private:
+  struct Phase {
+    const char* name;
+    int64_t at_ms;
+  };
+
+ private:
+  std::chrono::steady_clock::time_point launch_time_;
+  std::mutex mutex_;
+  std::vector<Phase> phases_;
+};
+}  // namespace crossdesk
+#endif
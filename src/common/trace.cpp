@@ -0,0 +1,193 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include "rd_log.h"
+
+namespace crossdesk {
+
+namespace {
+
+void WriteJsonString(FILE* file, const char* str) {
+  fputc('"', file);
+  for (const char* p = str ? str : ""; *p; ++p) {
+    if (*p == '"' || *p == '\\') {
+      fputc('\\', file);
+    }
+    fputc(*p, file);
+  }
+  fputc('"', file);
+}
+
+}  // namespace
+
+Tracer& Tracer::Instance() {
+  static Tracer tracer;
+  return tracer;
+}
+
+int64_t Tracer::NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Tracer::SetEnabled(bool enabled) {
+  if (enabled_.exchange(enabled) != enabled) {
+    LOG_INFO("Tracing {}", enabled ? "enabled" : "disabled");
+  }
+}
+
+Tracer::ThreadRing* Tracer::CurrentRing() {
+  // hands the ring back to the tracer when the thread exits
+  struct RingHolder {
+    std::shared_ptr<ThreadRing> ring;
+    ~RingHolder() {
+      if (ring) {
+        Tracer::Instance().RetireRing(ring);
+      }
+    }
+  };
+  thread_local RingHolder holder;
+  if (!holder.ring) {
+    holder.ring = std::make_shared<ThreadRing>();
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    holder.ring->tid = next_tid_++;
+    rings_.push_back(holder.ring);
+  }
+  return holder.ring.get();
+}
+
+void Tracer::RetireRing(const std::shared_ptr<ThreadRing>& ring) {
+  std::lock_guard<std::mutex> lock(rings_mutex_);
+  rings_.erase(std::remove(rings_.begin(), rings_.end(), ring), rings_.end());
+
+  bool has_events = false;
+  {
+    std::lock_guard<std::mutex> ring_lock(ring->mutex);
+    has_events = ring->written > 0;
+  }
+  if (!has_events) {
+    return;
+  }
+  retired_rings_.push_back(ring);
+  while (retired_rings_.size() > kMaxRetiredRings) {
+    retired_rings_.pop_front();
+  }
+}
+
+void Tracer::SetThreadName(const char* name) {
+  ThreadRing* ring = CurrentRing();
+  std::lock_guard<std::mutex> lock(ring->mutex);
+  ring->name = name;
+}
+
+void Tracer::Append(const Event& event) {
+  ThreadRing* ring = CurrentRing();
+  std::lock_guard<std::mutex> lock(ring->mutex);
+  if (ring->events.empty()) {
+    // only threads that actually trace pay for a ring
+    ring->events.resize(kRingSize);
+  }
+  ring->events[ring->written % kRingSize] = event;
+  ++ring->written;
+}
+
+void Tracer::Complete(const char* name, int64_t begin_us,
+                      int64_t duration_us) {
+  if (!IsEnabled()) {
+    return;
+  }
+  Append({name, begin_us, duration_us});
+}
+
+void Tracer::Instant(const char* name) {
+  if (!IsEnabled()) {
+    return;
+  }
+  Append({name, NowUs(), -1});
+}
+
+int Tracer::DumpChromeJson(const std::string& path) {
+  std::vector<std::shared_ptr<ThreadRing>> rings;
+  {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    rings = rings_;
+    rings.insert(rings.end(), retired_rings_.begin(), retired_rings_.end());
+  }
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file) {
+    LOG_ERROR("Failed to open trace file: {}", path);
+    return -1;
+  }
+
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+  bool first = true;
+  size_t event_count = 0;
+  std::vector<Event> events;
+  for (auto& ring : rings) {
+    const char* thread_name = nullptr;
+    {
+      // copy out so the traced thread is only blocked for the copy
+      std::lock_guard<std::mutex> lock(ring->mutex);
+      size_t count = (size_t)std::min<uint64_t>(ring->written, kRingSize);
+      uint64_t start = ring->written - count;
+      events.resize(count);
+      for (size_t i = 0; i < count; ++i) {
+        events[i] = ring->events[(start + i) % kRingSize];
+      }
+      thread_name = ring->name;
+    }
+
+    if (thread_name) {
+      fprintf(file,
+              "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\","
+              "\"args\":{\"name\":",
+              first ? "" : ",\n", ring->tid);
+      WriteJsonString(file, thread_name);
+      fputs("}}", file);
+      first = false;
+    }
+
+    for (const Event& event : events) {
+      fputs(first ? "{\"name\":" : ",\n{\"name\":", file);
+      WriteJsonString(file, event.name);
+      if (event.duration_us < 0) {
+        fprintf(file,
+                ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,\"pid\":1,\"tid\":%u}",
+                (long long)event.begin_us, ring->tid);
+      } else {
+        fprintf(file,
+                ",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,"
+                "\"tid\":%u}",
+                (long long)event.begin_us, (long long)event.duration_us,
+                ring->tid);
+      }
+      first = false;
+    }
+    event_count += events.size();
+  }
+  fputs("\n]}\n", file);
+
+  if (fclose(file) != 0) {
+    LOG_ERROR("Failed to write trace file: {}", path);
+    return -1;
+  }
+
+  LOG_INFO("Wrote {} trace events from {} threads to {}", event_count,
+           rings.size(), path);
+  return 0;
+}
+
+void Tracer::Clear() {
+  std::lock_guard<std::mutex> lock(rings_mutex_);
+  for (auto& ring : rings_) {
+    std::lock_guard<std::mutex> ring_lock(ring->mutex);
+    ring->written = 0;
+  }
+  retired_rings_.clear();
+}
+}  // namespace crossdesk
@@ -0,0 +1,113 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace crossdesk {
+
+// Pipeline tracing that dumps to the Chrome trace event format, open the file
+// in chrome://tracing or ui.perfetto.dev. Every thread records into its own
+// ring buffer so the hot path is a clock read and an uncontended lock. When
+// tracing is off a span costs one relaxed atomic load.
+//
+// Span names must be string literals, only the pointer is stored.
+class Tracer {
+ public:
+  static Tracer& Instance();
+
+  void SetEnabled(bool enabled);
+  bool IsEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // optional, shows up as the thread name in the viewer
+  void SetThreadName(const char* name);
+
+  void Complete(const char* name, int64_t begin_us, int64_t duration_us);
+  void Instant(const char* name);
+
+  // writes the events still held by the rings, returns 0 on success
+  int DumpChromeJson(const std::string& path);
+  void Clear();
+
+  static int64_t NowUs();
+
+ private:
+  struct Event {
+    const char* name;
+    int64_t begin_us;
+    // -1 marks an instant event
+    int64_t duration_us;
+  };
+
+  struct ThreadRing {
+    std::mutex mutex;
+    std::vector<Event> events;
+    uint64_t written = 0;
+    uint32_t tid = 0;
+    const char* name = nullptr;
+  };
+
+ private:
+  Tracer() = default;
+  ThreadRing* CurrentRing();
+  void Append(const Event& event);
+  // called when the owning thread exits
+  void RetireRing(const std::shared_ptr<ThreadRing>& ring);
+
+ private:
+  static constexpr size_t kRingSize = 16384;
+  // rings of exited threads kept for late dumps, the oldest go first
+  static constexpr size_t kMaxRetiredRings = 16;
+
+  std::atomic<bool> enabled_{false};
+  std::mutex rings_mutex_;
+  std::vector<std::shared_ptr<ThreadRing>> rings_;
+  // short lived threads come and go all the time, only the latest are kept
+  std::deque<std::shared_ptr<ThreadRing>> retired_rings_;
+  uint32_t next_tid_ = 1;
+};
+
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name)
+      : name_(Tracer::Instance().IsEnabled() ? name : nullptr),
+        begin_us_(name_ ? Tracer::NowUs() : 0) {}
+
+  ~TraceScope() {
+    if (name_) {
+      Tracer::Instance().Complete(name_, begin_us_,
+                                  Tracer::NowUs() - begin_us_);
+    }
+  }
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const char* name_;
+  int64_t begin_us_;
+};
+
+#define TRACE_CONCAT_INNER_(a, b) a##b
+#define TRACE_CONCAT_(a, b) TRACE_CONCAT_INNER_(a, b)
+#define TRACE_SCOPE(name) \
+  crossdesk::TraceScope TRACE_CONCAT_(trace_scope_, __LINE__)(name)
+#define TRACE_INSTANT(name)                        \
+  do {                                             \
+    if (crossdesk::Tracer::Instance().IsEnabled()) { \
+      crossdesk::Tracer::Instance().Instant(name);   \
+    }                                              \
+  } while (0)
+}  // namespace crossdesk
+#endif
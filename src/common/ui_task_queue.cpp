@@ -0,0 +1,23 @@
+#include "ui_task_queue.h"
+
+namespace crossdesk {
+
+void UiTaskQueue::Post(std::function<void()> task) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  tasks_.push_back(std::move(task));
+}
+
+size_t UiTaskQueue::RunPending() {
+  std::vector<std::function<void()>> tasks;
+  {
+    // swapped out so tasks may post follow ups without deadlocking
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks.swap(tasks_);
+  }
+
+  for (auto& task : tasks) {
+    task();
+  }
+  return tasks.size();
+}
+}  // namespace crossdesk
@@ -0,0 +1,32 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _UI_TASK_QUEUE_H_
+#define _UI_TASK_QUEUE_H_
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace crossdesk {
+
+// Hands results of background work back to the UI thread, which drains the
+// queue once per frame. Background tasks should hold the queue through a
+// shared_ptr: once the owner stopped draining, posting is still safe and the
+// task is simply never run.
+class UiTaskQueue {
+ public:
+  void Post(std::function<void()> task);
+
+  // runs every task posted so far, call from the UI thread only
+  size_t RunPending();
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::function<void()>> tasks_;
+};
+}  // namespace crossdesk
+#endif
@@ -36,6 +36,13 @@ int ConfigCenter::Load() {
       ini_.GetLongValue(section_, "video_encode_format",
                         static_cast<long>(video_encode_format_)));
 
+  audio_channels_ = static_cast<AUDIO_CHANNELS>(ini_.GetLongValue(
+      section_, "audio_channels", static_cast<long>(audio_channels_)));
+
+  audio_frame_duration_ = static_cast<AUDIO_FRAME_DURATION>(
+      ini_.GetLongValue(section_, "audio_frame_duration",
+                        static_cast<long>(audio_frame_duration_)));
+
   hardware_video_codec_ = ini_.GetBoolValue(section_, "hardware_video_codec",
                                             hardware_video_codec_);
 
@@ -56,6 +63,10 @@ int ConfigCenter::Load() {
   enable_daemon_ = ini_.GetBoolValue(section_, "enable_daemon", enable_daemon_);
   enable_minimize_to_tray_ = ini_.GetBoolValue(
       section_, "enable_minimize_to_tray", enable_minimize_to_tray_);
+  skip_background_audio_ = ini_.GetBoolValue(
+      section_, "skip_background_audio", skip_background_audio_);
+  metrics_port_ = static_cast<int>(
+      ini_.GetLongValue(section_, "metrics_port", metrics_port_));
 
   return 0;
 }
@@ -68,6 +79,10 @@ int ConfigCenter::Save() {
                     static_cast<long>(video_frame_rate_));
   ini_.SetLongValue(section_, "video_encode_format",
                     static_cast<long>(video_encode_format_));
+  ini_.SetLongValue(section_, "audio_channels",
+                    static_cast<long>(audio_channels_));
+  ini_.SetLongValue(section_, "audio_frame_duration",
+                    static_cast<long>(audio_frame_duration_));
   ini_.SetBoolValue(section_, "hardware_video_codec", hardware_video_codec_);
   ini_.SetBoolValue(section_, "enable_turn", enable_turn_);
   ini_.SetBoolValue(section_, "enable_srtp", enable_srtp_);
@@ -80,6 +95,8 @@ int ConfigCenter::Save() {
   ini_.SetBoolValue(section_, "enable_daemon", enable_daemon_);
   ini_.SetBoolValue(section_, "enable_minimize_to_tray",
                     enable_minimize_to_tray_);
+  ini_.SetBoolValue(section_, "skip_background_audio", skip_background_audio_);
+  ini_.SetLongValue(section_, "metrics_port", static_cast<long>(metrics_port_));
 
   SI_Error rc = ini_.SaveFile(config_path_.c_str());
   if (rc < 0) {
@@ -135,6 +152,29 @@ int ConfigCenter::SetVideoEncodeFormat(
   return 0;
 }
 
+int ConfigCenter::SetAudioChannels(AUDIO_CHANNELS audio_channels) {
+  audio_channels_ = audio_channels;
+  ini_.SetLongValue(section_, "audio_channels",
+                    static_cast<long>(audio_channels_));
+  SI_Error rc = ini_.SaveFile(config_path_.c_str());
+  if (rc < 0) {
+    return -1;
+  }
+  return 0;
+}
+
+int ConfigCenter::SetAudioFrameDuration(
+    AUDIO_FRAME_DURATION audio_frame_duration) {
+  audio_frame_duration_ = audio_frame_duration;
+  ini_.SetLongValue(section_, "audio_frame_duration",
+                    static_cast<long>(audio_frame_duration_));
+  SI_Error rc = ini_.SaveFile(config_path_.c_str());
+  if (rc < 0) {
+    return -1;
+  }
+  return 0;
+}
+
 int ConfigCenter::SetHardwareVideoCodec(bool hardware_video_codec) {
   hardware_video_codec_ = hardware_video_codec;
   ini_.SetBoolValue(section_, "hardware_video_codec", hardware_video_codec_);
@@ -263,6 +303,28 @@ int ConfigCenter::SetDaemon(bool enable_daemon) {
   return 0;
 }
 
+int ConfigCenter::SetSkipBackgroundAudio(bool skip_background_audio) {
+  skip_background_audio_ = skip_background_audio;
+
+  ini_.SetBoolValue(section_, "skip_background_audio", skip_background_audio_);
+  SI_Error rc = ini_.SaveFile(config_path_.c_str());
+  if (rc < 0) {
+    return -1;
+  }
+
+  return 0;
+}
+
+int ConfigCenter::SetMetricsPort(int metrics_port) {
+  metrics_port_ = metrics_port;
+  ini_.SetLongValue(section_, "metrics_port", static_cast<long>(metrics_port_));
+  SI_Error rc = ini_.SaveFile(config_path_.c_str());
+  if (rc < 0) {
+    return -1;
+  }
+  return 0;
+}
+
 // getters
 
 ConfigCenter::LANGUAGE ConfigCenter::GetLanguage() const { return language_; }
@@ -279,6 +341,15 @@ ConfigCenter::VIDEO_ENCODE_FORMAT ConfigCenter::GetVideoEncodeFormat() const {
   return video_encode_format_;
 }
 
+ConfigCenter::AUDIO_CHANNELS ConfigCenter::GetAudioChannels() const {
+  return audio_channels_;
+}
+
+ConfigCenter::AUDIO_FRAME_DURATION ConfigCenter::GetAudioFrameDuration()
+    const {
+  return audio_frame_duration_;
+}
+
 bool ConfigCenter::IsHardwareVideoCodec() const {
   return hardware_video_codec_;
 }
@@ -320,4 +391,10 @@ bool ConfigCenter::IsMinimizeToTray() const { return enable_minimize_to_tray_; }
 bool ConfigCenter::IsEnableAutostart() const { return enable_autostart_; }
 
 bool ConfigCenter::IsEnableDaemon() const { return enable_daemon_; }
+
+bool ConfigCenter::IsSkipBackgroundAudio() const {
+  return skip_background_audio_;
+}
+
+int ConfigCenter::GetMetricsPort() const { return metrics_port_; }
 }  // namespace crossdesk
\ No newline at end of file
@@ -19,6 +19,8 @@ class ConfigCenter {
   enum class VIDEO_QUALITY { LOW = 0, MEDIUM = 1, HIGH = 2 };
   enum class VIDEO_FRAME_RATE { FPS_30 = 0, FPS_60 = 1 };
   enum class VIDEO_ENCODE_FORMAT { H264 = 0, AV1 = 1 };
+  enum class AUDIO_CHANNELS { MONO = 0, STEREO = 1 };
+  enum class AUDIO_FRAME_DURATION { MS_10 = 0, MS_20 = 1, MS_40 = 2 };
 
  public:
   explicit ConfigCenter(
@@ -31,6 +33,8 @@ class ConfigCenter {
   int SetVideoQuality(VIDEO_QUALITY video_quality);
   int SetVideoFrameRate(VIDEO_FRAME_RATE video_frame_rate);
   int SetVideoEncodeFormat(VIDEO_ENCODE_FORMAT video_encode_format);
+  int SetAudioChannels(AUDIO_CHANNELS audio_channels);
+  int SetAudioFrameDuration(AUDIO_FRAME_DURATION audio_frame_duration);
   int SetHardwareVideoCodec(bool hardware_video_codec);
   int SetTurn(bool enable_turn);
   int SetSrtp(bool enable_srtp);
@@ -42,6 +46,8 @@ class ConfigCenter {
   int SetMinimizeToTray(bool enable_minimize_to_tray);
   int SetAutostart(bool enable_autostart);
   int SetDaemon(bool enable_daemon);
+  int SetSkipBackgroundAudio(bool skip_background_audio);
+  int SetMetricsPort(int metrics_port);
 
   // read config
 
@@ -49,6 +55,8 @@ class ConfigCenter {
   VIDEO_QUALITY GetVideoQuality() const;
   VIDEO_FRAME_RATE GetVideoFrameRate() const;
   VIDEO_ENCODE_FORMAT GetVideoEncodeFormat() const;
+  AUDIO_CHANNELS GetAudioChannels() const;
+  AUDIO_FRAME_DURATION GetAudioFrameDuration() const;
   bool IsHardwareVideoCodec() const;
   bool IsEnableTurn() const;
   bool IsEnableSrtp() const;
@@ -64,6 +72,8 @@ class ConfigCenter {
   bool IsMinimizeToTray() const;
   bool IsEnableAutostart() const;
   bool IsEnableDaemon() const;
+  bool IsSkipBackgroundAudio() const;
+  int GetMetricsPort() const;
 
   int Load();
   int Save();
@@ -78,6 +88,8 @@ class ConfigCenter {
   VIDEO_QUALITY video_quality_ = VIDEO_QUALITY::MEDIUM;
   VIDEO_FRAME_RATE video_frame_rate_ = VIDEO_FRAME_RATE::FPS_60;
   VIDEO_ENCODE_FORMAT video_encode_format_ = VIDEO_ENCODE_FORMAT::H264;
+  AUDIO_CHANNELS audio_channels_ = AUDIO_CHANNELS::MONO;
+  AUDIO_FRAME_DURATION audio_frame_duration_ = AUDIO_FRAME_DURATION::MS_10;
   bool hardware_video_codec_ = false;
   bool enable_turn_ = true;
   bool enable_srtp_ = false;
@@ -92,6 +104,10 @@ class ConfigCenter {
   bool enable_minimize_to_tray_ = false;
   bool enable_autostart_ = false;
   bool enable_daemon_ = false;
+  // ask hosts of unselected tabs to stop capturing audio
+  bool skip_background_audio_ = false;
+  // loopback /metrics endpoint, 0 keeps it off
+  int metrics_port_ = 0;
 };
 }  // namespace crossdesk
 #endif
\ No newline at end of file
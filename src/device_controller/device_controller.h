@@ -23,6 +23,13 @@ typedef enum {
   audio_capture,
   host_infomation,
   display_id,
+  audio_dtx,
+  audio_format,
+  capture_fps,
+  clock_ping,
+  clock_pong,
+  latency_probe,
+  audio_timestamp,
 } ControlType;
 typedef enum {
   move = 0,
@@ -48,6 +55,20 @@ typedef struct {
   KeyFlag flag;
 } Key;
 
+typedef struct {
+  int channels;
+  int frame_duration_ms;
+} AudioFormat;
+
+// t0 is stamped by the viewer, t1 and t2 by the host on receive and send
+typedef struct {
+  int64_t t0;
+  int64_t t1;
+  int64_t t2;
+  // host measured input delivery latency of the asking viewer, -1 if unknown
+  int64_t input_latency_us;
+} ClockSync;
+
 typedef struct {
   char host_name[64];
   size_t host_name_size;
@@ -67,7 +88,12 @@ struct RemoteAction {
     HostInfo i;
     bool a;
     int d;
+    AudioFormat f;
+    ClockSync c;
   };
+  // send time of an input event or capture time of an audio frame on the
+  // host clock, 0 when unknown
+  int64_t timestamp = 0;
 
   // parse
   std::string to_json() const { return ToJson(*this); }
@@ -82,6 +108,9 @@ struct RemoteAction {
   static std::string ToJson(const RemoteAction& a) {
     json j;
     j["type"] = a.type;
+    if (a.timestamp != 0) {
+      j["ts"] = a.timestamp;
+    }
     switch (a.type) {
       case ControlType::mouse:
         j["mouse"] = {
@@ -96,6 +125,29 @@ struct RemoteAction {
       case ControlType::display_id:
         j["display_id"] = a.d;
         break;
+      case ControlType::capture_fps:
+        j["capture_fps"] = a.d;
+        break;
+      case ControlType::latency_probe:
+        j["latency_probe"] = a.d;
+        break;
+      case ControlType::clock_ping:
+      case ControlType::clock_pong:
+        j["clock_sync"] = {{"t0", a.c.t0},
+                           {"t1", a.c.t1},
+                           {"t2", a.c.t2},
+                           {"input_latency_us", a.c.input_latency_us}};
+        break;
+      case ControlType::audio_dtx:
+        j["audio_dtx"] = a.a;
+        break;
+      case ControlType::audio_timestamp:
+        // carried in ts
+        break;
+      case ControlType::audio_format:
+        j["audio_format"] = {{"channels", a.f.channels},
+                             {"frame_duration_ms", a.f.frame_duration_ms}};
+        break;
       case ControlType::host_infomation: {
         json displays = json::array();
         for (size_t idx = 0; idx < a.i.display_num; idx++) {
@@ -120,6 +172,9 @@ struct RemoteAction {
     try {
       json j = json::parse(json_str);
       out.type = (ControlType)j.at("type").get<int>();
+      if (j.contains("ts")) {
+        out.timestamp = j.at("ts").get<int64_t>();
+      }
       switch (out.type) {
         case ControlType::mouse:
           out.m.x = j.at("mouse").at("x").get<float>();
@@ -137,6 +192,30 @@ struct RemoteAction {
         case ControlType::display_id:
           out.d = j.at("display_id").get<int>();
           break;
+        case ControlType::capture_fps:
+          out.d = j.at("capture_fps").get<int>();
+          break;
+        case ControlType::latency_probe:
+          out.d = j.at("latency_probe").get<int>();
+          break;
+        case ControlType::clock_ping:
+        case ControlType::clock_pong:
+          out.c.t0 = j.at("clock_sync").at("t0").get<int64_t>();
+          out.c.t1 = j.at("clock_sync").at("t1").get<int64_t>();
+          out.c.t2 = j.at("clock_sync").at("t2").get<int64_t>();
+          out.c.input_latency_us =
+              j.at("clock_sync").at("input_latency_us").get<int64_t>();
+          break;
+        case ControlType::audio_dtx:
+          out.a = j.at("audio_dtx").get<bool>();
+          break;
+        case ControlType::audio_timestamp:
+          break;
+        case ControlType::audio_format:
+          out.f.channels = j.at("audio_format").at("channels").get<int>();
+          out.f.frame_duration_ms =
+              j.at("audio_format").at("frame_duration_ms").get<int>();
+          break;
         case ControlType::host_infomation: {
           std::string host_name =
               j.at("host_info").at("host_name").get<std::string>();
@@ -1,66 +1,234 @@
 #include "keyboard_capturer.h"
 
-#include "keyboard_converter.h"
+#include <X11/extensions/XInput2.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 #include "rd_log.h"
 
 namespace crossdesk {
 
-static OnKeyAction g_on_key_action = nullptr;
-static void* g_user_ptr = nullptr;
-
-static int KeyboardEventHandler(Display* display, XEvent* event) {
-  if (event->xkey.type == KeyPress || event->xkey.type == KeyRelease) {
-    KeySym keySym = XKeycodeToKeysym(display, event->xkey.keycode, 0);
-    int key_code = XKeysymToKeycode(display, keySym);
-    bool is_key_down = (event->xkey.type == KeyPress);
-
-    if (g_on_key_action) {
-      g_on_key_action(key_code, is_key_down, g_user_ptr);
-    }
-  }
-  return 0;
-}
-
-KeyboardCapturer::KeyboardCapturer() : display_(nullptr), running_(true) {
+KeyboardCapturer::KeyboardCapturer() : display_(nullptr), root_(0) {
   display_ = XOpenDisplay(nullptr);
   if (!display_) {
     LOG_ERROR("Failed to open X display.");
+    return;
   }
+
+  root_ = DefaultRootWindow(display_);
+  BuildKeycodeCache();
 }
 
 KeyboardCapturer::~KeyboardCapturer() {
+  Unhook();
+
   if (display_) {
     XCloseDisplay(display_);
   }
 }
 
+void KeyboardCapturer::BuildKeycodeCache() {
+  vk_code_to_keycode_.fill(0);
+  for (int vk_code = 0; vk_code < (int)vk_code_to_keycode_.size(); ++vk_code) {
+    int key_sym = VkCodeToX11KeySym(vk_code);
+    if (key_sym != kInvalidKeyCode) {
+      vk_code_to_keycode_[vk_code] = XKeysymToKeycode(display_, key_sym);
+    }
+  }
+}
+
+void KeyboardCapturer::BuildHookKeycodeCache() {
+  keycode_to_vk_code_.fill(kInvalidKeyCode);
+
+  int min_keycode = 0;
+  int max_keycode = 0;
+  XDisplayKeycodes(hook_display_, &min_keycode, &max_keycode);
+
+  int keysyms_per_keycode = 0;
+  KeySym* keysyms =
+      XGetKeyboardMapping(hook_display_, (KeyCode)min_keycode,
+                          max_keycode - min_keycode + 1, &keysyms_per_keycode);
+  if (!keysyms) {
+    LOG_ERROR("Failed to get keyboard mapping");
+    return;
+  }
+
+  for (int keycode = min_keycode;
+       keycode <= max_keycode && keycode < (int)keycode_to_vk_code_.size();
+       ++keycode) {
+    KeySym* keycode_syms =
+        keysyms + (keycode - min_keycode) * keysyms_per_keycode;
+    KeySym key_sym = keycode_syms[0];
+    if (key_sym == NoSymbol) {
+      continue;
+    }
+    // keypad digits sit behind Num Lock, the first level is KP_Home etc.
+    if (keysyms_per_keycode > 1 &&
+        ((keycode_syms[1] >= XK_KP_0 && keycode_syms[1] <= XK_KP_9) ||
+         keycode_syms[1] == XK_KP_Decimal)) {
+      key_sym = keycode_syms[1];
+    }
+
+    // the vkCode tables are keyed by upper case letters
+    KeySym lower = NoSymbol;
+    KeySym upper = NoSymbol;
+    XConvertCase(key_sym, &lower, &upper);
+    keycode_to_vk_code_[keycode] = X11KeySymToVkCode((int)upper);
+  }
+
+  XFree(keysyms);
+}
+
 int KeyboardCapturer::Hook(OnKeyAction on_key_action, void* user_ptr) {
-  g_on_key_action = on_key_action;
-  g_user_ptr = user_ptr;
+  if (hooked_) {
+    return 0;
+  }
 
-  XSelectInput(display_, DefaultRootWindow(display_),
-               KeyPressMask | KeyReleaseMask);
+  hook_display_ = XOpenDisplay(nullptr);
+  if (!hook_display_) {
+    LOG_ERROR("Failed to open X display for keyboard hook");
+    return -1;
+  }
+
+  int event_base = 0;
+  int error_base = 0;
+  int major = 2;
+  int minor = 0;
+  if (!XQueryExtension(hook_display_, "XInputExtension", &xi_opcode_,
+                       &event_base, &error_base) ||
+      XIQueryVersion(hook_display_, &major, &minor) != Success) {
+    LOG_ERROR("XInput2 is not available");
+    XCloseDisplay(hook_display_);
+    hook_display_ = nullptr;
+    return -1;
+  }
 
-  while (running_) {
-    XEvent event;
-    XNextEvent(display_, &event);
-    KeyboardEventHandler(display_, &event);
+  wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeup_fd_ < 0) {
+    LOG_ERROR("Failed to create eventfd, errno: {}", errno);
+    XCloseDisplay(hook_display_);
+    hook_display_ = nullptr;
+    return -1;
   }
 
+  unsigned char mask_bits[XIMaskLen(XI_LASTEVENT)] = {0};
+  XIEventMask mask;
+  mask.deviceid = XIAllMasterDevices;
+  mask.mask_len = sizeof(mask_bits);
+  mask.mask = mask_bits;
+  XISetMask(mask_bits, XI_RawKeyPress);
+  XISetMask(mask_bits, XI_RawKeyRelease);
+  XISelectEvents(hook_display_, DefaultRootWindow(hook_display_), &mask, 1);
+  XFlush(hook_display_);
+
+  BuildHookKeycodeCache();
+
+  on_key_action_ = on_key_action;
+  user_ptr_ = user_ptr;
+  hooked_ = true;
+  hook_thread_ = std::thread([this]() { HookLoop(); });
+
   return 0;
 }
 
+void KeyboardCapturer::HookLoop() {
+  pollfd fds[2];
+  fds[0].fd = ConnectionNumber(hook_display_);
+  fds[0].events = POLLIN;
+  fds[1].fd = wakeup_fd_;
+  fds[1].events = POLLIN;
+
+  while (hooked_) {
+    // drain what Xlib has already read before blocking on the socket
+    while (XPending(hook_display_) > 0) {
+      XEvent event;
+      XNextEvent(hook_display_, &event);
+      HandleHookEvent(&event);
+    }
+
+    fds[0].revents = 0;
+    fds[1].revents = 0;
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_ERROR("Keyboard hook poll failed, errno: {}", errno);
+      break;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      break;
+    }
+
+    if (fds[0].revents & (POLLHUP | POLLERR)) {
+      LOG_ERROR("Keyboard hook lost X connection");
+      break;
+    }
+  }
+}
+
+void KeyboardCapturer::HandleHookEvent(XEvent* event) {
+  if (event->type == MappingNotify) {
+    XRefreshKeyboardMapping(&event->xmapping);
+    BuildHookKeycodeCache();
+    return;
+  }
+
+  XGenericEventCookie* cookie = &event->xcookie;
+  if (cookie->type != GenericEvent || cookie->extension != xi_opcode_) {
+    return;
+  }
+
+  if (cookie->evtype != XI_RawKeyPress && cookie->evtype != XI_RawKeyRelease) {
+    return;
+  }
+
+  if (!XGetEventData(hook_display_, cookie)) {
+    return;
+  }
+
+  XIRawEvent* raw_event = static_cast<XIRawEvent*>(cookie->data);
+  int keycode = raw_event->detail;
+  bool is_key_down = cookie->evtype == XI_RawKeyPress;
+  XFreeEventData(hook_display_, cookie);
+
+  if (keycode < 0 || keycode >= (int)keycode_to_vk_code_.size()) {
+    return;
+  }
+
+  int vk_code = keycode_to_vk_code_[keycode];
+  if (vk_code != kInvalidKeyCode && on_key_action_) {
+    on_key_action_(vk_code, is_key_down, user_ptr_);
+  }
+}
+
 int KeyboardCapturer::Unhook() {
-  g_on_key_action = nullptr;
-  g_user_ptr = nullptr;
+  if (!hooked_) {
+    return 0;
+  }
 
-  running_ = false;
+  hooked_ = false;
 
-  if (display_) {
-    XSelectInput(display_, DefaultRootWindow(display_), 0);
-    XFlush(display_);
+  uint64_t value = 1;
+  if (write(wakeup_fd_, &value, sizeof(value)) < 0) {
+    LOG_ERROR("Failed to wake keyboard hook, errno: {}", errno);
+  }
+
+  if (hook_thread_.joinable()) {
+    hook_thread_.join();
   }
 
+  on_key_action_ = nullptr;
+  user_ptr_ = nullptr;
+
+  close(wakeup_fd_);
+  wakeup_fd_ = -1;
+
+  XCloseDisplay(hook_display_);
+  hook_display_ = nullptr;
+
   return 0;
 }
 
@@ -70,12 +238,15 @@ int KeyboardCapturer::SendKeyboardCommand(int key_code, bool is_down) {
     return -1;
   }
 
-  if (vkCodeToX11KeySym.find(key_code) != vkCodeToX11KeySym.end()) {
-    int x11_key_code = vkCodeToX11KeySym[key_code];
-    KeyCode keycode = XKeysymToKeycode(display_, x11_key_code);
+  if (key_code < 0 || key_code >= (int)vk_code_to_keycode_.size()) {
+    return 0;
+  }
+
+  KeyCode keycode = vk_code_to_keycode_[key_code];
+  if (keycode != 0) {
     XTestFakeKeyEvent(display_, keycode, is_down, CurrentTime);
     XFlush(display_);
   }
   return 0;
 }
-}  // namespace crossdesk
\ No newline at end of file
+}  // namespace crossdesk
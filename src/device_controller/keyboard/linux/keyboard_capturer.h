@@ -11,7 +11,12 @@
 #include <X11/extensions/XTest.h>
 #include <X11/keysym.h>
 
+#include <array>
+#include <atomic>
+#include <thread>
+
 #include "device_controller.h"
+#include "keyboard_converter.h"
 
 namespace crossdesk {
 
@@ -26,9 +31,28 @@ class KeyboardCapturer : public DeviceController {
   virtual int SendKeyboardCommand(int key_code, bool is_down);
 
  private:
+  void BuildKeycodeCache();
+  void BuildHookKeycodeCache();
+  void HookLoop();
+  void HandleHookEvent(XEvent* event);
+
+ private:
+  // used by SendKeyboardCommand only
   Display* display_;
   Window root_;
-  bool running_;
+  // vkCode -> X11 keycode of display_, 0 means no mapping
+  std::array<KeyCode, kVkCodeTableSize> vk_code_to_keycode_{};
+
+  // owned by the hook thread, Xlib connections are not shared across threads
+  Display* hook_display_ = nullptr;
+  int xi_opcode_ = 0;
+  int wakeup_fd_ = -1;
+  std::thread hook_thread_;
+  std::atomic<bool> hooked_{false};
+  OnKeyAction on_key_action_ = nullptr;
+  void* user_ptr_ = nullptr;
+  // X11 keycode of hook_display_ -> vkCode, kInvalidKeyCode means no mapping
+  std::array<int, 256> keycode_to_vk_code_{};
 };
 }  // namespace crossdesk
-#endif
\ No newline at end of file
+#endif
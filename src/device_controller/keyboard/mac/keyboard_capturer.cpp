@@ -20,28 +20,26 @@ CGEventRef eventCallback(CGEventTapProxy proxy, CGEventType type,
     return event;
   }
 
-  int vk_code = 0;
+  CGKeyCode key_code = static_cast<CGKeyCode>(
+      CGEventGetIntegerValueField(event, kCGKeyboardEventKeycode));
+  int vk_code = CGKeyCodeToVkCode(key_code);
+  if (vk_code == kInvalidKeyCode) {
+    return nullptr;
+  }
 
   if (type == kCGEventKeyDown || type == kCGEventKeyUp) {
-    CGKeyCode key_code = static_cast<CGKeyCode>(
-        CGEventGetIntegerValueField(event, kCGKeyboardEventKeycode));
-    if (CGKeyCodeToVkCode.find(key_code) != CGKeyCodeToVkCode.end()) {
-      g_on_key_action(CGKeyCodeToVkCode[key_code], type == kCGEventKeyDown,
-                      g_user_ptr);
-    }
+    g_on_key_action(vk_code, type == kCGEventKeyDown, g_user_ptr);
   } else if (type == kCGEventFlagsChanged) {
     CGEventFlags current_flags = CGEventGetFlags(event);
-    CGKeyCode key_code = static_cast<CGKeyCode>(
-        CGEventGetIntegerValueField(event, kCGKeyboardEventKeycode));
 
     // caps lock
     bool caps_lock_state = (current_flags & kCGEventFlagMaskAlphaShift) != 0;
     if (caps_lock_state != keyboard_capturer->caps_lock_flag_) {
       keyboard_capturer->caps_lock_flag_ = caps_lock_state;
       if (keyboard_capturer->caps_lock_flag_) {
-        g_on_key_action(CGKeyCodeToVkCode[key_code], true, g_user_ptr);
+        g_on_key_action(vk_code, true, g_user_ptr);
       } else {
-        g_on_key_action(CGKeyCodeToVkCode[key_code], false, g_user_ptr);
+        g_on_key_action(vk_code, false, g_user_ptr);
       }
     }
 
@@ -50,9 +48,9 @@ CGEventRef eventCallback(CGEventTapProxy proxy, CGEventType type,
     if (shift_state != keyboard_capturer->shift_flag_) {
       keyboard_capturer->shift_flag_ = shift_state;
       if (keyboard_capturer->shift_flag_) {
-        g_on_key_action(CGKeyCodeToVkCode[key_code], true, g_user_ptr);
+        g_on_key_action(vk_code, true, g_user_ptr);
       } else {
-        g_on_key_action(CGKeyCodeToVkCode[key_code], false, g_user_ptr);
+        g_on_key_action(vk_code, false, g_user_ptr);
       }
     }
 
@@ -61,9 +59,9 @@ CGEventRef eventCallback(CGEventTapProxy proxy, CGEventType type,
     if (control_state != keyboard_capturer->control_flag_) {
       keyboard_capturer->control_flag_ = control_state;
       if (keyboard_capturer->control_flag_) {
-        g_on_key_action(CGKeyCodeToVkCode[key_code], true, g_user_ptr);
+        g_on_key_action(vk_code, true, g_user_ptr);
       } else {
-        g_on_key_action(CGKeyCodeToVkCode[key_code], false, g_user_ptr);
+        g_on_key_action(vk_code, false, g_user_ptr);
       }
     }
 
@@ -72,9 +70,9 @@ CGEventRef eventCallback(CGEventTapProxy proxy, CGEventType type,
     if (option_state != keyboard_capturer->option_flag_) {
       keyboard_capturer->option_flag_ = option_state;
       if (keyboard_capturer->option_flag_) {
-        g_on_key_action(CGKeyCodeToVkCode[key_code], true, g_user_ptr);
+        g_on_key_action(vk_code, true, g_user_ptr);
       } else {
-        g_on_key_action(CGKeyCodeToVkCode[key_code], false, g_user_ptr);
+        g_on_key_action(vk_code, false, g_user_ptr);
       }
     }
 
@@ -83,9 +81,9 @@ CGEventRef eventCallback(CGEventTapProxy proxy, CGEventType type,
     if (command_state != keyboard_capturer->command_flag_) {
       keyboard_capturer->command_flag_ = command_state;
       if (keyboard_capturer->command_flag_) {
-        g_on_key_action(CGKeyCodeToVkCode[key_code], true, g_user_ptr);
+        g_on_key_action(vk_code, true, g_user_ptr);
       } else {
-        g_on_key_action(CGKeyCodeToVkCode[key_code], false, g_user_ptr);
+        g_on_key_action(vk_code, false, g_user_ptr);
       }
     }
   }
@@ -167,8 +165,9 @@ inline bool IsFunctionKey(int key_code) {
 }
 
 int KeyboardCapturer::SendKeyboardCommand(int key_code, bool is_down) {
-  if (vkCodeToCGKeyCode.find(key_code) != vkCodeToCGKeyCode.end()) {
-    CGKeyCode cg_key_code = vkCodeToCGKeyCode[key_code];
+  int mapped_key_code = VkCodeToCGKeyCode(key_code);
+  if (mapped_key_code != kInvalidKeyCode) {
+    CGKeyCode cg_key_code = (CGKeyCode)mapped_key_code;
     CGEventRef event = CGEventCreateKeyboardEvent(NULL, cg_key_code, is_down);
     CGEventRef clearFlags =
         CGEventCreateKeyboardEvent(NULL, (CGKeyCode)0, true);
@@ -102,6 +102,24 @@ int MouseController::SendMouseCommand(RemoteAction remote_action,
   return 0;
 }
 
+int MouseController::SendIdleMove() {
+  if (!display_) {
+    return -1;
+  }
+
+  Window root_return, child_return;
+  int root_x, root_y, win_x, win_y;
+  unsigned int mask;
+  if (!XQueryPointer(display_, root_, &root_return, &child_return, &root_x,
+                     &root_y, &win_x, &win_y, &mask)) {
+    LOG_ERROR("Cannot query pointer position");
+    return -1;
+  }
+  XTestFakeMotionEvent(display_, -1, root_x, root_y, CurrentTime);
+  XFlush(display_);
+  return 0;
+}
+
 void MouseController::SetMousePosition(int x, int y) {
   XWarpPointer(display_, None, root_, 0, 0, 0, 0, x, y);
   XFlush(display_);
@@ -26,6 +26,8 @@ class MouseController : public DeviceController {
   virtual int Init(std::vector<DisplayInfo> display_info_list);
   virtual int Destroy();
   virtual int SendMouseCommand(RemoteAction remote_action, int display_index);
+  // moves the cursor to where it already is, an injected event nobody sees
+  int SendIdleMove();
 
  private:
   void SimulateKeyDown(int kval);
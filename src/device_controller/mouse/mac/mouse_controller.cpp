@@ -101,4 +101,23 @@ int MouseController::SendMouseCommand(RemoteAction remote_action,
 
   return 0;
 }
+
+int MouseController::SendIdleMove() {
+  CGEventRef location_event = CGEventCreate(NULL);
+  if (!location_event) {
+    LOG_ERROR("Cannot query cursor position");
+    return -1;
+  }
+  CGPoint mouse_point = CGEventGetLocation(location_event);
+  CFRelease(location_event);
+
+  CGEventRef mouse_event = CGEventCreateMouseEvent(
+      NULL, kCGEventMouseMoved, mouse_point, kCGMouseButtonLeft);
+  if (!mouse_event) {
+    return -1;
+  }
+  CGEventPost(kCGHIDEventTap, mouse_event);
+  CFRelease(mouse_event);
+  return 0;
+}
 }  // namespace crossdesk
\ No newline at end of file
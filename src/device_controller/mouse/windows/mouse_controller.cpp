@@ -72,4 +72,16 @@ int MouseController::SendMouseCommand(RemoteAction remote_action,
 
   return 0;
 }
+
+int MouseController::SendIdleMove() {
+  INPUT ip = {};
+  ip.type = INPUT_MOUSE;
+  // relative and zero, the cursor stays where it is
+  ip.mi.dwFlags = MOUSEEVENTF_MOVE;
+  if (SendInput(1, &ip, sizeof(INPUT)) != 1) {
+    LOG_ERROR("SendInput failed: {}", GetLastError());
+    return -1;
+  }
+  return 0;
+}
 }  // namespace crossdesk
\ No newline at end of file
@@ -58,6 +58,12 @@ static std::vector<std::string> out = {reinterpret_cast<const char*>(u8"输出")
                                        "Out"};
 static std::vector<std::string> loss_rate = {
     reinterpret_cast<const char*>(u8"丢包率"), "Loss Rate"};
+static std::vector<std::string> audio_buffer = {
+    reinterpret_cast<const char*>(u8"音频缓冲"), "Audio Buf"};
+static std::vector<std::string> audio_underrun = {
+    reinterpret_cast<const char*>(u8"欠载"), "Underrun"};
+static std::vector<std::string> av_offset = {
+    reinterpret_cast<const char*>(u8"音画偏移"), "A/V"};
 static std::vector<std::string> exit_fullscreen = {
     reinterpret_cast<const char*>(u8"退出全屏"), "Exit fullscreen"};
 static std::vector<std::string> control_mouse = {
@@ -68,6 +74,45 @@ static std::vector<std::string> audio_capture = {
     reinterpret_cast<const char*>(u8"声音"), "Audio"};
 static std::vector<std::string> mute = {
     reinterpret_cast<const char*>(u8" 静音"), " Mute"};
+static std::vector<std::string> start_trace = {
+    reinterpret_cast<const char*>(u8"开始性能跟踪"), "Start Trace"};
+static std::vector<std::string> stop_trace = {
+    reinterpret_cast<const char*>(u8"停止并保存跟踪"), "Stop Trace"};
+static std::vector<std::string> rtt = {
+    reinterpret_cast<const char*>(u8"往返时延"), "RTT"};
+static std::vector<std::string> latency = {
+    reinterpret_cast<const char*>(u8"画面时延"), "Latency"};
+static std::vector<std::string> input_latency = {
+    reinterpret_cast<const char*>(u8"输入时延"), "Input"};
+static std::vector<std::string> capture_to_present = {
+    reinterpret_cast<const char*>(u8"采集到显示"), "Capture to present"};
+static std::vector<std::string> measure_latency = {
+    reinterpret_cast<const char*>(u8"测量点击到画面时延"),
+    "Measure Click-to-Pixels"};
+static std::vector<std::string> measuring_latency = {
+    reinterpret_cast<const char*>(u8"测量中"), "Measuring"};
+static std::vector<std::string> click_to_pixels = {
+    reinterpret_cast<const char*>(u8"点击到画面"), "Click to pixels"};
+static std::vector<std::string> lost = {
+    reinterpret_cast<const char*>(u8"丢失"), "lost"};
+static std::vector<std::string> pipeline_hud = {
+    reinterpret_cast<const char*>(u8"帧时序面板"), "Frame Timing HUD"};
+static std::vector<std::string> receive_interval = {
+    reinterpret_cast<const char*>(u8"接收间隔"), "Receive"};
+static std::vector<std::string> upload_time = {
+    reinterpret_cast<const char*>(u8"上传耗时"), "Upload"};
+static std::vector<std::string> present_interval = {
+    reinterpret_cast<const char*>(u8"显示间隔"), "Present"};
+static std::vector<std::string> queue_depth = {
+    reinterpret_cast<const char*>(u8"队列深度"), "Queue"};
+static std::vector<std::string> dropped_frames = {
+    reinterpret_cast<const char*>(u8"丢帧"), "Dropped"};
+static std::vector<std::string> receive_to_present = {
+    reinterpret_cast<const char*>(u8"接收到显示"), "Receive to present"};
+static std::vector<std::string> host_capture_fps = {
+    reinterpret_cast<const char*>(u8"远端采集帧率"), "Host capture FPS"};
+static std::vector<std::string> volume = {
+    reinterpret_cast<const char*>(u8"音量"), "Volume"};
 static std::vector<std::string> settings = {
     reinterpret_cast<const char*>(u8"设置"), "Settings"};
 static std::vector<std::string> language = {
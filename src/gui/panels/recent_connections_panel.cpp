@@ -124,9 +124,15 @@ int Render::ShowRecentConnections() {
     ImVec2 image_pos = ImVec2(ImGui::GetCursorPosX() + 5.0f * dpi_scale_,
                               ImGui::GetCursorPosY() + 5.0f * dpi_scale_);
     ImGui::SetCursorPos(image_pos);
-    ImGui::Image((ImTextureID)(intptr_t)it.second.texture,
-                 ImVec2((float)recent_connection_image_width_,
-                        (float)recent_connection_image_height_));
+    // textures are uploaded a few per frame after a reload
+    if (it.second.texture) {
+      ImGui::Image((ImTextureID)(intptr_t)it.second.texture,
+                   ImVec2((float)recent_connection_image_width_,
+                          (float)recent_connection_image_height_));
+    } else {
+      ImGui::Dummy(ImVec2((float)recent_connection_image_width_,
+                          (float)recent_connection_image_height_));
+    }
 
     // remote id display button
     {
@@ -2,6 +2,11 @@
 
 #include <libyuv.h>
 
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -16,108 +21,27 @@
 #include "platform.h"
 #include "rd_log.h"
 #include "screen_capturer_factory.h"
+#include "trace.h"
 #include "version_checker.h"
 
 #define NV12_BUFFER_SIZE 1280 * 720 * 3 / 2
 
 #define MOUSE_GRAB_PADDING 5
 
-namespace crossdesk {
-
-std::vector<char> Render::SerializeRemoteAction(const RemoteAction& action) {
-  std::vector<char> buffer;
-  buffer.push_back(static_cast<char>(action.type));
-
-  auto insert_bytes = [&](const void* ptr, size_t len) {
-    buffer.insert(buffer.end(), (const char*)ptr, (const char*)ptr + len);
-  };
-
-  if (action.type == ControlType::host_infomation) {
-    insert_bytes(&action.i.host_name_size, sizeof(size_t));
-    insert_bytes(action.i.host_name, action.i.host_name_size);
-
-    size_t num = action.i.display_num;
-    insert_bytes(&num, sizeof(size_t));
+#define FONT_SIZE 32.0f
 
-    for (size_t i = 0; i < num; ++i) {
-      size_t len = strlen(action.i.display_list[i]);
-      insert_bytes(&len, sizeof(size_t));
-      insert_bytes(action.i.display_list[i], len);
-    }
-
-    insert_bytes(action.i.left, sizeof(int) * num);
-    insert_bytes(action.i.top, sizeof(int) * num);
-    insert_bytes(action.i.right, sizeof(int) * num);
-    insert_bytes(action.i.bottom, sizeof(int) * num);
-  }
-
-  return buffer;
-}
-
-bool Render::DeserializeRemoteAction(const char* data, size_t size,
-                                     RemoteAction& out) {
-  size_t offset = 0;
-  auto read = [&](void* dst, size_t len) -> bool {
-    if (offset + len > size) return false;
-    memcpy(dst, data + offset, len);
-    offset += len;
-    return true;
-  };
-
-  if (size < 1) return false;
-  out.type = static_cast<ControlType>(data[offset++]);
-
-  if (out.type == ControlType::host_infomation) {
-    size_t name_len;
-    if (!read(&name_len, sizeof(size_t)) || name_len >= sizeof(out.i.host_name))
-      return false;
-    if (!read(out.i.host_name, name_len)) return false;
-    out.i.host_name[name_len] = '\0';
-    out.i.host_name_size = name_len;
-
-    size_t num;
-    if (!read(&num, sizeof(size_t))) return false;
-    out.i.display_num = num;
-
-    out.i.display_list = (char**)malloc(num * sizeof(char*));
-    for (size_t i = 0; i < num; ++i) {
-      size_t len;
-      if (!read(&len, sizeof(size_t))) return false;
-      if (offset + len > size) return false;
-      out.i.display_list[i] = (char*)malloc(len + 1);
-      memcpy(out.i.display_list[i], data + offset, len);
-      out.i.display_list[i][len] = '\0';
-      offset += len;
-    }
+// textures created per frame while a reloaded thumbnail list fills in
+#define THUMBNAIL_UPLOADS_PER_FRAME 2
 
-    auto alloc_int_array = [&](int*& arr) {
-      arr = (int*)malloc(num * sizeof(int));
-      return read(arr, num * sizeof(int));
-    };
-
-    return alloc_int_array(out.i.left) && alloc_int_array(out.i.top) &&
-           alloc_int_array(out.i.right) && alloc_int_array(out.i.bottom);
-  }
-
-  return true;
-}
-
-void Render::FreeRemoteAction(RemoteAction& action) {
-  if (action.type == ControlType::host_infomation) {
-    for (size_t i = 0; i < action.i.display_num; ++i) {
-      free(action.i.display_list[i]);
-    }
-    free(action.i.display_list);
-    free(action.i.left);
-    free(action.i.top);
-    free(action.i.right);
-    free(action.i.bottom);
+// X11 and PulseAudio deliver on a fixed cadence, the other backends only when
+// something changes, so a quiet capturer there is no sign of a hang
+#if defined(__linux__)
+#define WATCH_CAPTURE_HEARTBEATS 1
+#else
+#define WATCH_CAPTURE_HEARTBEATS 0
+#endif
 
-    action.i.display_list = nullptr;
-    action.i.left = action.i.top = action.i.right = action.i.bottom = nullptr;
-    action.i.display_num = 0;
-  }
-}
+namespace crossdesk {
 
 SDL_HitTestResult Render::HitTestCallback(SDL_Window* window,
                                           const SDL_Point* area, void* data) {
@@ -207,7 +131,7 @@ int Render::LoadSettingsFromCacheFile() {
     memset(aes128_iv_, 0, sizeof(aes128_iv_));
 
     thumbnail_.reset();
-    thumbnail_ = std::make_unique<Thumbnail>(cache_path_ + "/thumbnails/");
+    thumbnail_ = std::make_shared<Thumbnail>(cache_path_ + "/thumbnails/");
     thumbnail_->GetKeyAndIv(aes128_key_, aes128_iv_);
     thumbnail_->DeleteAllFilesInDirectory();
 
@@ -248,7 +172,7 @@ int Render::LoadSettingsFromCacheFile() {
   memcpy(aes128_iv_, cd_cache_.iv, sizeof(cd_cache_.iv));
 
   thumbnail_.reset();
-  thumbnail_ = std::make_unique<Thumbnail>(cache_path_ + "/thumbnails/",
+  thumbnail_ = std::make_shared<Thumbnail>(cache_path_ + "/thumbnails/",
                                            aes128_key_, aes128_iv_);
 
   language_button_value_ = (int)config_center_->GetLanguage();
@@ -263,6 +187,7 @@ int Render::LoadSettingsFromCacheFile() {
   enable_autostart_ = config_center_->IsEnableAutostart();
   enable_daemon_ = config_center_->IsEnableDaemon();
   enable_minimize_to_tray_ = config_center_->IsMinimizeToTray();
+  skip_background_audio_ = config_center_->IsSkipBackgroundAudio();
 
   language_button_value_last_ = language_button_value_;
   video_quality_button_value_last_ = video_quality_button_value_;
@@ -279,38 +204,41 @@ int Render::LoadSettingsFromCacheFile() {
   return 0;
 }
 
+int Render::AudioChannelsFromConfig() {
+  return config_center_->GetAudioChannels() ==
+                 ConfigCenter::AUDIO_CHANNELS::STEREO
+             ? 2
+             : 1;
+}
+
+int Render::AudioFrameDurationFromConfig() {
+  switch (config_center_->GetAudioFrameDuration()) {
+    case ConfigCenter::AUDIO_FRAME_DURATION::MS_20:
+      return 20;
+    case ConfigCenter::AUDIO_FRAME_DURATION::MS_40:
+      return 40;
+    default:
+      return 10;
+  }
+}
+
 int Render::ScreenCapturerInit() {
   if (!screen_capturer_) {
     screen_capturer_ = (ScreenCapturer*)screen_capturer_factory_->Create();
   }
 
-  last_frame_time_ = std::chrono::duration_cast<std::chrono::milliseconds>(
-                         std::chrono::steady_clock::now().time_since_epoch())
-                         .count();
   int fps = config_center_->GetVideoFrameRate() ==
                     ConfigCenter::VIDEO_FRAME_RATE::FPS_30
                 ? 30
                 : 60;
+  host_session_.SetFps(fps);
   LOG_INFO("Init screen capturer with {} fps", fps);
 
   int screen_capturer_init_ret = screen_capturer_->Init(
-      fps,
-      [this, fps](unsigned char* data, int size, int width, int height,
+      fps, [this](unsigned char* data, int size, int width, int height,
                   const char* display_name) -> void {
-        auto now_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-                            std::chrono::steady_clock::now().time_since_epoch())
-                            .count();
-        auto duration = now_time - last_frame_time_;
-        if (duration * fps >= 1000) {  // ~60 FPS
-          XVideoFrame frame;
-          frame.data = (const char*)data;
-          frame.size = size;
-          frame.width = width;
-          frame.height = height;
-          frame.captured_timestamp = GetSystemTimeMicros(peer_);
-          SendVideoFrame(peer_, &frame, display_name);
-          last_frame_time_ = now_time;
-        }
+        daemon_state_.Beat(DaemonState::Subsystem::kScreenCapture);
+        host_session_.OnScreenFrame(data, size, width, height, display_name);
       });
 
   if (0 == screen_capturer_init_ret) {
@@ -318,6 +246,8 @@ int Render::ScreenCapturerInit() {
     if (display_info_list_.empty()) {
       display_info_list_ = screen_capturer_->GetDisplayInfoList();
     }
+    host_session_.SetDisplayInfoList(display_info_list_);
+    host_session_.SetScreenCapturer(screen_capturer_);
     return 0;
   } else {
     LOG_ERROR("Init screen capturer failed");
@@ -333,6 +263,8 @@ int Render::StartScreenCapturer() {
     LOG_INFO("Start screen capturer, show cursor: {}", show_cursor_);
 
     screen_capturer_->Start(show_cursor_);
+    daemon_state_.SetWatched(DaemonState::Subsystem::kScreenCapture,
+                             WATCH_CAPTURE_HEARTBEATS);
   }
 
   return 0;
@@ -341,6 +273,7 @@ int Render::StartScreenCapturer() {
 int Render::StopScreenCapturer() {
   if (screen_capturer_) {
     LOG_INFO("Stop screen capturer");
+    daemon_state_.SetWatched(DaemonState::Subsystem::kScreenCapture, false);
     screen_capturer_->Stop();
   }
 
@@ -349,12 +282,21 @@ int Render::StopScreenCapturer() {
 
 int Render::StartSpeakerCapturer() {
   if (!speaker_capturer_) {
+    int channels = 1;
+    int frame_duration_ms = 10;
+    host_session_.GetAudioFormat(&channels, &frame_duration_ms);
+
     speaker_capturer_ = (SpeakerCapturer*)speaker_capturer_factory_->Create();
-    int speaker_capturer_init_ret =
-        speaker_capturer_->Init([this](unsigned char* data, size_t size,
-                                       const char* audio_name) -> void {
-          SendAudioFrame(peer_, (const char*)data, size, audio_label_.c_str());
-        });
+    LOG_INFO("Init speaker capturer with {} channel(s), {} ms frames",
+             channels, frame_duration_ms);
+    speaker_capturer_channels_ = channels;
+    int speaker_capturer_init_ret = speaker_capturer_->Init(
+        [this](unsigned char* data, size_t size,
+               const char* audio_name) -> void {
+          daemon_state_.Beat(DaemonState::Subsystem::kSpeakerCapture);
+          host_session_.OnSpeakerFrame(data, size);
+        },
+        channels, frame_duration_ms);
 
     if (0 != speaker_capturer_init_ret) {
       speaker_capturer_->Destroy();
@@ -364,8 +306,11 @@ int Render::StartSpeakerCapturer() {
   }
 
   if (speaker_capturer_) {
+    host_session_.ResetAudio(speaker_capturer_channels_);
     speaker_capturer_->Start();
     start_speaker_capturer_ = true;
+    daemon_state_.SetWatched(DaemonState::Subsystem::kSpeakerCapture,
+                             WATCH_CAPTURE_HEARTBEATS);
   }
 
   return 0;
@@ -373,6 +318,7 @@ int Render::StartSpeakerCapturer() {
 
 int Render::StopSpeakerCapturer() {
   if (speaker_capturer_) {
+    daemon_state_.SetWatched(DaemonState::Subsystem::kSpeakerCapture, false);
     speaker_capturer_->Stop();
     start_speaker_capturer_ = false;
   }
@@ -394,12 +340,14 @@ int Render::StartMouseController() {
     mouse_controller_->Destroy();
     mouse_controller_ = nullptr;
   }
+  host_session_.SetMouseController(mouse_controller_);
 
   return 0;
 }
 
 int Render::StopMouseController() {
   if (mouse_controller_) {
+    host_session_.SetMouseController(nullptr);
     mouse_controller_->Destroy();
     delete mouse_controller_;
     mouse_controller_ = nullptr;
@@ -439,6 +387,13 @@ int Render::StopKeyboardCapturer() {
 }
 
 int Render::CreateConnectionPeer() {
+  // a creation still running reads params_, let it finish first. Its result
+  // is already stale and gets destroyed once posted
+  if (peer_creation_thread_.joinable()) {
+    peer_creation_thread_.join();
+  }
+  uint64_t generation = ++peer_creation_generation_;
+
   params_.use_cfg_file = false;
 
   std::string signal_server_ip;
@@ -520,16 +475,61 @@ int Render::CreateConnectionPeer() {
   params_.user_id = client_id_with_password_;
   params_.user_data = this;
 
-  peer_ = CreatePeer(&params_);
-  if (peer_) {
-    LOG_INFO("Create peer instance [{}] successful", client_id_);
-    Init(peer_);
-    LOG_INFO("Peer [{}] init finish", client_id_);
-  } else {
-    LOG_INFO("Create peer [{}] instance failed", client_id_);
+  // creating and initializing the peer talks to the signal server, keep it
+  // off the UI thread. params_ is left alone until the result is posted back
+  peer_creation_pending_ = true;
+  last_peer_creation_time_ = SDL_GetTicks();
+  std::shared_ptr<UiTaskQueue> ui_tasks = ui_tasks_;
+  std::string client_id = client_id_;
+  peer_creation_thread_ = std::thread([this, ui_tasks, client_id,
+                                       generation]() {
+    PeerPtr* peer = CreatePeer(&params_);
+    if (peer) {
+      LOG_INFO("Create peer instance [{}] successful", client_id);
+      Init(peer);
+      LOG_INFO("Peer [{}] init finish", client_id);
+    } else {
+      LOG_INFO("Create peer [{}] instance failed", client_id);
+    }
+    ui_tasks->Post([this, peer, generation]() {
+      OnConnectionPeerCreated(peer, generation);
+    });
+  });
+
+  return 0;
+}
+
+int Render::OnConnectionPeerCreated(PeerPtr* peer, uint64_t generation) {
+  if (generation != peer_creation_generation_) {
+    // superseded, e.g. by the settings recreating the peer meanwhile. It is
+    // logged in to the signal server under the old settings
+    if (peer) {
+      LOG_INFO("Destroy superseded peer");
+      DestroyPeer(&peer);
+    }
+    return -1;
+  }
+
+  peer_creation_pending_ = false;
+  peer_ = peer;
+  if (!peer_) {
+    return -1;
+  }
+  host_session_.SetPeer(peer_);
+
+  if (!first_peer_created_) {
+    first_peer_created_ = true;
+    LOG_INFO("Startup: peer created at {} ms",
+             startup_timeline_.Mark("peer_created"));
   }
 
   if (0 == ScreenCapturerInit()) {
+    if (selected_display_ > 0 &&
+        selected_display_ < (int)display_info_list_.size()) {
+      // restored from the daemon state, viewers may still switch later
+      screen_capturer_->SwitchTo(selected_display_);
+      host_session_.SetSelectedDisplay(selected_display_);
+    }
     for (auto& display_info : display_info_list_) {
       AddVideoStream(peer_, display_info.name.c_str());
     }
@@ -548,12 +548,14 @@ int Render::AudioDeviceInit() {
   desired_out.format = SDL_AUDIO_S16;
   desired_out.channels = 1;
 
-  output_stream_ = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK,
-                                             &desired_out, nullptr, nullptr);
+  // pull model, the device callback drains the per-session jitter buffers
+  output_stream_ = SDL_OpenAudioDeviceStream(
+      SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &desired_out, AudioStreamCallback, this);
   if (!output_stream_) {
     LOG_ERROR("Failed to open output stream: {}", SDL_GetError());
     return -1;
   }
+  audio_output_channels_ = desired_out.channels;
 
   SDL_ResumeAudioDevice(SDL_GetAudioStreamDevice(output_stream_));
 
@@ -566,9 +568,205 @@ int Render::AudioDeviceDestroy() {
     SDL_DestroyAudioStream(output_stream_);
     output_stream_ = nullptr;
   }
+
+  {
+    std::lock_guard<std::mutex> lock(audio_jitter_buffers_mutex_);
+    audio_jitter_buffers_.clear();
+    audio_session_gains_.clear();
+  }
   return 0;
 }
 
+std::shared_ptr<AudioJitterBuffer> Render::GetAudioJitterBuffer(
+    const std::string& remote_id, bool create) {
+  std::lock_guard<std::mutex> lock(audio_jitter_buffers_mutex_);
+  auto it = audio_jitter_buffers_.find(remote_id);
+  if (it != audio_jitter_buffers_.end()) {
+    return it->second;
+  }
+
+  if (!create) {
+    return nullptr;
+  }
+
+  auto jitter_buffer = std::make_shared<AudioJitterBuffer>(48000, 1);
+  audio_jitter_buffers_[remote_id] = jitter_buffer;
+  return jitter_buffer;
+}
+
+void Render::ResetAudioJitterBuffer(const std::string& remote_id,
+                                    int channels) {
+  {
+    std::lock_guard<std::mutex> lock(audio_jitter_buffers_mutex_);
+    audio_jitter_buffers_[remote_id] =
+        std::make_shared<AudioJitterBuffer>(48000, channels);
+  }
+  UpdateAudioOutputFormat();
+}
+
+void Render::RemoveAudioJitterBuffer(const std::string& remote_id) {
+  {
+    std::lock_guard<std::mutex> lock(audio_jitter_buffers_mutex_);
+    audio_jitter_buffers_.erase(remote_id);
+    audio_session_gains_.erase(remote_id);
+  }
+  UpdateAudioOutputFormat();
+}
+
+void Render::SetAudioSessionGain(const std::string& remote_id, int gain_q14) {
+  std::lock_guard<std::mutex> lock(audio_jitter_buffers_mutex_);
+  audio_session_gains_[remote_id] = gain_q14;
+}
+
+void Render::UpdateSessionAudio() {
+  for (auto& it : client_properties_) {
+    auto& props = it.second;
+    if (!props->connection_established_ || !props->peer_) {
+      // hosts start capturing for every new connection
+      props->audio_source_enabled_ = true;
+      props->audio_gain_applied_ = -1;
+      continue;
+    }
+
+    bool audible = props->audio_capture_button_pressed_ &&
+                   (!skip_background_audio_ || props->tab_selected_);
+    if (audible != props->audio_source_enabled_) {
+      // stop the host capturing instead of decoding and mixing silence
+      RemoteAction remote_action;
+      remote_action.type = ControlType::audio_capture;
+      remote_action.a = audible;
+      std::string msg = remote_action.to_json();
+      SendDataFrame(props->peer_, msg.c_str(), msg.size(),
+                    props->data_label_.c_str());
+      props->audio_source_enabled_ = audible;
+    }
+
+    int gain_q14 =
+        audible ? props->audio_gain_percent_ * AudioMixer::kUnityGain / 100
+                : 0;
+    if (gain_q14 != props->audio_gain_applied_) {
+      SetAudioSessionGain(props->remote_id_, gain_q14);
+      props->audio_gain_applied_ = gain_q14;
+    }
+  }
+}
+
+void Render::UpdateClockSync() {
+  auto now = std::chrono::steady_clock::now();
+  for (auto& it : client_properties_) {
+    auto& props = it.second;
+    if (!props->connection_established_ || !props->peer_) {
+      props->clock_offset_.Reset();
+      props->clock_ping_t0_ = 0;
+      props->clock_pings_sent_ = 0;
+      props->input_latency_us_ = -1;
+      continue;
+    }
+
+    // a quick burst fills the filter window, then once a second
+    auto interval = props->clock_pings_sent_ < 8
+                        ? std::chrono::milliseconds(200)
+                        : std::chrono::milliseconds(1000);
+    if (now - props->last_clock_ping_time_ < interval) {
+      continue;
+    }
+
+    RemoteAction remote_action;
+    remote_action.type = ControlType::clock_ping;
+    remote_action.c.t0 = GetSystemTimeMicros(props->peer_);
+    remote_action.c.t1 = 0;
+    remote_action.c.t2 = 0;
+    remote_action.c.input_latency_us = -1;
+    std::string msg = remote_action.to_json();
+    SendDataFrame(props->peer_, msg.c_str(), msg.size(),
+                  props->data_label_.c_str());
+    props->clock_ping_t0_ = remote_action.c.t0;
+    props->last_clock_ping_time_ = now;
+    ++props->clock_pings_sent_;
+  }
+}
+
+void Render::UpdateLatencyProbes() {
+  int64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                       .count();
+  for (auto& it : client_properties_) {
+    auto& props = it.second;
+    if (!props->connection_established_ || !props->peer_) {
+      props->latency_probe_.Stop();
+      props->latency_probe_auto_started_ = false;
+      continue;
+    }
+
+    if (latency_probe_auto_samples_ > 0 &&
+        !props->latency_probe_auto_started_) {
+      props->latency_probe_.Start(latency_probe_auto_samples_);
+      props->latency_probe_auto_started_ = true;
+    }
+
+    uint8_t probe_id = props->latency_probe_.NextProbe(now_us);
+    if (probe_id == 0) {
+      continue;
+    }
+
+    RemoteAction remote_action;
+    remote_action.type = ControlType::latency_probe;
+    remote_action.d = probe_id;
+    remote_action.timestamp = HostTimestamp(props.get());
+    std::string msg = remote_action.to_json();
+    SendDataFrame(props->peer_, msg.c_str(), msg.size(),
+                  props->data_label_.c_str());
+  }
+}
+
+int64_t Render::HostTimestamp(SubStreamWindowProperties* props) {
+  if (!props->peer_ || !props->clock_offset_.GetStats().valid) {
+    return 0;
+  }
+  return props->clock_offset_.LocalToRemote(GetSystemTimeMicros(props->peer_));
+}
+
+void Render::UpdateAudioOutputFormat() {
+  if (!output_stream_) {
+    return;
+  }
+
+  // the device callback runs with the stream locked, so holding the lock
+  // here keeps audio_output_channels_ and the stream format in step
+  SDL_LockAudioStream(output_stream_);
+  int channels = 1;
+  {
+    std::lock_guard<std::mutex> lock(audio_jitter_buffers_mutex_);
+    for (auto& it : audio_jitter_buffers_) {
+      channels = std::max(channels, it.second->Channels());
+    }
+  }
+
+  if (channels != audio_output_channels_) {
+    SDL_AudioSpec spec{};
+    spec.freq = 48000;
+    spec.format = SDL_AUDIO_S16;
+    spec.channels = channels;
+    if (SDL_SetAudioStreamFormat(output_stream_, &spec, nullptr)) {
+      audio_output_channels_ = channels;
+      LOG_INFO("Audio output switched to {} channel(s)", channels);
+    } else {
+      LOG_ERROR("Failed to set output stream format: {}", SDL_GetError());
+    }
+  }
+  SDL_UnlockAudioStream(output_stream_);
+}
+
+int Render::SendAudioFormat(PeerPtr* peer, const std::string& data_label,
+                            int channels, int frame_duration_ms) {
+  RemoteAction remote_action;
+  remote_action.type = ControlType::audio_format;
+  remote_action.f.channels = channels;
+  remote_action.f.frame_duration_ms = frame_duration_ms;
+  std::string msg = remote_action.to_json();
+  return SendDataFrame(peer, msg.data(), msg.size(), data_label.c_str());
+}
+
 void Render::UpdateInteractions() {
   if (start_screen_capturer_ && !screen_capturer_is_started_) {
     StartScreenCapturer();
@@ -578,6 +776,20 @@ void Render::UpdateInteractions() {
     screen_capturer_is_started_ = false;
   }
 
+  if (host_session_.TakeAudioFormatChanged()) {
+    // the capturer only takes its format in Init
+    if (speaker_capturer_) {
+      speaker_capturer_->Stop();
+      speaker_capturer_->Destroy();
+      delete speaker_capturer_;
+      speaker_capturer_ = nullptr;
+      if (speaker_capturer_is_started_) {
+        StartSpeakerCapturer();
+      }
+    }
+    host_session_.SendAudioFormat();
+  }
+
   if (start_speaker_capturer_ && !speaker_capturer_is_started_) {
     StartSpeakerCapturer();
     speaker_capturer_is_started_ = true;
@@ -794,33 +1006,91 @@ int Render::DestroyStreamWindow() {
 }
 
 int Render::SetupFontAndStyle(bool main_window) {
-  float font_size = 32.0f;
+  auto setup_begin = std::chrono::steady_clock::now();
 
   // Setup Dear ImGui style
   ImGuiIO& io = ImGui::GetIO();
 
   io.IniFilename = NULL;  // disable imgui.ini
 
-  // Load Fonts
+  // Load Fonts. Glyphs are baked into the atlas the first time they are
+  // drawn, so no glyph ranges are given: a range would only cap which
+  // characters can show up, not what gets built at startup
   ImFontConfig config;
   config.FontDataOwnedByAtlas = false;
   io.Fonts->AddFontFromMemoryTTF(OPPOSans_Regular_ttf, OPPOSans_Regular_ttf_len,
-                                 font_size, &config,
-                                 io.Fonts->GetGlyphRangesChineseFull());
+                                 FONT_SIZE, &config);
   config.MergeMode = true;
   static const ImWchar icon_ranges[] = {ICON_MIN_FA, ICON_MAX_FA, 0};
   io.Fonts->AddFontFromMemoryTTF(fa_solid_900_ttf, fa_solid_900_ttf_len, 30.0f,
                                  &config, icon_ranges);
 
-  // Load system Chinese font as fallback
-  config.MergeMode = false;
-  config.FontDataOwnedByAtlas = false;
+  // the system Chinese font is only loaded once a window asks for it
   if (main_window) {
     main_windows_system_chinese_font_ = nullptr;
+    main_windows_system_chinese_font_requested_ = false;
   } else {
     stream_windows_system_chinese_font_ = nullptr;
+    stream_windows_system_chinese_font_requested_ = false;
+  }
+
+  ImGui::StyleColorsLight();
+
+  LOG_INFO("Fonts of {} window set up in {} ms",
+           main_window ? "main" : "stream",
+           std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - setup_begin)
+               .count());
+
+  return 0;
+}
+
+ImFont* Render::SystemChineseFont() {
+  if (ImGui::GetCurrentContext() == main_ctx_) {
+    if (!main_windows_system_chinese_font_) {
+      main_windows_system_chinese_font_requested_ = true;
+    }
+    return main_windows_system_chinese_font_;
+  }
+
+  if (!stream_windows_system_chinese_font_) {
+    stream_windows_system_chinese_font_requested_ = true;
+  }
+  return stream_windows_system_chinese_font_;
+}
+
+void Render::LoadRequestedFonts(bool main_window) {
+  bool& requested = main_window ? main_windows_system_chinese_font_requested_
+                                : stream_windows_system_chinese_font_requested_;
+  ImFont*& font = main_window ? main_windows_system_chinese_font_
+                              : stream_windows_system_chinese_font_;
+  if (!requested || font) {
+    return;
+  }
+  requested = false;
+
+  ImGuiIO& io = ImGui::GetIO();
+  ImFontConfig config;
+  config.FontDataOwnedByAtlas = false;
+  if (0 == LoadSystemChineseFontData()) {
+    font = io.Fonts->AddFontFromMemoryTTF(system_chinese_font_data_.data(),
+                                          (int)system_chinese_font_data_.size(),
+                                          FONT_SIZE, &config);
   }
 
+  // If no system font found, use default font
+  if (font == nullptr) {
+    font = io.Fonts->AddFontDefault(&config);
+    LOG_WARN("System Chinese font not found, using default font");
+  }
+}
+
+int Render::LoadSystemChineseFontData() {
+  if (system_chinese_font_data_loaded_) {
+    return system_chinese_font_data_.empty() ? -1 : 0;
+  }
+  system_chinese_font_data_loaded_ = true;
+
 #if defined(_WIN32)
   // Windows: Try Microsoft YaHei (微软雅黑) first, then SimSun (宋体)
   const char* font_paths[] = {"C:/Windows/Fonts/msyh.ttc",
@@ -842,45 +1112,24 @@ int Render::SetupFontAndStyle(bool main_window) {
 #endif
 
   for (int i = 0; font_paths[i] != nullptr; i++) {
-    std::ifstream font_file(font_paths[i], std::ios::binary);
-    if (font_file.good()) {
-      font_file.close();
-      if (main_window) {
-        main_windows_system_chinese_font_ =
-            io.Fonts->AddFontFromFileTTF(font_paths[i], font_size, &config,
-                                         io.Fonts->GetGlyphRangesChineseFull());
-        if (main_windows_system_chinese_font_ != nullptr) {
-          LOG_INFO("Loaded system Chinese font: {}", font_paths[i]);
-          break;
-        }
-      } else {
-        stream_windows_system_chinese_font_ =
-            io.Fonts->AddFontFromFileTTF(font_paths[i], font_size, &config,
-                                         io.Fonts->GetGlyphRangesChineseFull());
-        if (stream_windows_system_chinese_font_ != nullptr) {
-          LOG_INFO("Loaded system Chinese font: {}", font_paths[i]);
-          break;
-        }
-      }
+    std::ifstream font_file(font_paths[i], std::ios::binary | std::ios::ate);
+    if (!font_file.good()) {
+      continue;
     }
-  }
 
-  // If no system font found, use default font
-  if (main_window) {
-    if (main_windows_system_chinese_font_ == nullptr) {
-      main_windows_system_chinese_font_ = io.Fonts->AddFontDefault(&config);
-      LOG_WARN("System Chinese font not found, using default font");
-    }
-  } else {
-    if (stream_windows_system_chinese_font_ == nullptr) {
-      stream_windows_system_chinese_font_ = io.Fonts->AddFontDefault(&config);
-      LOG_WARN("System Chinese font not found, using default font");
+    std::streamsize size = font_file.tellg();
+    font_file.seekg(0, std::ios::beg);
+    system_chinese_font_data_.resize((size_t)size);
+    if (size > 0 &&
+        font_file.read((char*)system_chinese_font_data_.data(), size)) {
+      LOG_INFO("Loaded system Chinese font: {} ({} KB)", font_paths[i],
+               size / 1024);
+      return 0;
     }
+    system_chinese_font_data_.clear();
   }
 
-  ImGui::StyleColorsLight();
-
-  return 0;
+  return -1;
 }
 
 int Render::DestroyMainWindowContext() {
@@ -908,7 +1157,9 @@ int Render::DrawMainWindow() {
     return -1;
   }
 
+  TRACE_SCOPE("draw_main_window");
   ImGui::SetCurrentContext(main_ctx_);
+  LoadRequestedFonts(true);
   ImGui_ImplSDLRenderer3_NewFrame();
   ImGui_ImplSDL3_NewFrame();
   ImGui::NewFrame();
@@ -945,7 +1196,10 @@ int Render::DrawMainWindow() {
                      io.DisplayFramebufferScale.y);
   SDL_RenderClear(main_renderer_);
   ImGui_ImplSDLRenderer3_RenderDrawData(ImGui::GetDrawData(), main_renderer_);
-  SDL_RenderPresent(main_renderer_);
+  {
+    TRACE_SCOPE("present_main_window");
+    SDL_RenderPresent(main_renderer_);
+  }
 
   return 0;
 }
@@ -956,7 +1210,9 @@ int Render::DrawStreamWindow() {
     return -1;
   }
 
+  TRACE_SCOPE("draw_stream_window");
   ImGui::SetCurrentContext(stream_ctx_);
+  LoadRequestedFonts(false);
   ImGui_ImplSDLRenderer3_NewFrame();
   ImGui_ImplSDL3_NewFrame();
   ImGui::NewFrame();
@@ -1000,30 +1256,33 @@ int Render::DrawStreamWindow() {
     }
   }
   ImGui_ImplSDLRenderer3_RenderDrawData(ImGui::GetDrawData(), stream_renderer_);
-  SDL_RenderPresent(stream_renderer_);
+  {
+    TRACE_SCOPE("present_stream_window");
+    SDL_RenderPresent(stream_renderer_);
+  }
+
+  int64_t presented_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+  for (auto& [_, props] : client_properties_) {
+    props->pipeline_stats_.OnPresented(presented_us);
+  }
 
   return 0;
 }
 
 int Render::Run() {
-  latest_version_info_ = CheckUpdate();
-  if (!latest_version_info_.empty() &&
-      latest_version_info_.contains("version") &&
-      latest_version_info_["version"].is_string()) {
-    latest_version_ = latest_version_info_["version"];
-    if (latest_version_info_.contains("releaseNotes") &&
-        latest_version_info_["releaseNotes"].is_string()) {
-      release_notes_ = latest_version_info_["releaseNotes"];
-    } else {
-      release_notes_ = "";
-    }
-    update_available_ = IsNewerVersion(CROSSDESK_VERSION, latest_version_);
-    if (update_available_) {
-      show_update_notification_window_ = true;
-    }
-  } else {
-    latest_version_ = "";
-    update_available_ = false;
+  // nothing on the way to the first frame may touch the network, the update
+  // check, peer creation and thumbnail decoding run on background threads
+  // and hand their results back through ui_tasks_
+  DaemonState::Snapshot daemon_snapshot;
+  warm_restart_ = 0 == daemon_state_.Open() &&
+                  daemon_state_.RestartCount() > 0 &&
+                  daemon_state_.Read(&daemon_snapshot);
+  // the crashed predecessor already checked for updates
+  if (!warm_restart_) {
+    StartUpdateCheck();
   }
 
   path_manager_ = std::make_unique<PathManager>("CrossDesk");
@@ -1050,29 +1309,75 @@ int Render::Run() {
     return -1;
   }
 
+  startup_timeline_.Mark("config");
+
   InitializeLogger();
   LOG_INFO("CrossDesk version: {}", CROSSDESK_VERSION);
 
   InitializeSettings();
+  RestoreDaemonState();
+  InitializeMetrics();
+  startup_timeline_.Mark("settings");
   InitializeSDL();
-  InitializeModules();
+  startup_timeline_.Mark("sdl");
   InitializeMainWindow();
+  startup_timeline_.Mark("main_window");
 
   const int scaled_video_width_ = 160;
   const int scaled_video_height_ = 90;
 
   MainLoop();
 
+  // tearing down may take a while and must not look like a hang
+  daemon_state_.SetWatched(DaemonState::Subsystem::kMainLoop, false);
   Cleanup();
 
   return 0;
 }
 
-void Render::InitializeLogger() { InitLogger(exec_log_path_); }
+void Render::InitializeLogger() {
+  InitLogger(exec_log_path_);
+
+  Tracer::Instance().SetThreadName("main");
+  // lets startup be traced, otherwise tracing is toggled from the menu
+  const char* trace_env = getenv("CROSSDESK_TRACE");
+  if (trace_env && strcmp(trace_env, "1") == 0) {
+    Tracer::Instance().SetEnabled(true);
+  }
+}
+
+void Render::ToggleTracing() {
+  Tracer& tracer = Tracer::Instance();
+  if (!tracer.IsEnabled()) {
+    tracer.Clear();
+    tracer.SetEnabled(true);
+    return;
+  }
+
+  tracer.SetEnabled(false);
+
+  auto now = std::chrono::system_clock::to_time_t(
+      std::chrono::system_clock::now());
+  std::tm tm_info;
+#ifdef _WIN32
+  localtime_s(&tm_info, &now);
+#else
+  localtime_r(&now, &tm_info);
+#endif
+  char file_name[64];
+  strftime(file_name, sizeof(file_name), "crossdesk-trace-%Y%m%d-%H%M%S.json",
+           &tm_info);
+  tracer.DumpChromeJson(exec_log_path_ + "/" + file_name);
+}
 
 void Render::InitializeSettings() {
   LoadSettingsFromCacheFile();
 
+  const char* latency_probe_env = getenv("CROSSDESK_LATENCY_PROBE");
+  if (latency_probe_env) {
+    latency_probe_auto_samples_ = atoi(latency_probe_env);
+  }
+
   localization_language_ = (ConfigCenter::LANGUAGE)language_button_value_;
   localization_language_index_ = language_button_value_;
   if (localization_language_index_ != 0 && localization_language_index_ != 1) {
@@ -1082,6 +1387,14 @@ void Render::InitializeSettings() {
   }
 }
 
+void Render::InitializeMetrics() {
+  // off by default, the endpoint is for unattended hosts
+  int metrics_port = config_center_->GetMetricsPort();
+  if (metrics_port > 0) {
+    metrics_server_.Start(metrics_port);
+  }
+}
+
 void Render::InitializeSDL() {
   if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO)) {
     LOG_ERROR("Error: {}", SDL_GetError());
@@ -1110,11 +1423,144 @@ void Render::InitializeModules() {
     device_controller_factory_ = new DeviceControllerFactory();
     keyboard_capturer_ = (KeyboardCapturer*)device_controller_factory_->Create(
         DeviceControllerFactory::Device::Keyboard);
-    CreateConnectionPeer();
+    host_session_.SetKeyboardCapturer(keyboard_capturer_);
     modules_inited_ = true;
   }
 }
 
+void Render::StartUpdateCheck() {
+  std::shared_ptr<UiTaskQueue> ui_tasks = ui_tasks_;
+  // detached, a dead network must hold up neither startup nor exit
+  std::thread([this, ui_tasks]() {
+    nlohmann::json latest_version_info = CheckUpdate();
+    ui_tasks->Post([this, latest_version_info]() {
+      ApplyUpdateCheckResult(latest_version_info);
+    });
+  }).detach();
+}
+
+void Render::ApplyUpdateCheckResult(const nlohmann::json& latest_version_info) {
+  latest_version_info_ = latest_version_info;
+  if (!latest_version_info_.empty() &&
+      latest_version_info_.contains("version") &&
+      latest_version_info_["version"].is_string()) {
+    latest_version_ = latest_version_info_["version"];
+    if (latest_version_info_.contains("releaseNotes") &&
+        latest_version_info_["releaseNotes"].is_string()) {
+      release_notes_ = latest_version_info_["releaseNotes"];
+    } else {
+      release_notes_ = "";
+    }
+    update_available_ = IsNewerVersion(CROSSDESK_VERSION, latest_version_);
+    if (update_available_) {
+      show_update_notification_window_ = true;
+    }
+  } else {
+    latest_version_ = "";
+    update_available_ = false;
+  }
+
+  LOG_INFO("Startup: update check done at {} ms",
+           startup_timeline_.Mark("update_check"));
+}
+
+void Render::RestoreDaemonState() {
+  DaemonState::Subsystem hung_subsystem;
+  int64_t hung_silent_ms = 0;
+  if (daemon_state_.LastHang(&hung_subsystem, &hung_silent_ms)) {
+    LOG_WARN("Previous instance killed by the daemon, {} hung for {} ms",
+             DaemonState::SubsystemName(hung_subsystem), hung_silent_ms);
+  }
+
+  DaemonState::Snapshot snapshot;
+  if (!warm_restart_ || !daemon_state_.Read(&snapshot)) {
+    PublishDaemonState();
+    return;
+  }
+
+  // the cache file wins, the snapshot only fills in what it lacks
+  if (client_id_with_password_[0] == '\0' &&
+      strchr(snapshot.client_id_with_password.c_str(), '@') != nullptr) {
+    const std::string& id_with_password = snapshot.client_id_with_password;
+    size_t at_pos = id_with_password.find('@');
+    strncpy(client_id_with_password_, id_with_password.c_str(),
+            sizeof(client_id_with_password_) - 1);
+    client_id_with_password_[sizeof(client_id_with_password_) - 1] = '\0';
+    strncpy(client_id_, id_with_password.substr(0, at_pos).c_str(),
+            sizeof(client_id_) - 1);
+    client_id_[sizeof(client_id_) - 1] = '\0';
+    strncpy(password_saved_, id_with_password.substr(at_pos + 1).c_str(),
+            sizeof(password_saved_) - 1);
+    password_saved_[sizeof(password_saved_) - 1] = '\0';
+  }
+  selected_display_ = snapshot.selected_display;
+
+  std::string sessions;
+  for (const auto& session_id : snapshot.session_ids) {
+    sessions += sessions.empty() ? session_id : ", " + session_id;
+  }
+  LOG_INFO("Warm restart #{}, id [{}], display [{}], sessions [{}]",
+           daemon_state_.RestartCount(), client_id_, selected_display_,
+           sessions);
+}
+
+void Render::PublishDaemonState() {
+  if (!daemon_state_.IsOpen()) {
+    return;
+  }
+
+  DaemonState::Snapshot snapshot;
+  snapshot.client_id_with_password = client_id_with_password_;
+  snapshot.selected_display = selected_display_;
+  for (const auto& [remote_id, status] : connection_status_) {
+    if (status == ConnectionStatus::Connected) {
+      snapshot.session_ids.push_back(remote_id);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(daemon_state_mutex_);
+  daemon_state_.Write(snapshot);
+}
+
+void Render::ReportRestartReady() {
+  if (restart_ready_reported_.exchange(true)) {
+    return;
+  }
+
+  int64_t ready_ms = startup_timeline_.Mark("signal_ready");
+  if (daemon_state_.RestartCount() == 0) {
+    LOG_INFO("Startup: signal server ready at {} ms", ready_ms);
+    return;
+  }
+
+  int64_t now_ns = DaemonState::NowNs();
+  LOG_INFO(
+      "Restart #{} ({}) ready {} ms after spawn, {} ms after the crash",
+      daemon_state_.RestartCount(), warm_restart_ ? "warm" : "cold",
+      (now_ns - daemon_state_.SpawnTimeNs()) / 1000000,
+      (now_ns - daemon_state_.ExitTimeNs()) / 1000000);
+}
+
+void Render::UpdateDeferredStartup() {
+  ui_tasks_->RunPending();
+  if (!first_frame_presented_) {
+    return;
+  }
+
+  if (!modules_inited_) {
+    InitializeModules();
+    LOG_INFO("Startup: modules ready at {} ms",
+             startup_timeline_.Mark("modules"));
+  }
+
+  // a failed creation is retried, but not on every frame
+  if (!peer_ && !peer_creation_pending_ &&
+      (last_peer_creation_time_ == 0 ||
+       SDL_GetTicks() - last_peer_creation_time_ >= 1000)) {
+    CreateConnectionPeer();
+  }
+}
+
 void Render::InitializeMainWindow() {
   CreateMainWindow();
   if (SDL_WINDOW_HIDDEN & SDL_GetWindowFlags(main_window_)) {
@@ -1123,15 +1569,16 @@ void Render::InitializeMainWindow() {
 }
 
 void Render::MainLoop() {
+  daemon_state_.SetWatched(DaemonState::Subsystem::kMainLoop, true);
   while (!exit_) {
-    if (!peer_) {
-      CreateConnectionPeer();
-    }
+    daemon_state_.Beat(DaemonState::Subsystem::kMainLoop);
+    UpdateDeferredStartup();
 
     SDL_Event event;
     if (SDL_WaitEventTimeout(&event, sdl_refresh_ms_)) {
       ProcessSdlEvent(event);
     }
+    ReleaseDelayedVideoFrames();
 
 #if _WIN32
     MSG msg;
@@ -1146,54 +1593,21 @@ void Render::MainLoop() {
     HandleStreamWindow();
 
     DrawMainWindow();
+    if (!first_frame_presented_) {
+      first_frame_presented_ = true;
+      startup_timeline_.Mark("first_frame");
+      startup_timeline_.Report(200);
+    }
     if (stream_window_inited_) {
       DrawStreamWindow();
     }
 
     UpdateInteractions();
+    UpdateSessionAudio();
+    UpdateClockSync();
+    UpdateLatencyProbes();
 
-    if (need_to_send_host_info_) {
-      RemoteAction remote_action;
-      remote_action.i.display_num = display_info_list_.size();
-      remote_action.i.display_list =
-          (char**)malloc(remote_action.i.display_num * sizeof(char*));
-      remote_action.i.left =
-          (int*)malloc(remote_action.i.display_num * sizeof(int));
-      remote_action.i.top =
-          (int*)malloc(remote_action.i.display_num * sizeof(int));
-      remote_action.i.right =
-          (int*)malloc(remote_action.i.display_num * sizeof(int));
-      remote_action.i.bottom =
-          (int*)malloc(remote_action.i.display_num * sizeof(int));
-      for (int i = 0; i < remote_action.i.display_num; i++) {
-        LOG_INFO("Local display [{}:{}]", i + 1, display_info_list_[i].name);
-        remote_action.i.display_list[i] =
-            (char*)malloc(display_info_list_[i].name.length() + 1);
-        strncpy(remote_action.i.display_list[i],
-                display_info_list_[i].name.c_str(),
-                display_info_list_[i].name.length());
-        remote_action.i.display_list[i][display_info_list_[i].name.length()] =
-            '\0';
-        remote_action.i.left[i] = display_info_list_[i].left;
-        remote_action.i.top[i] = display_info_list_[i].top;
-        remote_action.i.right[i] = display_info_list_[i].right;
-        remote_action.i.bottom[i] = display_info_list_[i].bottom;
-      }
-
-      std::string host_name = GetHostName();
-      remote_action.type = ControlType::host_infomation;
-      memcpy(&remote_action.i.host_name, host_name.data(), host_name.size());
-      remote_action.i.host_name[host_name.size()] = '\0';
-      remote_action.i.host_name_size = host_name.size();
-
-      std::string msg = remote_action.to_json();
-      int ret =
-          SendDataFrame(peer_, msg.data(), msg.size(), data_label_.c_str());
-      FreeRemoteAction(remote_action);
-      if (0 == ret) {
-        need_to_send_host_info_ = false;
-      }
-    }
+    host_session_.SendPendingHostInfo();
   }
 }
 
@@ -1210,16 +1624,48 @@ void Render::UpdateLabels() {
 }
 
 void Render::HandleRecentConnections() {
-  if (reload_recent_connections_ && main_renderer_) {
+  if (pending_thumbnails_ && main_renderer_) {
+    // textures have to be created on the thread owning the renderer
+    int waiting = thumbnail_->UploadThumbnails(
+        main_renderer_, *pending_thumbnails_, recent_connections_,
+        &recent_connection_image_width_, &recent_connection_image_height_,
+        THUMBNAIL_UPLOADS_PER_FRAME);
+    if (waiting <= 0) {
+      pending_thumbnails_.reset();
+    }
+  }
+
+  // a reload requested while decoding waits for that decode to land
+  if (reload_recent_connections_ && main_renderer_ &&
+      !thumbnail_decode_pending_) {
     uint32_t now_time = SDL_GetTicks();
     if (now_time - recent_connection_image_save_time_ >= 50) {
-      int ret = thumbnail_->LoadThumbnail(main_renderer_, recent_connections_,
-                                          &recent_connection_image_width_,
-                                          &recent_connection_image_height_);
-      if (!ret) {
-        LOG_INFO("Load recent connection thumbnails");
-      }
       reload_recent_connections_ = false;
+      // nothing saved or deleted since the last decode
+      uint64_t generation = thumbnail_->GetGeneration();
+      if (generation == recent_connections_generation_) {
+        return;
+      }
+      thumbnail_decode_pending_ = true;
+
+      std::shared_ptr<Thumbnail> thumbnail = thumbnail_;
+      std::shared_ptr<UiTaskQueue> ui_tasks = ui_tasks_;
+      std::thread([this, thumbnail, ui_tasks, generation]() {
+        auto decoded =
+            std::make_shared<std::vector<Thumbnail::DecodedThumbnail>>();
+        thumbnail->DecodeThumbnails(decoded.get());
+        ui_tasks->Post([this, thumbnail, decoded, generation]() {
+          thumbnail_decode_pending_ = false;
+          if (thumbnail != thumbnail_) {
+            // decoded from a store that has been replaced meanwhile
+            reload_recent_connections_ = true;
+            return;
+          }
+          recent_connections_generation_ = generation;
+          pending_thumbnails_ = decoded;
+          LOG_INFO("Load recent connection thumbnails");
+        });
+      }).detach();
     }
   }
 }
@@ -1242,6 +1688,20 @@ void Render::HandleStreamWindow() {
 }
 
 void Render::Cleanup() {
+  if (Tracer::Instance().IsEnabled()) {
+    ToggleTracing();
+  }
+
+  // adopt a peer still being created so CleanupPeers destroys it
+  if (peer_creation_thread_.joinable()) {
+    peer_creation_thread_.join();
+  }
+  ui_tasks_->RunPending();
+
+  metrics_server_.Stop();
+
+  host_session_.SetScreenCapturer(nullptr);
+  host_session_.SetKeyboardCapturer(nullptr);
   if (screen_capturer_) {
     screen_capturer_->Destroy();
     delete screen_capturer_;
@@ -1254,11 +1714,7 @@ void Render::Cleanup() {
     speaker_capturer_ = nullptr;
   }
 
-  if (mouse_controller_) {
-    mouse_controller_->Destroy();
-    delete mouse_controller_;
-    mouse_controller_ = nullptr;
-  }
+  StopMouseController();
 
   if (keyboard_capturer_) {
     delete keyboard_capturer_;
@@ -1292,6 +1748,7 @@ void Render::CleanupFactories() {
 
 void Render::CleanupPeer(std::shared_ptr<SubStreamWindowProperties> props) {
   SDL_FlushEvent(STREAM_REFRESH_EVENT);
+  RemoveAudioJitterBuffer(props->remote_id_);
 
   if (props->dst_buffer_) {
     thumbnail_->SaveToThumbnail(
@@ -1318,6 +1775,8 @@ void Render::CleanupPeers() {
     StopMouseController();
     StopKeyboardCapturer();
     LOG_INFO("Destroy peer [{}]", client_id_);
+    host_session_.SetPeer(nullptr);
+    host_session_.Reset();
     DestroyPeer(&peer_);
   }
 
@@ -1346,6 +1805,8 @@ void Render::CleanSubStreamWindowProperties(
     delete[] props->dst_buffer_;
     props->dst_buffer_ = nullptr;
   }
+
+  props->pipeline_stats_.Reset();
 }
 
 void Render::UpdateRenderRect() {
@@ -1452,6 +1913,7 @@ void Render::ProcessSdlEvent(const SDL_Event& event) {
             SDL_SetWindowFullscreen(main_window_, false);
             SDL_FlushEvents(STREAM_REFRESH_EVENT, STREAM_REFRESH_EVENT);
             memset(audio_buffer_, 0, 720);
+            RemoveAudioJitterBuffer(props->remote_id_);
           }
         }
 
@@ -1579,8 +2041,14 @@ void Render::ProcessSdlEvent(const SDL_Event& event) {
           SDL_DestroyProperties(nvProps);
         }
 
+        TRACE_SCOPE("texture_upload");
+        auto upload_start = std::chrono::steady_clock::now();
         SDL_UpdateTexture(props->stream_texture_, NULL, props->dst_buffer_,
                           props->texture_width_);
+        props->pipeline_stats_.OnTextureUploaded(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - upload_start)
+                .count());
       }
       break;
   }
@@ -11,26 +11,40 @@
 
 #include <atomic>
 #include <chrono>
+#include <deque>
 #include <fstream>
 #include <mutex>
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <shared_mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 #include "IconsFontAwesome6.h"
+#include "audio_jitter_buffer.h"
+#include "audio_mixer.h"
+#include "av_sync_controller.h"
+#include "clock_offset_estimator.h"
 #include "config_center.h"
+#include "daemon_state.h"
 #include "device_controller_factory.h"
+#include "host_session.h"
 #include "imgui.h"
 #include "imgui_impl_sdl3.h"
 #include "imgui_impl_sdlrenderer3.h"
 #include "imgui_internal.h"
+#include "latency_probe.h"
+#include "metrics.h"
+#include "metrics_server.h"
 #include "minirtc.h"
 #include "path_manager.h"
+#include "pipeline_stats.h"
 #include "screen_capturer_factory.h"
 #include "speaker_capturer_factory.h"
+#include "startup_timeline.h"
 #include "thumbnail.h"
+#include "ui_task_queue.h"
 
 #if _WIN32
 #include "win_tray.h"
@@ -39,6 +53,16 @@
 namespace crossdesk {
 class Render {
  public:
+  struct DelayedVideoFrame {
+    std::vector<unsigned char> data;
+    size_t size = 0;
+    int width = 0;
+    int height = 0;
+    int64_t received_us = 0;
+    int64_t captured_us = 0;
+    std::chrono::steady_clock::time_point due;
+  };
+
   struct SubStreamWindowProperties {
     Params params_;
     PeerPtr* peer_ = nullptr;
@@ -55,6 +79,11 @@ class Render {
     bool mouse_control_button_pressed_ = true;
     bool mouse_controller_is_started_ = false;
     bool audio_capture_button_pressed_ = true;
+    // playback volume of this tab in percent, 0 to 200
+    int audio_gain_percent_ = 100;
+    // last audio_capture state sent to the host and gain given to the mixer
+    bool audio_source_enabled_ = true;
+    int audio_gain_applied_ = -1;
     bool control_mouse_ = true;
     bool streaming_ = false;
     bool is_control_bar_in_left_ = true;
@@ -72,7 +101,7 @@ class Render {
     float control_window_min_width_ = 20;
     float control_window_max_width_ = 230;
     float control_window_min_height_ = 38;
-    float control_window_max_height_ = 180;
+    float control_window_max_height_ = 240;
     float control_window_width_ = 230;
     float control_window_height_ = 38;
     float control_bar_pos_x_ = 0;
@@ -121,6 +150,21 @@ class Render {
     int frame_count_ = 0;
     std::chrono::steady_clock::time_point last_time_;
     XNetTrafficStats net_traffic_stats_;
+    AvSyncController av_sync_;
+    // frames held back while audio lags, released by the main loop
+    std::mutex delayed_video_frames_mutex_;
+    std::deque<DelayedVideoFrame> delayed_video_frames_;
+    std::vector<std::vector<unsigned char>> free_video_buffers_;
+    PipelineStats pipeline_stats_;
+    bool pipeline_hud_enabled_ = false;
+    // host clock relative to ours, see UpdateClockSync
+    ClockOffsetEstimator clock_offset_;
+    int64_t clock_ping_t0_ = 0;
+    int clock_pings_sent_ = 0;
+    std::chrono::steady_clock::time_point last_clock_ping_time_;
+    std::atomic<int64_t> input_latency_us_{-1};
+    LatencyProbe latency_probe_;
+    bool latency_probe_auto_started_ = false;
   };
 
  public:
@@ -132,11 +176,22 @@ class Render {
 
  private:
   void InitializeLogger();
+  void InitializeMetrics();
+  // starts tracing, or stops it and writes the trace next to the logs
+  void ToggleTracing();
   void InitializeSettings();
   void InitializeSDL();
   void InitializeModules();
   void InitializeMainWindow();
   void MainLoop();
+  // work held back until the main window has been presented once
+  void UpdateDeferredStartup();
+  void StartUpdateCheck();
+  void ApplyUpdateCheckResult(const nlohmann::json& latest_version_info);
+  // restores what a crashed predecessor published, see DaemonState
+  void RestoreDaemonState();
+  void PublishDaemonState();
+  void ReportRestartReady();
   void UpdateLabels();
   void UpdateInteractions();
   void HandleRecentConnections();
@@ -149,6 +204,11 @@ class Render {
       std::shared_ptr<SubStreamWindowProperties> props);
   void UpdateRenderRect();
   void ProcessSdlEvent(const SDL_Event& event);
+  void PresentVideoFrame(SubStreamWindowProperties* props,
+                         const unsigned char* data, size_t size, int width,
+                         int height, int64_t received_us,
+                         int64_t captured_us);
+  void ReleaseDelayedVideoFrames();
 
  private:
   int CreateStreamRenderWindow();
@@ -181,12 +241,18 @@ class Render {
   int CreateStreamWindow();
   int DestroyStreamWindow();
   int SetupFontAndStyle(bool main_window);
+  // system CJK font of the current context, only requested here and added
+  // to the atlas before the next frame, nullptr until then
+  ImFont* SystemChineseFont();
+  void LoadRequestedFonts(bool main_window);
+  int LoadSystemChineseFontData();
   int DestroyMainWindowContext();
   int DestroyStreamWindowContext();
   int DrawMainWindow();
   int DrawStreamWindow();
   int ConfirmDeleteConnection();
   int NetTrafficStats(std::shared_ptr<SubStreamWindowProperties>& props);
+  int PipelineHud(std::shared_ptr<SubStreamWindowProperties>& props);
   void DrawConnectionStatusText(
       std::shared_ptr<SubStreamWindowProperties>& props);
 #ifdef __APPLE__
@@ -226,19 +292,16 @@ class Render {
   static SDL_HitTestResult HitTestCallback(SDL_Window* window,
                                            const SDL_Point* area, void* data);
 
-  static std::vector<char> SerializeRemoteAction(const RemoteAction& action);
-
-  static bool DeserializeRemoteAction(const char* data, size_t size,
-                                      RemoteAction& out);
-
-  static void FreeRemoteAction(RemoteAction& action);
-
  private:
   int SendKeyCommand(int key_code, bool is_down);
   int ProcessMouseEvent(const SDL_Event& event);
 
   static void SdlCaptureAudioIn(void* userdata, Uint8* stream, int len);
   static void SdlCaptureAudioOut(void* userdata, Uint8* stream, int len);
+  static void SDLCALL AudioStreamCallback(void* userdata,
+                                          SDL_AudioStream* stream,
+                                          int additional_amount,
+                                          int total_amount);
 
  private:
   int SaveSettingsIntoCacheFile();
@@ -258,9 +321,25 @@ class Render {
   int StopKeyboardCapturer();
 
   int CreateConnectionPeer();
+  int OnConnectionPeerCreated(PeerPtr* peer, uint64_t generation);
 
   int AudioDeviceInit();
   int AudioDeviceDestroy();
+  std::shared_ptr<AudioJitterBuffer> GetAudioJitterBuffer(
+      const std::string& remote_id, bool create);
+  void ResetAudioJitterBuffer(const std::string& remote_id, int channels);
+  void RemoveAudioJitterBuffer(const std::string& remote_id);
+  void SetAudioSessionGain(const std::string& remote_id, int gain_q14);
+  void UpdateSessionAudio();
+  void UpdateClockSync();
+  void UpdateLatencyProbes();
+  int64_t HostTimestamp(SubStreamWindowProperties* props);
+  void UpdateLatencyMetrics(SubStreamWindowProperties* props);
+  void UpdateAudioOutputFormat();
+  int SendAudioFormat(PeerPtr* peer, const std::string& data_label,
+                      int channels, int frame_duration_ms);
+  int AudioChannelsFromConfig();
+  int AudioFrameDurationFromConfig();
 
  private:
   struct CDCache {
@@ -291,6 +370,20 @@ class Render {
   int localization_language_index_ = -1;
   int localization_language_index_last_ = -1;
   bool modules_inited_ = false;
+  StartupTimeline startup_timeline_;
+  bool first_frame_presented_ = false;
+  bool first_peer_created_ = false;
+  // results of background tasks, drained by the main loop
+  std::shared_ptr<UiTaskQueue> ui_tasks_ = std::make_shared<UiTaskQueue>();
+  std::thread peer_creation_thread_;
+  bool peer_creation_pending_ = false;
+  // only the result of the latest CreateConnectionPeer is adopted
+  uint64_t peer_creation_generation_ = 0;
+  uint32_t last_peer_creation_time_ = 0;
+  DaemonState daemon_state_;
+  std::mutex daemon_state_mutex_;
+  bool warm_restart_ = false;
+  std::atomic<bool> restart_ready_reported_{false};
   /* ------ all windows property start ------ */
   float title_bar_width_ = 640;
   float title_bar_height_ = 30;
@@ -300,7 +393,8 @@ class Render {
   // thumbnail
   unsigned char aes128_key_[16];
   unsigned char aes128_iv_[16];
-  std::unique_ptr<Thumbnail> thumbnail_;
+  // shared with the background decode task
+  std::shared_ptr<Thumbnail> thumbnail_;
 
   // recent connections
   std::vector<std::pair<std::string, Thumbnail::RecentConnection>>
@@ -308,6 +402,12 @@ class Render {
   int recent_connection_image_width_ = 160;
   int recent_connection_image_height_ = 90;
   uint32_t recent_connection_image_save_time_ = 0;
+  bool thumbnail_decode_pending_ = false;
+  // thumbnail generation the list was decoded at
+  uint64_t recent_connections_generation_ = 0;
+  // decoded thumbnails still waiting for their textures
+  std::shared_ptr<std::vector<Thumbnail::DecodedThumbnail>>
+      pending_thumbnails_;
 
   // main window render
   SDL_Window* main_window_ = nullptr;
@@ -315,6 +415,11 @@ class Render {
   ImGuiContext* main_ctx_ = nullptr;
   ImFont* main_windows_system_chinese_font_ = nullptr;
   ImFont* stream_windows_system_chinese_font_ = nullptr;
+  bool main_windows_system_chinese_font_requested_ = false;
+  bool stream_windows_system_chinese_font_requested_ = false;
+  // the system font file is read once and shared by both atlases
+  std::vector<unsigned char> system_chinese_font_data_;
+  bool system_chinese_font_data_loaded_ = false;
   bool exit_ = false;
   const int sdl_refresh_ms_ = 16;  // ~60 FPS
 #if _WIN32
@@ -386,9 +491,21 @@ class Render {
   bool just_created_ = false;
   std::string controlled_remote_id_ = "";
   std::string focused_remote_id_ = "";
-  bool need_to_send_host_info_ = false;
   SDL_Event last_mouse_event;
-  SDL_AudioStream* output_stream_;
+  SDL_AudioStream* output_stream_ = nullptr;
+  // per-session playout buffers, pulled and mixed by the audio callback
+  std::unordered_map<std::string, std::shared_ptr<AudioJitterBuffer>>
+      audio_jitter_buffers_;
+  std::mutex audio_jitter_buffers_mutex_;
+  // Q14 gain per session, sessions without an entry play at unity
+  std::unordered_map<std::string, int> audio_session_gains_;
+  std::vector<int16_t> audio_pull_buffer_;
+  AudioMixer audio_mixer_;
+  // guarded by the output stream lock
+  int audio_output_channels_ = 1;
+  bool skip_background_audio_ = false;
+  // CROSSDESK_LATENCY_PROBE, probes run on every new session when set
+  int latency_probe_auto_samples_ = 0;
   uint32_t STREAM_REFRESH_EVENT = 0;
 
   // stream window render
@@ -445,6 +562,8 @@ class Render {
   std::string video_secondary_label_ = "secondary_display";
   std::string audio_label_ = "audio";
   std::string data_label_ = "data";
+  // everything this instance does as a host for its viewers
+  HostSession host_session_{audio_label_, data_label_};
   Params params_;
   SDL_AudioDeviceID input_dev_;
   SDL_AudioDeviceID output_dev_;
@@ -452,11 +571,12 @@ class Render {
   ScreenCapturer* screen_capturer_ = nullptr;
   SpeakerCapturerFactory* speaker_capturer_factory_ = nullptr;
   SpeakerCapturer* speaker_capturer_ = nullptr;
+  int speaker_capturer_channels_ = 1;
+  MetricsServer metrics_server_;
   DeviceControllerFactory* device_controller_factory_ = nullptr;
   MouseController* mouse_controller_ = nullptr;
   KeyboardCapturer* keyboard_capturer_ = nullptr;
   std::vector<DisplayInfo> display_info_list_;
-  uint64_t last_frame_time_;
   bool show_new_version_icon_ = false;
   bool show_new_version_icon_in_menu_ = true;
   uint64_t new_version_icon_last_trigger_time_ = 0;
@@ -1,12 +1,17 @@
+#include <algorithm>
 #include <cmath>
 
 #include "device_controller.h"
 #include "localization.h"
 #include "platform.h"
 #include "rd_log.h"
+#include "remote_action_codec.h"
 #include "render.h"
+#include "trace.h"
 
 #define NV12_BUFFER_SIZE 1280 * 720 * 3 / 2
+// 200 ms of lip sync delay at 60 fps with some headroom
+#define MAX_DELAYED_VIDEO_FRAMES 16
 
 namespace crossdesk {
 
@@ -26,6 +31,7 @@ int Render::SendKeyCommand(int key_code, bool is_down) {
         client_properties_.end()) {
       auto props = client_properties_[controlled_remote_id_];
       if (props->connection_status_ == ConnectionStatus::Connected) {
+        remote_action.timestamp = HostTimestamp(props.get());
         std::string msg = remote_action.to_json();
         if (props->peer_) {
           SendDataFrame(props->peer_, msg.c_str(), msg.size(),
@@ -97,6 +103,7 @@ int Render::ProcessMouseEvent(const SDL_Event& event) {
         remote_action.m.flag = MouseFlag::move;
       }
 
+      remote_action.timestamp = HostTimestamp(props.get());
       std::string msg = remote_action.to_json();
       if (props->peer_) {
         SendDataFrame(props->peer_, msg.c_str(), msg.size(),
@@ -144,6 +151,7 @@ int Render::ProcessMouseEvent(const SDL_Event& event) {
           (float)(last_mouse_event.button.y - props->stream_render_rect_.y) /
           render_height;
 
+      remote_action.timestamp = HostTimestamp(props.get());
       std::string msg = remote_action.to_json();
       if (props->peer_) {
         SendDataFrame(props->peer_, msg.c_str(), msg.size(),
@@ -226,53 +234,151 @@ void Render::OnReceiveVideoBufferCb(const XVideoFrame* video_frame,
   SubStreamWindowProperties* props =
       render->client_properties_.find(remote_id)->second.get();
 
-  if (props->connection_established_) {
-    if (!props->dst_buffer_) {
-      props->dst_buffer_capacity_ = video_frame->size;
-      props->dst_buffer_ = new unsigned char[video_frame->size];
+  if (!props->connection_established_) {
+    return;
+  }
+
+  TRACE_SCOPE("receive_video_frame");
+  auto now = std::chrono::steady_clock::now();
+  int64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                       now.time_since_epoch())
+                       .count();
+  props->pipeline_stats_.OnFrameReceived(now_us);
+  if (props->latency_probe_.IsWaiting()) {
+    uint8_t marker = LatencyMarker::Detect(
+        (const uint8_t*)video_frame->data, video_frame->width,
+        video_frame->height);
+    if (marker != 0) {
+      props->latency_probe_.OnMarker(marker, now_us);
     }
+  }
+  int delay_ms = 0;
+  int64_t captured_us = 0;
+  if (video_frame->captured_timestamp > 0 &&
+      props->clock_offset_.GetStats().valid) {
+    // capture time on our steady clock, through the host clock offset
+    int64_t one_way_us =
+        GetSystemTimeMicros(props->peer_) -
+        props->clock_offset_.RemoteToLocal(video_frame->captured_timestamp);
+    captured_us = now_us - one_way_us;
+  }
+  if (video_frame->captured_timestamp > 0) {
+    props->av_sync_.OnVideoFrame(video_frame->captured_timestamp, now_us);
+    delay_ms = props->av_sync_.VideoDelayMs();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(props->delayed_video_frames_mutex_);
+    // keep queueing until the queue drained so frames never overtake
+    if (delay_ms > 0 || !props->delayed_video_frames_.empty()) {
+      if (props->delayed_video_frames_.size() >= MAX_DELAYED_VIDEO_FRAMES) {
+        props->free_video_buffers_.push_back(
+            std::move(props->delayed_video_frames_.front().data));
+        props->delayed_video_frames_.pop_front();
+        props->pipeline_stats_.OnFrameDropped();
+      }
 
-    if (props->dst_buffer_capacity_ < video_frame->size) {
-      delete props->dst_buffer_;
-      props->dst_buffer_capacity_ = video_frame->size;
-      props->dst_buffer_ = new unsigned char[video_frame->size];
+      DelayedVideoFrame frame;
+      if (!props->free_video_buffers_.empty()) {
+        frame.data = std::move(props->free_video_buffers_.back());
+        props->free_video_buffers_.pop_back();
+      }
+      if (frame.data.size() < video_frame->size) {
+        frame.data.resize(video_frame->size);
+      }
+      memcpy(frame.data.data(), video_frame->data, video_frame->size);
+      frame.size = video_frame->size;
+      frame.width = video_frame->width;
+      frame.height = video_frame->height;
+      frame.received_us = now_us;
+      frame.captured_us = captured_us;
+      frame.due = now + std::chrono::milliseconds(delay_ms);
+      props->delayed_video_frames_.push_back(std::move(frame));
+      return;
     }
+  }
+
+  render->PresentVideoFrame(props, (const unsigned char*)video_frame->data,
+                            video_frame->size, video_frame->width,
+                            video_frame->height, now_us, captured_us);
+}
 
-    memcpy(props->dst_buffer_, video_frame->data, video_frame->size);
-    bool need_to_update_render_rect = false;
-    if (props->video_width_ != props->video_width_last_ ||
-        props->video_height_ != props->video_height_last_) {
-      need_to_update_render_rect = true;
-      props->video_width_last_ = props->video_width_;
-      props->video_height_last_ = props->video_height_;
+void Render::PresentVideoFrame(SubStreamWindowProperties* props,
+                               const unsigned char* data, size_t size,
+                               int width, int height, int64_t received_us,
+                               int64_t captured_us) {
+  props->pipeline_stats_.OnFrameReady(received_us, captured_us);
+  if (!props->dst_buffer_) {
+    props->dst_buffer_capacity_ = size;
+    props->dst_buffer_ = new unsigned char[size];
+  }
+
+  if (props->dst_buffer_capacity_ < size) {
+    delete props->dst_buffer_;
+    props->dst_buffer_capacity_ = size;
+    props->dst_buffer_ = new unsigned char[size];
+  }
+
+  memcpy(props->dst_buffer_, data, size);
+  bool need_to_update_render_rect = false;
+  if (props->video_width_ != props->video_width_last_ ||
+      props->video_height_ != props->video_height_last_) {
+    need_to_update_render_rect = true;
+    props->video_width_last_ = props->video_width_;
+    props->video_height_last_ = props->video_height_;
+  }
+  props->video_width_ = width;
+  props->video_height_ = height;
+  props->video_size_ = size;
+
+  if (need_to_update_render_rect) {
+    UpdateRenderRect();
+  }
+
+  SDL_Event event;
+  event.type = STREAM_REFRESH_EVENT;
+  event.user.data1 = props;
+  SDL_PushEvent(&event);
+  props->streaming_ = true;
+
+  if (props->net_traffic_stats_button_pressed_ ||
+      props->pipeline_hud_enabled_) {
+    props->frame_count_++;
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       now - props->last_time_)
+                       .count();
+
+    if (elapsed >= 1000) {
+      props->fps_ = props->frame_count_ * 1000 / elapsed;
+      props->frame_count_ = 0;
+      props->last_time_ = now;
     }
-    props->video_width_ = video_frame->width;
-    props->video_height_ = video_frame->height;
-    props->video_size_ = video_frame->size;
+  }
+}
 
-    if (need_to_update_render_rect) {
-      render->UpdateRenderRect();
+void Render::ReleaseDelayedVideoFrames() {
+  auto now = std::chrono::steady_clock::now();
+  for (auto& it : client_properties_) {
+    SubStreamWindowProperties* props = it.second.get();
+    std::lock_guard<std::mutex> lock(props->delayed_video_frames_mutex_);
+    auto& frames = props->delayed_video_frames_;
+    if (frames.empty() || frames.front().due > now) {
+      continue;
     }
 
-    SDL_Event event;
-    event.type = render->STREAM_REFRESH_EVENT;
-    event.user.data1 = props;
-    SDL_PushEvent(&event);
-    props->streaming_ = true;
-
-    if (props->net_traffic_stats_button_pressed_) {
-      props->frame_count_++;
-      auto now = std::chrono::steady_clock::now();
-      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                         now - props->last_time_)
-                         .count();
-
-      if (elapsed >= 1000) {
-        props->fps_ = props->frame_count_ * 1000 / elapsed;
-        props->frame_count_ = 0;
-        props->last_time_ = now;
-      }
+    // only the newest due frame is worth showing
+    while (frames.size() > 1 && frames[1].due <= now) {
+      props->free_video_buffers_.push_back(std::move(frames.front().data));
+      frames.pop_front();
+      props->pipeline_stats_.OnFrameDropped();
     }
+
+    DelayedVideoFrame& frame = frames.front();
+    PresentVideoFrame(props, frame.data.data(), frame.size, frame.width,
+                      frame.height, frame.received_us, frame.captured_us);
+    props->free_video_buffers_.push_back(std::move(frame.data));
+    frames.pop_front();
   }
 }
 
@@ -286,13 +392,58 @@ void Render::OnReceiveAudioBufferCb(const char* data, size_t size,
 
   render->audio_buffer_fresh_ = true;
 
-  if (render->output_stream_) {
-    int pushed = SDL_PutAudioStreamData(
-        render->output_stream_, (const Uint8*)data, static_cast<int>(size));
-    if (pushed < 0) {
-      LOG_ERROR("Failed to push audio data: {}", SDL_GetError());
+  if (!render->output_stream_) {
+    return;
+  }
+
+  std::string remote_id(user_id, user_id_size);
+  auto jitter_buffer = render->GetAudioJitterBuffer(remote_id, true);
+  jitter_buffer->Push((const int16_t*)data,
+                      size / (sizeof(int16_t) * jitter_buffer->Channels()));
+}
+
+void SDLCALL Render::AudioStreamCallback(void* userdata,
+                                         SDL_AudioStream* stream,
+                                         int additional_amount,
+                                         [[maybe_unused]] int total_amount) {
+  Render* render = (Render*)userdata;
+  if (!render || additional_amount <= 0) {
+    return;
+  }
+
+  // the stream is locked while this runs, see UpdateAudioOutputFormat
+  int out_channels = render->audio_output_channels_;
+  size_t frame_count = additional_amount / (sizeof(int16_t) * out_channels);
+  size_t sample_count = frame_count * out_channels;
+  if (render->audio_pull_buffer_.size() < sample_count) {
+    render->audio_pull_buffer_.resize(sample_count);
+  }
+
+  int16_t* pull = render->audio_pull_buffer_.data();
+  AudioMixer& mixer = render->audio_mixer_;
+  mixer.Begin(frame_count, out_channels);
+
+  {
+    std::lock_guard<std::mutex> lock(render->audio_jitter_buffers_mutex_);
+    for (auto& it : render->audio_jitter_buffers_) {
+      // muted sessions are still drained so they resume in time
+      it.second->Pull(pull, frame_count);
+
+      auto gain_it = render->audio_session_gains_.find(it.first);
+      int gain_q14 = gain_it != render->audio_session_gains_.end()
+                         ? gain_it->second
+                         : AudioMixer::kUnityGain;
+      mixer.Add(pull, it.second->Channels(), gain_q14);
     }
   }
+
+  mixer.End(pull);
+
+  if (!SDL_PutAudioStreamData(
+          stream, pull, static_cast<int>(sample_count * sizeof(int16_t)))) {
+    LOG_ERROR_THROTTLED(1000, "Failed to push audio data: {}",
+                        SDL_GetError());
+  }
 }
 
 void Render::OnReceiveDataBufferCb(const char* data, size_t size,
@@ -319,7 +470,42 @@ void Render::OnReceiveDataBufferCb(const char* data, size_t size,
       render->client_properties_.end()) {
     // local
     auto props = render->client_properties_.find(remote_id)->second;
-    if (remote_action.type == ControlType::host_infomation &&
+    if (remote_action.type == ControlType::audio_dtx) {
+      auto jitter_buffer = render->GetAudioJitterBuffer(remote_id, false);
+      if (jitter_buffer) {
+        jitter_buffer->MarkDtx();
+      }
+    } else if (remote_action.type == ControlType::audio_timestamp) {
+      // sent next to the audio frames over the same path, so its arrival
+      // stands in for theirs
+      auto jitter_buffer = render->GetAudioJitterBuffer(remote_id, false);
+      if (jitter_buffer && remote_action.timestamp > 0) {
+        AudioJitterBuffer::Stats stats = jitter_buffer->GetStats();
+        props->av_sync_.OnAudioFrame(
+            remote_action.timestamp,
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch())
+                .count(),
+            stats.target_ms - stats.extra_delay_ms, stats.depth_ms);
+        jitter_buffer->SetExtraDelayMs(props->av_sync_.AudioDelayMs());
+      }
+    } else if (remote_action.type == ControlType::capture_fps) {
+      props->pipeline_stats_.SetHostCaptureFps(remote_action.d);
+    } else if (remote_action.type == ControlType::clock_pong) {
+      // pongs go to every viewer of the host, only ours matches t0
+      if (props->peer_ && remote_action.c.t0 == props->clock_ping_t0_) {
+        props->clock_offset_.OnPong(remote_action.c.t0, remote_action.c.t1,
+                                    remote_action.c.t2,
+                                    GetSystemTimeMicros(props->peer_));
+        props->input_latency_us_ = remote_action.c.input_latency_us;
+        render->UpdateLatencyMetrics(props.get());
+      }
+    } else if (remote_action.type == ControlType::audio_format) {
+      LOG_INFO("[{}] audio format {} channel(s), {} ms frames", remote_id,
+               remote_action.f.channels, remote_action.f.frame_duration_ms);
+      render->ResetAudioJitterBuffer(remote_id,
+                                     remote_action.f.channels == 2 ? 2 : 1);
+    } else if (remote_action.type == ControlType::host_infomation &&
         props->remote_host_name_.empty()) {
       props->remote_host_name_ = std::string(remote_action.i.host_name,
                                              remote_action.i.host_name_size);
@@ -335,27 +521,45 @@ void Render::OnReceiveDataBufferCb(const char* data, size_t size,
     FreeRemoteAction(remote_action);
   } else {
     // remote
-    if (remote_action.type == ControlType::mouse && render->mouse_controller_) {
-      render->mouse_controller_->SendMouseCommand(remote_action,
-                                                  render->selected_display_);
-    } else if (remote_action.type == ControlType::audio_capture) {
-      if (remote_action.a && !render->start_speaker_capturer_)
-        render->StartSpeakerCapturer();
-      else if (!remote_action.a && render->start_speaker_capturer_)
-        render->StopSpeakerCapturer();
-    } else if (remote_action.type == ControlType::keyboard &&
-               render->keyboard_capturer_) {
-      render->keyboard_capturer_->SendKeyboardCommand(
-          (int)remote_action.k.key_value,
-          remote_action.k.flag == KeyFlag::key_down);
-    } else if (remote_action.type == ControlType::display_id &&
-               render->screen_capturer_) {
-      render->selected_display_ = remote_action.d;
-      render->screen_capturer_->SwitchTo(remote_action.d);
+    render->host_session_.OnDataMessage(remote_id, remote_action);
+    if (remote_action.type == ControlType::audio_capture) {
+      render->start_speaker_capturer_ = render->host_session_.AudioWanted();
+    } else if (remote_action.type == ControlType::display_id) {
+      render->selected_display_ = render->host_session_.SelectedDisplay();
+      render->PublishDaemonState();
     }
   }
 }
 
+void Render::UpdateLatencyMetrics(SubStreamWindowProperties* props) {
+  MetricsRegistry& registry = MetricsRegistry::Instance();
+  std::string session = MetricLabel("session", props->remote_id_);
+  ClockOffsetEstimator::Stats clock_stats = props->clock_offset_.GetStats();
+  registry
+      .GetGauge("crossdesk_clock_offset_ms",
+                "Host clock minus local clock", session)
+      ->Set(clock_stats.offset_us / 1000.0);
+  registry.GetGauge("crossdesk_rtt_ms", "Data channel round trip", session)
+      ->Set(clock_stats.rtt_us / 1000.0);
+
+  PipelineStats::Snapshot snapshot;
+  props->pipeline_stats_.GetSnapshot(&snapshot);
+  if (snapshot.capture_to_present_ms >= 0) {
+    registry
+        .GetGauge("crossdesk_capture_to_display_ms",
+                  "Host capture to local present latency", session)
+        ->Set(snapshot.capture_to_present_ms);
+  }
+
+  int64_t input_latency_us = props->input_latency_us_;
+  if (input_latency_us >= 0) {
+    registry
+        .GetGauge("crossdesk_input_to_injection_ms",
+                  "Local input to host injection latency", session)
+        ->Set(input_latency_us / 1000.0);
+  }
+}
+
 void Render::OnSignalStatusCb(SignalStatus status, const char* user_id,
                               size_t user_id_size, void* user_data) {
   Render* render = (Render*)user_data;
@@ -371,6 +575,7 @@ void Render::OnSignalStatusCb(SignalStatus status, const char* user_id,
     } else if (SignalStatus::SignalConnected == status) {
       render->signal_connected_ = true;
       LOG_INFO("[{}] connected to signal server", client_id);
+      render->ReportRestartReady();
     } else if (SignalStatus::SignalFailed == status) {
       render->signal_connected_ = false;
     } else if (SignalStatus::SignalClosed == status) {
@@ -416,6 +621,12 @@ void Render::OnConnectionStatusCb(ConnectionStatus status, const char* user_id,
   if (!render) return;
 
   std::string remote_id(user_id, user_id_size);
+  if (status == ConnectionStatus::Disconnected ||
+      status == ConnectionStatus::Failed ||
+      status == ConnectionStatus::Closed) {
+    MetricsRegistry::Instance().RemoveSeries(MetricLabel("session", remote_id));
+  }
+
   // std::shared_lock lock(render->client_properties_mutex_);
   auto it = render->client_properties_.find(remote_id);
   auto props = (it != render->client_properties_.end()) ? it->second : nullptr;
@@ -432,6 +643,11 @@ void Render::OnConnectionStatusCb(ConnectionStatus status, const char* user_id,
           render->need_to_create_stream_window_ = true;
         }
         props->connection_established_ = true;
+        // ask the host for our preferred audio format, it answers with the
+        // format it actually captures
+        render->SendAudioFormat(props->peer_, props->data_label_,
+                                render->AudioChannelsFromConfig(),
+                                render->AudioFrameDurationFromConfig());
         props->stream_render_rect_ = {
             0, (int)render->title_bar_height_,
             (int)render->stream_window_width_,
@@ -478,10 +694,10 @@ void Render::OnConnectionStatusCb(ConnectionStatus status, const char* user_id,
     render->is_client_mode_ = false;
     render->show_connection_status_window_ = true;
     render->connection_status_[remote_id] = status;
+    render->host_session_.OnConnectionStatus(remote_id, status);
 
     switch (status) {
       case ConnectionStatus::Connected: {
-        render->need_to_send_host_info_ = true;
         render->start_screen_capturer_ = true;
         render->start_speaker_capturer_ = true;
 #ifdef CROSSDESK_DEBUG
@@ -510,7 +726,6 @@ void Render::OnConnectionStatusCb(ConnectionStatus status, const char* user_id,
           render->start_speaker_capturer_ = false;
           render->start_mouse_controller_ = false;
           render->start_keyboard_capturer_ = false;
-          render->need_to_send_host_info_ = false;
           if (props) props->connection_established_ = false;
           if (render->audio_capture_) {
             render->StopSpeakerCapturer();
@@ -520,6 +735,9 @@ void Render::OnConnectionStatusCb(ConnectionStatus status, const char* user_id,
           render->connection_status_.erase(remote_id);
         }
 
+        // its mute request is gone, capture may stop if nobody else listens
+        render->start_speaker_capturer_ = render->host_session_.AudioWanted();
+
         if (std::all_of(render->connection_status_.begin(),
                         render->connection_status_.end(), [](const auto& kv) {
                           return kv.first.find("web") == std::string::npos;
@@ -532,6 +750,7 @@ void Render::OnConnectionStatusCb(ConnectionStatus status, const char* user_id,
       default:
         break;
     }
+    render->PublishDaemonState();
   }
 }
 
@@ -574,9 +793,14 @@ void Render::NetStatusReport(const char* client_id, size_t client_id_size,
 
     LOG_INFO("Use client id [{}] and save id into cache file", id);
     render->SaveSettingsIntoCacheFile();
+    render->PublishDaemonState();
   }
 
   std::string remote_id(user_id, user_id_size);
+  if (net_traffic_stats && !remote_id.empty()) {
+    HostSession::UpdateTrafficMetrics(remote_id, *net_traffic_stats);
+  }
+
   // std::shared_lock lock(render->client_properties_mutex_);
   if (render->client_properties_.find(remote_id) ==
       render->client_properties_.end()) {
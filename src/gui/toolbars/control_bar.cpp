@@ -145,22 +145,28 @@ int Render::ControlBar(std::shared_ptr<SubStreamWindowProperties>& props) {
                             : ICON_FA_VOLUME_HIGH;
     if (ImGui::Button(audio.c_str(), ImVec2(button_width, button_height))) {
       if (props->connection_established_) {
+        // UpdateSessionAudio tells the host and the mixer
         props->audio_capture_button_pressed_ =
             !props->audio_capture_button_pressed_;
         props->audio_capture_button_label_ =
             props->audio_capture_button_pressed_
                 ? localization::audio_capture[localization_language_index_]
                 : localization::mute[localization_language_index_];
-
-        RemoteAction remote_action;
-        remote_action.type = ControlType::audio_capture;
-        remote_action.a = props->audio_capture_button_pressed_;
-        std::string msg = remote_action.to_json();
-        SendDataFrame(props->peer_, msg.c_str(), msg.size(),
-                      props->data_label_.c_str());
       }
     }
 
+    // right click for the playback volume of this tab
+    if (ImGui::BeginPopupContextItem("##audio_gain")) {
+      ImGui::SetWindowFontScale(0.5f);
+      ImGui::Text("%s",
+                  localization::volume[localization_language_index_].c_str());
+      ImGui::SetNextItemWidth(120.0f * dpi_scale_);
+      ImGui::SliderInt("##audio_gain_percent", &props->audio_gain_percent_, 0,
+                       200, "%d%%");
+      ImGui::SetWindowFontScale(1.0f);
+      ImGui::EndPopup();
+    }
+
     if (!props->audio_capture_button_pressed_) {
       float line_thickness = 2.0f * dpi_scale_;
       draw_list->AddLine(ImVec2(disable_audio_x, disable_audio_y),
@@ -201,6 +207,30 @@ int Render::ControlBar(std::shared_ptr<SubStreamWindowProperties>& props) {
                     [localization_language_index_];
     }
 
+    // right click for the frame timing overlay
+    if (ImGui::BeginPopupContextItem("##pipeline_hud")) {
+      ImGui::SetWindowFontScale(0.5f);
+      ImGui::Checkbox(
+          localization::pipeline_hud[localization_language_index_].c_str(),
+          &props->pipeline_hud_enabled_);
+
+      LatencyProbe::Result probe_result = props->latency_probe_.GetResult();
+      if (probe_result.running) {
+        ImGui::Text("%s %d/%d",
+                    localization::measuring_latency[localization_language_index_]
+                        .c_str(),
+                    probe_result.sample_count + probe_result.lost_count,
+                    probe_result.target_count);
+      } else if (ImGui::Button(
+                     localization::measure_latency[localization_language_index_]
+                         .c_str())) {
+        props->latency_probe_.Start(50);
+        props->pipeline_hud_enabled_ = true;
+      }
+      ImGui::SetWindowFontScale(1.0f);
+      ImGui::EndPopup();
+    }
+
     if (button_color_style_pushed) {
       ImGui::PopStyleColor();
       button_color_style_pushed = false;
@@ -345,6 +375,69 @@ int Render::NetTrafficStats(std::shared_ptr<SubStreamWindowProperties>& props) {
     ImGui::TableNextColumn();
     ImGui::Text("%d", props->fps_);
 
+    auto jitter_buffer = GetAudioJitterBuffer(props->remote_id_, false);
+    AudioJitterBuffer::Stats audio_stats;
+    if (jitter_buffer) {
+      audio_stats = jitter_buffer->GetStats();
+    }
+    ImGui::TableNextColumn();
+    ImGui::Text(
+        "%s",
+        localization::audio_buffer[localization_language_index_].c_str());
+    ImGui::TableNextColumn();
+    ImGui::Text("%d/%d ms", audio_stats.depth_ms, audio_stats.target_ms);
+    ImGui::TableNextColumn();
+    ImGui::Text(
+        "%s",
+        localization::audio_underrun[localization_language_index_].c_str());
+    ImGui::TableNextColumn();
+    ImGui::Text("%llu", (unsigned long long)audio_stats.underruns);
+
+    AvSyncController::Stats av_sync_stats = props->av_sync_.GetStats();
+    ImGui::TableNextColumn();
+    ImGui::Text("%s",
+                localization::av_offset[localization_language_index_].c_str());
+    ImGui::TableNextColumn();
+    if (av_sync_stats.active) {
+      ImGui::Text("%+d ms", av_sync_stats.offset_ms);
+    } else {
+      ImGui::Text("-");
+    }
+
+    ClockOffsetEstimator::Stats clock_stats = props->clock_offset_.GetStats();
+    ImGui::TableNextColumn();
+    ImGui::Text("%s", localization::rtt[localization_language_index_].c_str());
+    ImGui::TableNextColumn();
+    if (clock_stats.valid) {
+      ImGui::Text("%d ms", (int)(clock_stats.rtt_us / 1000));
+    } else {
+      ImGui::Text("-");
+    }
+
+    PipelineStats::Snapshot pipeline_snapshot;
+    props->pipeline_stats_.GetSnapshot(&pipeline_snapshot);
+    ImGui::TableNextColumn();
+    ImGui::Text(
+        "%s", localization::latency[localization_language_index_].c_str());
+    ImGui::TableNextColumn();
+    if (pipeline_snapshot.capture_to_present_ms >= 0) {
+      ImGui::Text("%d ms", (int)pipeline_snapshot.capture_to_present_ms);
+    } else {
+      ImGui::Text("-");
+    }
+
+    int64_t input_latency_us = props->input_latency_us_;
+    ImGui::TableNextColumn();
+    ImGui::Text(
+        "%s",
+        localization::input_latency[localization_language_index_].c_str());
+    ImGui::TableNextColumn();
+    if (input_latency_us >= 0) {
+      ImGui::Text("%d ms", (int)(input_latency_us / 1000));
+    } else {
+      ImGui::Text("-");
+    }
+
     ImGui::EndTable();
   }
 
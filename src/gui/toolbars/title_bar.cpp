@@ -1,6 +1,7 @@
 #include "localization.h"
 #include "rd_log.h"
 #include "render.h"
+#include "trace.h"
 
 #define BUTTON_PADDING 36.0f * dpi_scale_
 #define NEW_VERSION_ICON_RENDER_TIME_INTERVAL 2000
@@ -87,6 +88,15 @@ int Render::TitleBar(bool main_window) {
           ImGui::EndTooltip();
         }
 
+        if (ImGui::MenuItem(
+                Tracer::Instance().IsEnabled()
+                    ? localization::stop_trace[localization_language_index_]
+                          .c_str()
+                    : localization::start_trace[localization_language_index_]
+                          .c_str())) {
+          ToggleTracing();
+        }
+
         ImGui::EndMenu();
       } else {
         show_new_version_icon_in_menu_ = true;
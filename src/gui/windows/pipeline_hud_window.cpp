@@ -0,0 +1,93 @@
+#include "localization.h"
+#include "render.h"
+
+namespace crossdesk {
+
+static void PlotHistory(const char* id, const std::string& label,
+                        const PipelineStats::History& history,
+                        float dpi_scale) {
+  int newest = (history.offset + PipelineStats::kHistorySize - 1) %
+               PipelineStats::kHistorySize;
+  char overlay[64];
+  snprintf(overlay, sizeof(overlay), "%s %.1f ms (max %.1f)", label.c_str(),
+           history.values[newest], history.max);
+  // a fixed floor keeps a steady stream from looking like noise
+  float scale_max = history.max > 33.0f ? history.max : 33.0f;
+  ImGui::PlotLines(id, history.values, PipelineStats::kHistorySize,
+                   history.offset, overlay, 0.0f, scale_max,
+                   ImVec2(220.0f * dpi_scale, 40.0f * dpi_scale));
+}
+
+int Render::PipelineHud(std::shared_ptr<SubStreamWindowProperties>& props) {
+  PipelineStats::Snapshot snapshot;
+  props->pipeline_stats_.GetSnapshot(&snapshot);
+
+  size_t queue_depth = 0;
+  {
+    std::lock_guard<std::mutex> lock(props->delayed_video_frames_mutex_);
+    queue_depth = props->delayed_video_frames_.size();
+  }
+
+  float y_boundary = fullscreen_button_pressed_ ? 0 : title_bar_height_;
+  ImGui::SetNextWindowPos(
+      ImVec2(10.0f * dpi_scale_, y_boundary + 40.0f * dpi_scale_),
+      ImGuiCond_Always);
+  ImGui::SetNextWindowBgAlpha(0.6f);
+  std::string hud_title = props->remote_id_ + "PipelineHud";
+  // never takes focus or input away from the remote desktop
+  ImGui::Begin(hud_title.c_str(), nullptr,
+               ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoInputs |
+                   ImGuiWindowFlags_NoDocking | ImGuiWindowFlags_NoNav |
+                   ImGuiWindowFlags_NoFocusOnAppearing |
+                   ImGuiWindowFlags_NoSavedSettings |
+                   ImGuiWindowFlags_AlwaysAutoResize);
+  ImGui::SetWindowFontScale(0.5f);
+
+  PlotHistory("##receive_interval",
+              localization::receive_interval[localization_language_index_],
+              snapshot.receive_interval_ms, dpi_scale_);
+  PlotHistory("##upload_time",
+              localization::upload_time[localization_language_index_],
+              snapshot.upload_ms, dpi_scale_);
+  PlotHistory("##present_interval",
+              localization::present_interval[localization_language_index_],
+              snapshot.present_interval_ms, dpi_scale_);
+
+  ImGui::Text(
+      "%s: %.1f ms",
+      localization::receive_to_present[localization_language_index_].c_str(),
+      snapshot.receive_to_present_ms);
+  if (snapshot.capture_to_present_ms >= 0) {
+    ImGui::Text(
+        "%s: %.1f ms",
+        localization::capture_to_present[localization_language_index_].c_str(),
+        snapshot.capture_to_present_ms);
+  }
+  ImGui::Text("%s: %d  %s: %llu",
+              localization::queue_depth[localization_language_index_].c_str(),
+              (int)queue_depth,
+              localization::dropped_frames[localization_language_index_]
+                  .c_str(),
+              (unsigned long long)snapshot.dropped_frames);
+  ImGui::Text(
+      "%s: %d  FPS: %d",
+      localization::host_capture_fps[localization_language_index_].c_str(),
+      snapshot.host_capture_fps, props->fps_);
+
+  LatencyProbe::Result probe_result = props->latency_probe_.GetResult();
+  if (probe_result.sample_count > 0) {
+    ImGui::Text(
+        "%s: p50 %.0f  p95 %.0f  max %.0f ms (%d/%d, %s %d)",
+        localization::click_to_pixels[localization_language_index_].c_str(),
+        probe_result.p50_ms, probe_result.p95_ms, probe_result.max_ms,
+        probe_result.sample_count, probe_result.target_count,
+        localization::lost[localization_language_index_].c_str(),
+        probe_result.lost_count);
+  }
+
+  ImGui::SetWindowFontScale(1.0f);
+  ImGui::End();
+
+  return 0;
+}
+}  // namespace crossdesk
@@ -138,8 +138,9 @@ int Render::RequestPermissionWindow() {
   ImGui::SetWindowFontScale(0.3f);
 
   // use system font
-  if (main_windows_system_chinese_font_ != nullptr) {
-    ImGui::PushFont(main_windows_system_chinese_font_);
+  ImFont* system_font = SystemChineseFont();
+  if (system_font != nullptr) {
+    ImGui::PushFont(system_font);
   }
 
   ImGui::SetCursorPosY(ImGui::GetCursorPosY() + ImGui::GetTextLineHeight() + 5.0f);
@@ -191,7 +192,7 @@ int Render::RequestPermissionWindow() {
   ImGui::SetWindowFontScale(0.45f);
 
   // pop system font
-  if (main_windows_system_chinese_font_ != nullptr) {
+  if (system_font != nullptr) {
     ImGui::PopFont();
   }
 
@@ -135,6 +135,9 @@ int Render::StreamWindow() {
           UpdateRenderRect();
 
           ControlWindow(props);
+          if (props->pipeline_hud_enabled_) {
+            PipelineHud(props);
+          }
 
           focused_remote_id_ = props->remote_id_;
 
@@ -216,6 +219,9 @@ int Render::StreamWindow() {
         UpdateRenderRect();
 
         ControlWindow(props);
+        if (props->pipeline_hud_enabled_) {
+          PipelineHud(props);
+        }
         ImGui::End();
 
         if (!props->peer_) {
@@ -111,8 +111,9 @@ int Render::UpdateNotificationWindow() {
     float scrollable_height =
         window_height - UPDATE_NOTIFICATION_RESERVED_HEIGHT;
 
-    if (main_windows_system_chinese_font_ != nullptr) {
-      ImGui::PushFont(main_windows_system_chinese_font_);
+    ImFont* system_font = SystemChineseFont();
+    if (system_font != nullptr) {
+      ImGui::PushFont(system_font);
     }
     // scrollable content area
     ImGui::SetCursorPosX(window_width * 0.05f);
@@ -163,7 +164,7 @@ int Render::UpdateNotificationWindow() {
     ImGui::EndChild();
 
     // pop system font
-    if (main_windows_system_chinese_font_ != nullptr) {
+    if (system_font != nullptr) {
       ImGui::PopFont();
     }
 
@@ -0,0 +1,503 @@
+#include "host_session.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "latency_probe.h"
+#include "platform.h"
+#include "rd_log.h"
+#include "trace.h"
+
+namespace crossdesk {
+
+static int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static bool IsClosedStatus(ConnectionStatus status) {
+  return status == ConnectionStatus::Closed ||
+         status == ConnectionStatus::Failed ||
+         status == ConnectionStatus::Disconnected;
+}
+
+HostSession::HostSession(const std::string& audio_label,
+                         const std::string& data_label)
+    : audio_label_(audio_label), data_label_(data_label) {
+  MetricsRegistry& registry = MetricsRegistry::Instance();
+  capture_frames_metric_ = registry.GetCounter(
+      "crossdesk_capture_frames_total", "Frames delivered by the capturer");
+  video_frames_sent_metric_ = registry.GetCounter(
+      "crossdesk_video_frames_sent_total", "Video frames handed to the encoder");
+  capture_fps_metric_ = CaptureFpsMetric();
+
+  const std::string help = "Speaker frames by silence detector decision";
+  speaker_frames_sent_metric_ =
+      registry.GetCounter("crossdesk_speaker_frames_total", help,
+                          MetricLabel("action", "send"));
+  speaker_frames_suppressed_metric_ =
+      registry.GetCounter("crossdesk_speaker_frames_total", help,
+                          MetricLabel("action", "suppress"));
+  speaker_frames_comfort_metric_ =
+      registry.GetCounter("crossdesk_speaker_frames_total", help,
+                          MetricLabel("action", "comfort"));
+
+  input_mouse_metric_ =
+      registry.GetCounter("crossdesk_input_events_total",
+                          "Remote input events injected on this host",
+                          MetricLabel("device", "mouse"));
+  input_keyboard_metric_ =
+      registry.GetCounter("crossdesk_input_events_total",
+                          "Remote input events injected on this host",
+                          MetricLabel("device", "keyboard"));
+  input_latency_metric_ = InputLatencyMetric();
+  probe_latency_metric_ = registry.GetHistogram(
+      "crossdesk_latency_probe_delivery_seconds",
+      "Viewer send to injection latency of latency probes",
+      {0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1});
+}
+
+HostSession::~HostSession() {}
+
+std::shared_ptr<Histogram> HostSession::InputLatencyMetric() {
+  return MetricsRegistry::Instance().GetHistogram(
+      "crossdesk_input_latency_seconds",
+      "Viewer send to injection latency of remote input events",
+      {0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1});
+}
+
+std::shared_ptr<Gauge> HostSession::CaptureFpsMetric() {
+  return MetricsRegistry::Instance().GetGauge(
+      "crossdesk_capture_fps", "Capturer frame rate over the last second");
+}
+
+// called about once a second per session, so looking the series up every
+// time is cheaper than keeping them per session
+void HostSession::UpdateTrafficMetrics(const std::string& remote_id,
+                                       const XNetTrafficStats& stats) {
+  MetricsRegistry& registry = MetricsRegistry::Instance();
+  std::string session = MetricLabel("session", remote_id);
+  auto report = [&](const char* stream, const char* direction,
+                    double bitrate) {
+    registry
+        .GetGauge("crossdesk_net_bitrate_bps", "Session bitrate",
+                  session + "," + MetricLabel("stream", stream) + "," +
+                      MetricLabel("direction", direction))
+        ->Set(bitrate);
+  };
+  auto report_loss = [&](const char* stream, double loss_rate) {
+    registry
+        .GetGauge("crossdesk_net_inbound_loss_rate",
+                  "Session inbound packet loss rate",
+                  session + "," + MetricLabel("stream", stream))
+        ->Set(loss_rate);
+  };
+
+  report("video", "inbound", stats.video_inbound_stats.bitrate);
+  report("video", "outbound", stats.video_outbound_stats.bitrate);
+  report("audio", "inbound", stats.audio_inbound_stats.bitrate);
+  report("audio", "outbound", stats.audio_outbound_stats.bitrate);
+  report("data", "inbound", stats.data_inbound_stats.bitrate);
+  report("data", "outbound", stats.data_outbound_stats.bitrate);
+  report("total", "inbound", stats.total_inbound_stats.bitrate);
+  report("total", "outbound", stats.total_outbound_stats.bitrate);
+  report_loss("video", stats.video_inbound_stats.loss_rate);
+  report_loss("audio", stats.audio_inbound_stats.loss_rate);
+  report_loss("data", stats.data_inbound_stats.loss_rate);
+  report_loss("total", stats.total_inbound_stats.loss_rate);
+}
+
+void HostSession::SetPeer(PeerPtr* peer) { peer_ = peer; }
+
+void HostSession::SetFps(int fps) { fps_ = fps > 0 ? fps : 30; }
+
+void HostSession::SetDisplayInfoList(
+    const std::vector<DisplayInfo>& display_info_list) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  display_info_list_ = display_info_list;
+}
+
+void HostSession::SetScreenCapturer(ScreenCapturer* screen_capturer) {
+  std::lock_guard<std::mutex> lock(device_mutex_);
+  screen_capturer_ = screen_capturer;
+}
+
+void HostSession::SetMouseController(MouseController* mouse_controller) {
+  std::lock_guard<std::mutex> lock(device_mutex_);
+  mouse_controller_ = mouse_controller;
+}
+
+void HostSession::SetKeyboardCapturer(KeyboardCapturer* keyboard_capturer) {
+  std::lock_guard<std::mutex> lock(device_mutex_);
+  keyboard_capturer_ = keyboard_capturer;
+}
+
+void HostSession::GetAudioFormat(int* channels, int* frame_duration_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  *channels = audio_channels_;
+  *frame_duration_ms = audio_frame_duration_ms_;
+}
+
+bool HostSession::TakeAudioFormatChanged() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  bool changed = audio_format_changed_;
+  audio_format_changed_ = false;
+  return changed;
+}
+
+void HostSession::UpdateAudioFormatLocked() {
+  if (connected_viewers_.empty()) {
+    // nobody listens, keep the capturer as it is until someone joins
+    return;
+  }
+
+  int channels = kLegacyAudioChannels;
+  int frame_duration_ms = kLegacyAudioFrameDurationMs;
+  const AudioFormatRequest* latest = nullptr;
+  for (const auto& remote_id : connected_viewers_) {
+    auto it = audio_format_requests_.find(remote_id);
+    if (it == audio_format_requests_.end()) {
+      latest = nullptr;
+      break;
+    }
+    if (!latest || it->second.sequence > latest->sequence) {
+      latest = &it->second;
+    }
+  }
+  if (latest) {
+    channels = latest->channels;
+    frame_duration_ms = latest->frame_duration_ms;
+  }
+
+  if (channels != audio_channels_ ||
+      frame_duration_ms != audio_frame_duration_ms_) {
+    audio_channels_ = channels;
+    audio_frame_duration_ms_ = frame_duration_ms;
+    audio_format_changed_ = true;
+  }
+}
+
+void HostSession::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  connected_viewers_.clear();
+  audio_muted_viewers_.clear();
+  viewer_input_latency_us_.clear();
+  audio_format_requests_.clear();
+  need_to_send_host_info_ = false;
+}
+
+void HostSession::OnConnectionStatus(const std::string& remote_id,
+                                     ConnectionStatus status) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (status == ConnectionStatus::Connected) {
+    connected_viewers_.insert(remote_id);
+    need_to_send_host_info_ = true;
+    // legacy until it asks for a format, which new viewers do right away
+    UpdateAudioFormatLocked();
+  } else if (IsClosedStatus(status)) {
+    connected_viewers_.erase(remote_id);
+    // forget its mute request, capture may stop if nobody else listens
+    audio_muted_viewers_.erase(remote_id);
+    viewer_input_latency_us_.erase(remote_id);
+    audio_format_requests_.erase(remote_id);
+    if (connected_viewers_.empty()) {
+      need_to_send_host_info_ = false;
+    }
+    UpdateAudioFormatLocked();
+  }
+}
+
+bool HostSession::AnyViewerConnected() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !connected_viewers_.empty();
+}
+
+bool HostSession::AllViewersWeb() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& remote_id : connected_viewers_) {
+    if (remote_id.find("web") == std::string::npos) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool HostSession::AudioWanted() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& remote_id : connected_viewers_) {
+    if (audio_muted_viewers_.count(remote_id) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void HostSession::OnDataMessage(const std::string& remote_id,
+                                const RemoteAction& remote_action) {
+  PeerPtr* peer = peer_;
+  if (remote_action.type == ControlType::mouse) {
+    std::lock_guard<std::mutex> lock(device_mutex_);
+    if (mouse_controller_) {
+      input_mouse_metric_->Increment();
+      mouse_controller_->SendMouseCommand(remote_action, selected_display_);
+      OnInputInjected(remote_id, remote_action.timestamp);
+    }
+  } else if (remote_action.type == ControlType::keyboard) {
+    std::lock_guard<std::mutex> lock(device_mutex_);
+    if (keyboard_capturer_) {
+      input_keyboard_metric_->Increment();
+      keyboard_capturer_->SendKeyboardCommand(
+          (int)remote_action.k.key_value,
+          remote_action.k.flag == KeyFlag::key_down);
+      OnInputInjected(remote_id, remote_action.timestamp);
+    }
+  } else if (remote_action.type == ControlType::latency_probe) {
+    // a real injection, answered by a marker in the next frame. Its delivery
+    // is kept out of the input latency, the viewer measures the whole path
+    std::lock_guard<std::mutex> lock(device_mutex_);
+    if (mouse_controller_ && mouse_controller_->SendIdleMove() == 0) {
+      int64_t latency_us = DeliveryLatencyUs(remote_action.timestamp);
+      if (latency_us >= 0) {
+        probe_latency_metric_->Observe(latency_us / 1000000.0);
+      }
+      pending_latency_marker_ = remote_action.d;
+    }
+  } else if (remote_action.type == ControlType::clock_ping) {
+    RemoteAction pong = remote_action;
+    pong.type = ControlType::clock_pong;
+    pong.c.t1 = GetSystemTimeMicros(peer);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto latency_it = viewer_input_latency_us_.find(remote_id);
+      pong.c.input_latency_us = latency_it != viewer_input_latency_us_.end()
+                                    ? latency_it->second
+                                    : -1;
+    }
+    pong.c.t2 = GetSystemTimeMicros(peer);
+    SendDataMessage(pong);
+  } else if (remote_action.type == ControlType::audio_capture) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (remote_action.a) {
+      audio_muted_viewers_.erase(remote_id);
+    } else {
+      audio_muted_viewers_.insert(remote_id);
+    }
+  } else if (remote_action.type == ControlType::audio_format) {
+    AudioFormatRequest request;
+    request.channels = remote_action.f.channels == 2 ? 2 : 1;
+    request.frame_duration_ms = remote_action.f.frame_duration_ms;
+    if (request.frame_duration_ms != 20 && request.frame_duration_ms != 40) {
+      request.frame_duration_ms = 10;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    request.sequence = ++audio_format_request_sequence_;
+    audio_format_requests_[remote_id] = request;
+    UpdateAudioFormatLocked();
+  } else if (remote_action.type == ControlType::display_id) {
+    std::lock_guard<std::mutex> lock(device_mutex_);
+    if (screen_capturer_) {
+      selected_display_ = remote_action.d;
+      screen_capturer_->SwitchTo(remote_action.d);
+    }
+  }
+}
+
+int64_t HostSession::DeliveryLatencyUs(int64_t sent_timestamp) {
+  if (sent_timestamp <= 0) {
+    // older viewer or one that has no clock offset yet
+    return -1;
+  }
+
+  int64_t latency_us = GetSystemTimeMicros(peer_) - sent_timestamp;
+  return latency_us < 0 ? 0 : latency_us;
+}
+
+void HostSession::OnInputInjected(const std::string& remote_id,
+                                  int64_t sent_timestamp) {
+  int64_t latency_us = DeliveryLatencyUs(sent_timestamp);
+  if (latency_us < 0) {
+    return;
+  }
+  input_latency_metric_->Observe(latency_us / 1000000.0);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = viewer_input_latency_us_.find(remote_id);
+  if (it == viewer_input_latency_us_.end()) {
+    viewer_input_latency_us_[remote_id] = latency_us;
+  } else {
+    it->second += (latency_us - it->second) / 8;
+  }
+}
+
+void HostSession::OnScreenFrame(unsigned char* data, int size, int width,
+                                int height, const char* display_name) {
+  PeerPtr* peer = peer_;
+  int64_t now_time = NowMs();
+  capture_frames_metric_->Increment();
+  ++capture_fps_frames_;
+  if (capture_fps_window_start_ == 0) {
+    capture_fps_window_start_ = now_time;
+  } else if (now_time - capture_fps_window_start_ >= 1000) {
+    double capture_fps =
+        capture_fps_frames_ * 1000.0 / (now_time - capture_fps_window_start_);
+    capture_fps_metric_->Set(capture_fps);
+    capture_fps_window_start_ = now_time;
+    capture_fps_frames_ = 0;
+
+    // viewers show it next to their own receive rate
+    RemoteAction remote_action;
+    remote_action.type = ControlType::capture_fps;
+    remote_action.d = (int)std::lround(capture_fps);
+    SendDataMessage(remote_action);
+  }
+
+  if (!peer || (now_time - last_frame_time_) * fps_ < 1000) {
+    return;
+  }
+
+  XVideoFrame frame;
+  frame.data = (const char*)data;
+  frame.size = size;
+  frame.width = width;
+  frame.height = height;
+  frame.captured_timestamp = GetSystemTimeMicros(peer);
+  int marker = pending_latency_marker_.exchange(0);
+  if (marker != 0) {
+    // the capture buffer is ours until the callback returns
+    LatencyMarker::Stamp(data, width, height, (uint8_t)marker);
+  }
+  TRACE_SCOPE("send_video_frame");
+  SendVideoFrame(peer, &frame, display_name);
+  video_frames_sent_metric_->Increment();
+  last_frame_time_ = now_time;
+}
+
+void HostSession::OnSpeakerFrame(unsigned char* data, size_t size) {
+  PeerPtr* peer = peer_;
+  auto action = audio_silence_detector_.Process((const int16_t*)data,
+                                                size / sizeof(int16_t));
+  if (action == AudioSilenceDetector::Action::kSend) {
+    speaker_frames_sent_metric_->Increment();
+    if (!peer) {
+      return;
+    }
+    int64_t captured_us = GetSystemTimeMicros(peer);
+    {
+      TRACE_SCOPE("send_audio_frame");
+      SendAudioFrame(peer, (const char*)data, size, audio_label_.c_str());
+    }
+
+    // the video capture clock for lip sync goes out of band, the frame itself
+    // may be encoded and viewers not knowing the message just ignore it
+    int64_t now_time = NowMs();
+    if (now_time - last_audio_timestamp_time_ >= kAudioTimestampIntervalMs) {
+      RemoteAction remote_action;
+      remote_action.type = ControlType::audio_timestamp;
+      remote_action.timestamp = captured_us;
+      SendDataMessage(remote_action);
+      last_audio_timestamp_time_ = now_time;
+    }
+  } else if (action == AudioSilenceDetector::Action::kComfort) {
+    speaker_frames_comfort_metric_->Increment();
+    // tells viewers the gap is silence rather than loss
+    RemoteAction remote_action;
+    remote_action.type = ControlType::audio_dtx;
+    remote_action.a = true;
+    SendDataMessage(remote_action);
+  } else {
+    speaker_frames_suppressed_metric_->Increment();
+  }
+}
+
+void HostSession::ResetAudio(int channels) {
+  audio_silence_detector_.SetChannels(channels);
+  audio_silence_detector_.Reset();
+}
+
+int HostSession::SendPendingHostInfo() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!need_to_send_host_info_) {
+      return 0;
+    }
+  }
+
+  if (0 != SendHostInfo()) {
+    return -1;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    need_to_send_host_info_ = false;
+  }
+  return SendAudioFormat();
+}
+
+int HostSession::SendHostInfo() {
+  std::vector<DisplayInfo> display_info_list;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    display_info_list = display_info_list_;
+  }
+
+  RemoteAction remote_action;
+  remote_action.type = ControlType::host_infomation;
+  remote_action.i.display_num = display_info_list.size();
+  remote_action.i.display_list =
+      (char**)malloc(remote_action.i.display_num * sizeof(char*));
+  remote_action.i.left = (int*)malloc(remote_action.i.display_num * sizeof(int));
+  remote_action.i.top = (int*)malloc(remote_action.i.display_num * sizeof(int));
+  remote_action.i.right =
+      (int*)malloc(remote_action.i.display_num * sizeof(int));
+  remote_action.i.bottom =
+      (int*)malloc(remote_action.i.display_num * sizeof(int));
+  for (size_t i = 0; i < remote_action.i.display_num; i++) {
+    const std::string& name = display_info_list[i].name;
+    remote_action.i.display_list[i] = (char*)malloc(name.length() + 1);
+    memcpy(remote_action.i.display_list[i], name.c_str(), name.length() + 1);
+    remote_action.i.left[i] = display_info_list[i].left;
+    remote_action.i.top[i] = display_info_list[i].top;
+    remote_action.i.right[i] = display_info_list[i].right;
+    remote_action.i.bottom[i] = display_info_list[i].bottom;
+  }
+
+  std::string host_name = GetHostName();
+  size_t host_name_size =
+      std::min(host_name.size(), sizeof(remote_action.i.host_name) - 1);
+  memcpy(&remote_action.i.host_name, host_name.data(), host_name_size);
+  remote_action.i.host_name[host_name_size] = '\0';
+  remote_action.i.host_name_size = host_name_size;
+
+  int ret = SendDataMessage(remote_action);
+
+  for (size_t i = 0; i < remote_action.i.display_num; i++) {
+    free(remote_action.i.display_list[i]);
+  }
+  free(remote_action.i.display_list);
+  free(remote_action.i.left);
+  free(remote_action.i.top);
+  free(remote_action.i.right);
+  free(remote_action.i.bottom);
+
+  return ret;
+}
+
+int HostSession::SendAudioFormat() {
+  RemoteAction remote_action;
+  remote_action.type = ControlType::audio_format;
+  GetAudioFormat(&remote_action.f.channels, &remote_action.f.frame_duration_ms);
+  return SendDataMessage(remote_action);
+}
+
+int HostSession::SendDataMessage(const RemoteAction& remote_action) {
+  PeerPtr* peer = peer_;
+  if (!peer) {
+    return -1;
+  }
+  std::string msg = remote_action.to_json();
+  return SendDataFrame(peer, msg.data(), msg.size(), data_label_.c_str());
+}
+}  // namespace crossdesk
@@ -0,0 +1,165 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _HOST_SESSION_H_
+#define _HOST_SESSION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "audio_silence_detector.h"
+#include "device_controller_factory.h"
+#include "display_info.h"
+#include "metrics.h"
+#include "minirtc.h"
+#include "screen_capturer.h"
+
+namespace crossdesk {
+
+// What a host does for the viewers of its peer, shared by the GUI and
+// crossdesk-server: sending captured frames, answering and applying viewer
+// messages and keeping track of who is connected. The owner creates the
+// peer, the capturers and the devices and hands them in, it also decides
+// when capture starts and stops from AudioWanted and the viewer count.
+class HostSession {
+ public:
+  HostSession(const std::string& audio_label, const std::string& data_label);
+  ~HostSession();
+
+ public:
+  // the series every host updates, for anyone reading them back in process
+  static std::shared_ptr<Histogram> InputLatencyMetric();
+  static std::shared_ptr<Gauge> CaptureFpsMetric();
+  // per session traffic, removed with the series labelled by the session
+  // once it closes. The GUI reports its outgoing sessions here as well
+  static void UpdateTrafficMetrics(const std::string& remote_id,
+                                   const XNetTrafficStats& stats);
+
+  // null while there is no peer, frames and messages are dropped then
+  void SetPeer(PeerPtr* peer);
+  void SetFps(int fps);
+  void SetDisplayInfoList(const std::vector<DisplayInfo>& display_info_list);
+  // the owner clears them before destroying the devices
+  void SetScreenCapturer(ScreenCapturer* screen_capturer);
+  void SetMouseController(MouseController* mouse_controller);
+  void SetKeyboardCapturer(KeyboardCapturer* keyboard_capturer);
+
+  int SelectedDisplay() { return selected_display_; }
+  void SetSelectedDisplay(int display) { selected_display_ = display; }
+
+  // one capturer feeds every viewer. Viewers that never sent audio_format,
+  // older builds and web clients, only play 10 ms mono, so that is what is
+  // captured while any of them is connected. Otherwise the latest request
+  // of a connected viewer wins
+  void GetAudioFormat(int* channels, int* frame_duration_ms);
+  // true once after the format changed, the capturer only takes its format
+  // in Init so the owner has to recreate it
+  bool TakeAudioFormatChanged();
+
+  // forgets every viewer, e.g. when the peer goes away
+  void Reset();
+  void OnConnectionStatus(const std::string& remote_id,
+                          ConnectionStatus status);
+  bool AnyViewerConnected();
+  // web viewers draw no cursor of their own, the capture has to
+  bool AllViewersWeb();
+  // one capturer feeds every viewer, it runs while anyone listens
+  bool AudioWanted();
+
+  // viewer to host messages, anything else is ignored
+  void OnDataMessage(const std::string& remote_id,
+                     const RemoteAction& remote_action);
+
+  // screen capture thread
+  void OnScreenFrame(unsigned char* data, int size, int width, int height,
+                     const char* display_name);
+  // speaker capture thread, ResetAudio before each start of the capturer
+  void OnSpeakerFrame(unsigned char* data, size_t size);
+  void ResetAudio(int channels);
+
+  // sends host info and the audio format if a viewer joined since the last
+  // time, returns 0 once both went out
+  int SendPendingHostInfo();
+  int SendAudioFormat();
+
+ private:
+  struct AudioFormatRequest {
+    int channels = 1;
+    int frame_duration_ms = 10;
+    uint64_t sequence = 0;
+  };
+
+ private:
+  void UpdateAudioFormatLocked();
+  int SendHostInfo();
+  int SendDataMessage(const RemoteAction& remote_action);
+  // viewer send to now on the host clock, -1 if the viewer sent no time
+  int64_t DeliveryLatencyUs(int64_t sent_timestamp);
+  void OnInputInjected(const std::string& remote_id, int64_t sent_timestamp);
+
+ private:
+  static constexpr int kLegacyAudioChannels = 1;
+  static constexpr int kLegacyAudioFrameDurationMs = 10;
+  // lip sync smooths over many samples, a few per second are plenty
+  static constexpr int kAudioTimestampIntervalMs = 100;
+
+  const std::string audio_label_;
+  const std::string data_label_;
+  std::atomic<PeerPtr*> peer_{nullptr};
+  std::atomic<int> fps_{30};
+  std::atomic<int> selected_display_{0};
+  // probe id to stamp into the next sent frame, 0 for none
+  std::atomic<int> pending_latency_marker_{0};
+
+  std::mutex mutex_;
+  std::vector<DisplayInfo> display_info_list_;
+  std::unordered_set<std::string> connected_viewers_;
+  // viewers that asked us to stop sending audio
+  std::unordered_set<std::string> audio_muted_viewers_;
+  // smoothed input delivery latency per viewer
+  std::unordered_map<std::string, int64_t> viewer_input_latency_us_;
+  bool need_to_send_host_info_ = false;
+  std::unordered_map<std::string, AudioFormatRequest> audio_format_requests_;
+  uint64_t audio_format_request_sequence_ = 0;
+  int audio_channels_ = kLegacyAudioChannels;
+  int audio_frame_duration_ms_ = kLegacyAudioFrameDurationMs;
+  bool audio_format_changed_ = false;
+
+  // held while injecting, so the owner can swap devices safely
+  std::mutex device_mutex_;
+  ScreenCapturer* screen_capturer_ = nullptr;
+  MouseController* mouse_controller_ = nullptr;
+  KeyboardCapturer* keyboard_capturer_ = nullptr;
+
+  // only used on the screen capture thread
+  int64_t last_frame_time_ = 0;
+  int64_t capture_fps_window_start_ = 0;
+  int capture_fps_frames_ = 0;
+
+  // only used on the speaker capture thread
+  AudioSilenceDetector audio_silence_detector_;
+  int64_t last_audio_timestamp_time_ = 0;
+
+  // resolved once, updating them is a single atomic operation
+  std::shared_ptr<Counter> capture_frames_metric_;
+  std::shared_ptr<Counter> video_frames_sent_metric_;
+  std::shared_ptr<Gauge> capture_fps_metric_;
+  std::shared_ptr<Counter> speaker_frames_sent_metric_;
+  std::shared_ptr<Counter> speaker_frames_suppressed_metric_;
+  std::shared_ptr<Counter> speaker_frames_comfort_metric_;
+  std::shared_ptr<Counter> input_mouse_metric_;
+  std::shared_ptr<Counter> input_keyboard_metric_;
+  std::shared_ptr<Histogram> input_latency_metric_;
+  std::shared_ptr<Histogram> probe_latency_metric_;
+};
+}  // namespace crossdesk
+#endif
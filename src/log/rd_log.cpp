@@ -3,15 +3,25 @@
 #include <atomic>
 #include <filesystem>
 
+#include "spdlog/async.h"
+#include "spdlog/async_logger.h"
+
 namespace crossdesk {
 
 namespace {
 
 std::string g_log_dir = "logs";
 std::once_flag g_logger_once_flag;
+std::shared_ptr<spdlog::details::thread_pool> g_thread_pool;
 std::shared_ptr<spdlog::logger> g_logger;
 std::atomic<bool> g_logger_created{false};
 
+// capture, audio and input threads only pay for formatting and an enqueue,
+// when the writer falls behind the oldest lines are dropped instead of
+// blocking the caller
+constexpr size_t kLogQueueSize = 8192;
+constexpr auto kLogFlushInterval = std::chrono::seconds(3);
+
 }  // namespace
 
 void InitLogger(const std::string& log_dir) {
@@ -54,12 +64,44 @@ std::shared_ptr<spdlog::logger> get_logger() {
     sinks.push_back(std::make_shared<spdlog::sinks::rotating_file_sink_mt>(
         filename, 5 * 1024 * 1024, 3));
 
-    g_logger = std::make_shared<spdlog::logger>(LOGGER_NAME, sinks.begin(),
-                                                sinks.end());
-    g_logger->flush_on(spdlog::level::info);
+    g_thread_pool =
+        std::make_shared<spdlog::details::thread_pool>(kLogQueueSize, 1);
+    g_logger = std::make_shared<spdlog::async_logger>(
+        LOGGER_NAME, sinks.begin(), sinks.end(), g_thread_pool,
+        spdlog::async_overflow_policy::overrun_oldest);
+    // flushing happens on the logging thread, warnings and errors go out
+    // right away and everything else at least every kLogFlushInterval
+    g_logger->flush_on(spdlog::level::warn);
     spdlog::register_logger(g_logger);
+    spdlog::flush_every(kLogFlushInterval);
   });
 
   return g_logger;
 }
+
+void ShutdownLogger() {
+  if (!g_logger_created.load()) {
+    return;
+  }
+
+  g_logger->flush();
+  // stops the periodic flusher and drops the registry reference
+  spdlog::shutdown();
+  // joins the worker after it wrote what is still queued
+  g_thread_pool.reset();
+}
+
+bool LogThrottle(std::atomic<int64_t>& last_ms, int64_t interval_ms) {
+  int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                       .count();
+  int64_t last = last_ms.load(std::memory_order_relaxed);
+  if (last != INT64_MIN && now_ms - last < interval_ms) {
+    return false;
+  }
+
+  // only one of several racing threads logs
+  return last_ms.compare_exchange_strong(last, now_ms,
+                                         std::memory_order_relaxed);
+}
 }  // namespace crossdesk
\ No newline at end of file
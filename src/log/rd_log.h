@@ -7,7 +7,9 @@
 #ifndef _RD_LOG_H_
 #define _RD_LOG_H_
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <iomanip>
 #include <iostream>
 #include <memory>
@@ -33,9 +35,43 @@ void InitLogger(const std::string& log_dir);
 
 std::shared_ptr<spdlog::logger> get_logger();
 
+// drains the queue and stops the logging thread, call once before main
+// returns. on windows the worker can not be joined from static destructors
+void ShutdownLogger();
+
+// true at most once per interval_ms for the given call site state
+bool LogThrottle(std::atomic<int64_t>& last_ms, int64_t interval_ms);
+
 #define LOG_INFO(...) SPDLOG_LOGGER_INFO(get_logger(), __VA_ARGS__)
 #define LOG_WARN(...) SPDLOG_LOGGER_WARN(get_logger(), __VA_ARGS__)
 #define LOG_ERROR(...) SPDLOG_LOGGER_ERROR(get_logger(), __VA_ARGS__)
 #define LOG_FATAL(...) SPDLOG_LOGGER_CRITICAL(get_logger(), __VA_ARGS__)
+
+// for per frame or per event paths, logs the 1st, (n+1)th, (2n+1)th... call
+#define RD_LOG_EVERY_N_(log_macro, n, ...)                               \
+  do {                                                                   \
+    static std::atomic<uint64_t> rd_log_occurrences{0};                  \
+    if (rd_log_occurrences.fetch_add(1, std::memory_order_relaxed) %     \
+            (uint64_t)(n) ==                                             \
+        0) {                                                             \
+      log_macro(__VA_ARGS__);                                            \
+    }                                                                    \
+  } while (0)
+
+// logs at most once every interval_ms per call site
+#define RD_LOG_THROTTLED_(log_macro, interval_ms, ...)                   \
+  do {                                                                   \
+    static std::atomic<int64_t> rd_log_last_ms{INT64_MIN};               \
+    if (crossdesk::LogThrottle(rd_log_last_ms, (interval_ms))) {         \
+      log_macro(__VA_ARGS__);                                            \
+    }                                                                    \
+  } while (0)
+
+#define LOG_WARN_EVERY_N(n, ...) RD_LOG_EVERY_N_(LOG_WARN, n, __VA_ARGS__)
+#define LOG_ERROR_EVERY_N(n, ...) RD_LOG_EVERY_N_(LOG_ERROR, n, __VA_ARGS__)
+#define LOG_WARN_THROTTLED(interval_ms, ...) \
+  RD_LOG_THROTTLED_(LOG_WARN, interval_ms, __VA_ARGS__)
+#define LOG_ERROR_THROTTLED(interval_ms, ...) \
+  RD_LOG_THROTTLED_(LOG_ERROR, interval_ms, __VA_ARGS__)
 }  // namespace crossdesk
 #endif
\ No newline at end of file
@@ -0,0 +1,696 @@
+#include "loopback_transport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "minirtc.h"
+#include "rd_log.h"
+
+#define LOOPBACK_NET_STATUS_INTERVAL_US 1000000
+#define LOOPBACK_CLIENT_ID_DIGITS 9
+#define LOOPBACK_PASSWORD_SIZE 6
+
+// minirtc only forward declares its peer, the loopback one lives here
+struct Peer {
+  Params params;
+  std::string user_id;
+  std::string id;
+  std::string password;
+  // hosts carry id@password and are reachable through JoinConnection
+  bool host = false;
+};
+
+namespace crossdesk {
+
+namespace {
+
+enum class EventType {
+  kVideo,
+  kAudio,
+  kData,
+  kSignalStatus,
+  kConnectionStatus,
+  kNetStatus
+};
+
+enum StreamKind { kVideoStream = 0, kAudioStream, kDataStream, kStreamCount };
+
+struct Event {
+  Peer* to = nullptr;
+  EventType type = EventType::kData;
+  // the sender as the receiver knows it, passed as user_id to the callback
+  std::string from;
+  // shared by every receiver of the same frame
+  std::shared_ptr<const std::vector<char>> payload;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  int64_t captured_timestamp = 0;
+  int status = 0;
+  XNetTrafficStats net_traffic_stats;
+};
+
+struct StreamWindow {
+  uint64_t bytes = 0;
+  uint64_t frames = 0;
+  uint64_t lost = 0;
+};
+
+// one direction of a connection
+struct Link {
+  std::string from_name;
+  int64_t busy_until_us = 0;
+  int64_t last_data_due_us = 0;
+  StreamWindow window[kStreamCount];
+};
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+class LoopbackHub {
+ public:
+  static LoopbackHub& Instance() {
+    static LoopbackHub hub;
+    return hub;
+  }
+
+  ~LoopbackHub() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  void Register(Peer* peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (peer->host) {
+      // the signal server hands out whatever the host does not bring along
+      while (peer->id.empty() || FindHost(peer->id)) {
+        peer->id = RandomString("0123456789", LOOPBACK_CLIENT_ID_DIGITS);
+      }
+      if (peer->password.empty()) {
+        peer->password = RandomString(
+            "abcdefghijklmnopqrstuvwxyz0123456789", LOOPBACK_PASSWORD_SIZE);
+      }
+      peer->user_id = peer->id + "@" + peer->password;
+    }
+    peers_.insert(peer);
+    if (!thread_.joinable()) {
+      thread_ = std::thread([this]() { DeliveryLoop(); });
+    }
+  }
+
+  void Unregister(Peer* peer) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      CloseLinks(peer, "", false);
+      peers_.erase(peer);
+      for (auto it = events_.begin(); it != events_.end();) {
+        it = it->second.to == peer ? events_.erase(it) : std::next(it);
+      }
+    }
+    // waits out a callback that is running for this peer right now
+    std::lock_guard<std::recursive_mutex> delivery_lock(delivery_mutex_);
+  }
+
+  void SignalIn(Peer* peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t now = NowUs();
+    Event connecting = StatusEvent(peer, EventType::kSignalStatus, peer->id,
+                                   (int)SignalStatus::SignalConnecting);
+    Push(now, std::move(connecting));
+    if (peer->host) {
+      // same report the signal server triggers once it assigned the id
+      Event identity;
+      identity.to = peer;
+      identity.type = EventType::kNetStatus;
+      identity.payload = std::make_shared<const std::vector<char>>(
+          peer->user_id.begin(), peer->user_id.end());
+      memset(&identity.net_traffic_stats, 0,
+             sizeof(identity.net_traffic_stats));
+      Push(now, std::move(identity));
+    }
+    Event connected = StatusEvent(peer, EventType::kSignalStatus, peer->id,
+                                  (int)SignalStatus::SignalConnected);
+    Push(now, std::move(connected));
+  }
+
+  int Join(Peer* peer, const std::string& transmission_id) {
+    std::string id = transmission_id.substr(0, transmission_id.find('@'));
+    std::string password;
+    if (transmission_id.find('@') != std::string::npos) {
+      password = transmission_id.substr(transmission_id.find('@') + 1);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t now = NowUs();
+    Peer* host = FindHost(id);
+    if (!host || host == peer) {
+      Push(now, StatusEvent(peer, EventType::kConnectionStatus, id,
+                            (int)ConnectionStatus::NoSuchTransmissionId));
+      return 0;
+    }
+    if (host->password != password) {
+      Push(now, StatusEvent(peer, EventType::kConnectionStatus, id,
+                            (int)ConnectionStatus::IncorrectPassword));
+      return 0;
+    }
+
+    links_[{peer, host}].from_name = peer->user_id;
+    links_[{host, peer}].from_name = host->id;
+    // the handshake costs one round trip
+    int64_t connected_at = now + 2 * (int64_t)impairment_.latency_ms * 1000;
+    for (auto& side : {std::make_pair(peer, host->id),
+                       std::make_pair(host, peer->user_id)}) {
+      Push(now, StatusEvent(side.first, EventType::kConnectionStatus,
+                            side.second, (int)ConnectionStatus::Connecting));
+      Push(connected_at,
+           StatusEvent(side.first, EventType::kConnectionStatus, side.second,
+                       (int)ConnectionStatus::Connected));
+    }
+    LOG_INFO("Loopback [{}] joined [{}]", peer->user_id, host->id);
+    return 0;
+  }
+
+  void Leave(Peer* peer, const std::string& transmission_id) {
+    std::string remote = transmission_id.substr(0, transmission_id.find('@'));
+    std::lock_guard<std::mutex> lock(mutex_);
+    // a host leaving its own transmission drops every viewer
+    CloseLinks(peer, remote == peer->id ? "" : remote, true);
+  }
+
+  void Send(Peer* peer, StreamKind kind, const char* data, size_t size,
+            uint32_t width, uint32_t height, int64_t captured_timestamp) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t now = NowUs();
+    std::shared_ptr<const std::vector<char>> payload;
+    for (auto& entry : links_) {
+      if (entry.first.first != peer) {
+        continue;
+      }
+      Link& link = entry.second;
+      bool media = kind != kDataStream;
+      StreamWindow& window = link.window[kind];
+      window.frames++;
+      window.bytes += size;
+      stats_.frames_sent++;
+
+      if (media && Chance(impairment_.loss_rate)) {
+        window.lost++;
+        stats_.frames_lost++;
+        continue;
+      }
+
+      int64_t due = now;
+      if (impairment_.bandwidth_kbps > 0) {
+        double charged = kind == kVideoStream
+                             ? size * impairment_.video_size_ratio
+                             : (double)size;
+        int64_t start = (std::max)(now, link.busy_until_us);
+        if (media &&
+            start - now > (int64_t)impairment_.max_queue_ms * 1000) {
+          window.lost++;
+          stats_.frames_lost++;
+          continue;
+        }
+        // bits over kbit/s gives milliseconds, times 1000 for microseconds
+        link.busy_until_us =
+            start + (int64_t)(charged * 8 * 1000 / impairment_.bandwidth_kbps);
+        due = link.busy_until_us;
+      }
+      due += (int64_t)impairment_.latency_ms * 1000;
+      if (impairment_.jitter_ms > 0) {
+        due += (int64_t)(Uniform() * impairment_.jitter_ms * 1000);
+      }
+      if (media && Chance(impairment_.reorder_rate)) {
+        // late enough for the next frames to overtake it
+        due += ((int64_t)impairment_.jitter_ms + 20) * 1000;
+        stats_.frames_reordered++;
+      }
+      if (!media) {
+        due = (std::max)(due, link.last_data_due_us);
+        link.last_data_due_us = due;
+      }
+
+      Event event;
+      event.to = entry.first.second;
+      event.type = kind == kVideoStream   ? EventType::kVideo
+                   : kind == kAudioStream ? EventType::kAudio
+                                          : EventType::kData;
+      event.from = link.from_name;
+      if (!payload) {
+        payload = std::make_shared<const std::vector<char>>(data, data + size);
+      }
+      event.payload = payload;
+      event.width = width;
+      event.height = height;
+      event.captured_timestamp = captured_timestamp;
+      Push(due, std::move(event));
+    }
+  }
+
+  void SetImpairment(const LoopbackImpairment& impairment) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    impairment_ = impairment;
+  }
+
+  std::vector<std::string> GetHosts() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> hosts;
+    for (Peer* peer : peers_) {
+      if (peer->host) {
+        hosts.push_back(peer->user_id);
+      }
+    }
+    return hosts;
+  }
+
+  LoopbackImpairment GetImpairment() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return impairment_;
+  }
+
+  LoopbackStats GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+ private:
+  LoopbackHub() : random_(std::random_device{}()) {
+    const char* spec = getenv(LOOPBACK_IMPAIRMENT_ENV);
+    if (spec) {
+      impairment_ = ParseLoopbackImpairment(spec);
+      LOG_INFO("Loopback impairment [{}]", spec);
+    }
+  }
+
+  Peer* FindHost(const std::string& id) {
+    for (Peer* peer : peers_) {
+      if (peer->host && peer->id == id) {
+        return peer;
+      }
+    }
+    return nullptr;
+  }
+
+  // closes peer's links to remote, or all of them when remote is empty
+  void CloseLinks(Peer* peer, const std::string& remote, bool notify_self) {
+    int64_t now = NowUs();
+    std::set<Peer*> closed;
+    for (auto& entry : links_) {
+      if (entry.first.second == peer &&
+          (remote.empty() || entry.second.from_name == remote)) {
+        closed.insert(entry.first.first);
+      }
+    }
+    for (Peer* other : closed) {
+      std::string other_name = links_[{other, peer}].from_name;
+      std::string self_name = links_[{peer, other}].from_name;
+      links_.erase({other, peer});
+      links_.erase({peer, other});
+      if (notify_self) {
+        Push(now, StatusEvent(peer, EventType::kConnectionStatus, other_name,
+                              (int)ConnectionStatus::Closed));
+      }
+      Push(now, StatusEvent(other, EventType::kConnectionStatus, self_name,
+                            (int)ConnectionStatus::Closed));
+    }
+  }
+
+  Event StatusEvent(Peer* to, EventType type, const std::string& from,
+                    int status) {
+    Event event;
+    event.to = to;
+    event.type = type;
+    event.from = from;
+    event.status = status;
+    return event;
+  }
+
+  void Push(int64_t due, Event&& event) {
+    bool earliest = events_.empty() || due < events_.begin()->first.first;
+    events_.emplace(std::make_pair(due, sequence_++), std::move(event));
+    if (earliest) {
+      cv_.notify_one();
+    }
+  }
+
+  double Uniform() {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(random_);
+  }
+
+  bool Chance(double rate) { return rate > 0 && Uniform() < rate; }
+
+  std::string RandomString(const char* alphabet, int size) {
+    std::string value;
+    size_t alphabet_size = strlen(alphabet);
+    for (int i = 0; i < size; i++) {
+      value += alphabet[random_() % alphabet_size];
+    }
+    return value;
+  }
+
+  // per connection report, inbound and outbound over the last interval
+  void QueueNetStatus(int64_t now) {
+    double seconds = LOOPBACK_NET_STATUS_INTERVAL_US / 1000000.0;
+    for (auto& entry : links_) {
+      Peer* self = entry.first.first;
+      Peer* remote = entry.first.second;
+      auto inbound_it = links_.find({remote, self});
+      if (inbound_it == links_.end()) {
+        continue;
+      }
+      const Link& outbound = entry.second;
+      const Link& inbound = inbound_it->second;
+
+      Event event;
+      event.to = self;
+      event.type = EventType::kNetStatus;
+      event.from = inbound.from_name;
+      event.payload = std::make_shared<const std::vector<char>>(
+          self->user_id.begin(), self->user_id.end());
+      XNetTrafficStats& stats = event.net_traffic_stats;
+      memset(&stats, 0, sizeof(stats));
+      uint64_t total_in_bytes = 0, total_in_frames = 0, total_in_lost = 0;
+      uint64_t total_out_bytes = 0;
+      for (int kind = 0; kind < kStreamCount; kind++) {
+        total_in_bytes += inbound.window[kind].bytes;
+        total_in_frames += inbound.window[kind].frames;
+        total_in_lost += inbound.window[kind].lost;
+        total_out_bytes += outbound.window[kind].bytes;
+      }
+      auto loss = [](uint64_t lost, uint64_t frames) {
+        return frames ? (float)lost / frames : 0.0f;
+      };
+      auto bitrate = [seconds](uint64_t bytes) {
+        return (uint32_t)(bytes * 8 / seconds);
+      };
+      stats.video_inbound_stats.bitrate =
+          bitrate(inbound.window[kVideoStream].bytes);
+      stats.video_inbound_stats.loss_rate = loss(
+          inbound.window[kVideoStream].lost, inbound.window[kVideoStream].frames);
+      stats.video_outbound_stats.bitrate =
+          bitrate(outbound.window[kVideoStream].bytes);
+      stats.audio_inbound_stats.bitrate =
+          bitrate(inbound.window[kAudioStream].bytes);
+      stats.audio_inbound_stats.loss_rate = loss(
+          inbound.window[kAudioStream].lost, inbound.window[kAudioStream].frames);
+      stats.audio_outbound_stats.bitrate =
+          bitrate(outbound.window[kAudioStream].bytes);
+      stats.data_inbound_stats.bitrate =
+          bitrate(inbound.window[kDataStream].bytes);
+      stats.data_outbound_stats.bitrate =
+          bitrate(outbound.window[kDataStream].bytes);
+      stats.total_inbound_stats.bitrate = bitrate(total_in_bytes);
+      stats.total_inbound_stats.loss_rate = loss(total_in_lost, total_in_frames);
+      stats.total_outbound_stats.bitrate = bitrate(total_out_bytes);
+      Push(now, std::move(event));
+    }
+
+    // every window was read once as inbound and once as outbound
+    for (auto& entry : links_) {
+      for (int kind = 0; kind < kStreamCount; kind++) {
+        entry.second.window[kind] = StreamWindow();
+      }
+    }
+  }
+
+  void DeliveryLoop() {
+    int64_t next_net_status_us = NowUs() + LOOPBACK_NET_STATUS_INTERVAL_US;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+      int64_t now = NowUs();
+      if (now >= next_net_status_us) {
+        QueueNetStatus(now);
+        next_net_status_us = now + LOOPBACK_NET_STATUS_INTERVAL_US;
+      }
+
+      int64_t wake_us = next_net_status_us;
+      if (!events_.empty()) {
+        wake_us = (std::min)(wake_us, events_.begin()->first.first);
+      }
+      if (wake_us > now) {
+        cv_.wait_for(lock, std::chrono::microseconds(wake_us - now));
+        continue;
+      }
+
+      auto it = events_.begin();
+      Event event = std::move(it->second);
+      events_.erase(it);
+      if (event.type == EventType::kVideo || event.type == EventType::kAudio ||
+          event.type == EventType::kData) {
+        stats_.frames_delivered++;
+        stats_.bytes_delivered += event.payload->size();
+      }
+
+      // Unregister takes this before it frees the peer, callbacks may call
+      // back into the hub so the hub lock is released meanwhile
+      std::unique_lock<std::recursive_mutex> delivery_lock(delivery_mutex_);
+      lock.unlock();
+      Deliver(event);
+      delivery_lock.unlock();
+      lock.lock();
+    }
+  }
+
+  void Deliver(const Event& event) {
+    const Params& params = event.to->params;
+    const char* from = event.from.c_str();
+    size_t from_size = event.from.size();
+    switch (event.type) {
+      case EventType::kVideo: {
+        if (params.on_receive_video_frame) {
+          XVideoFrame frame = {};
+          frame.data = event.payload->data();
+          frame.size = event.payload->size();
+          frame.width = event.width;
+          frame.height = event.height;
+          frame.captured_timestamp = event.captured_timestamp;
+          params.on_receive_video_frame(&frame, from, from_size,
+                                        params.user_data);
+        }
+        break;
+      }
+      case EventType::kAudio:
+        if (params.on_receive_audio_buffer) {
+          params.on_receive_audio_buffer(event.payload->data(),
+                                         event.payload->size(), from,
+                                         from_size, params.user_data);
+        }
+        break;
+      case EventType::kData:
+        if (params.on_receive_data_buffer) {
+          params.on_receive_data_buffer(event.payload->data(),
+                                        event.payload->size(), from, from_size,
+                                        params.user_data);
+        }
+        break;
+      case EventType::kSignalStatus:
+        if (params.on_signal_status) {
+          params.on_signal_status((SignalStatus)event.status, from, from_size,
+                                  params.user_data);
+        }
+        break;
+      case EventType::kConnectionStatus:
+        if (params.on_connection_status) {
+          params.on_connection_status((ConnectionStatus)event.status, from,
+                                      from_size, params.user_data);
+        }
+        break;
+      case EventType::kNetStatus:
+        if (params.net_status_report) {
+          std::string client_id(event.payload->begin(), event.payload->end());
+          params.net_status_report(client_id.c_str(), client_id.size(),
+                                   TraversalMode::UnknownMode,
+                                   &event.net_traffic_stats, from, from_size,
+                                   params.user_data);
+        }
+        break;
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::recursive_mutex delivery_mutex_;
+  std::thread thread_;
+  bool stop_ = false;
+
+  std::set<Peer*> peers_;
+  // keyed by sender and receiver
+  std::map<std::pair<Peer*, Peer*>, Link> links_;
+  // keyed by due time and arrival order
+  std::multimap<std::pair<int64_t, uint64_t>, Event> events_;
+  uint64_t sequence_ = 0;
+
+  LoopbackImpairment impairment_;
+  LoopbackStats stats_;
+  std::mt19937 random_;
+};
+
+}  // namespace
+
+LoopbackImpairment ParseLoopbackImpairment(const std::string& spec) {
+  LoopbackImpairment impairment;
+  std::stringstream stream(spec);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    size_t equal = item.find('=');
+    if (equal == std::string::npos) {
+      continue;
+    }
+    std::string key = item.substr(0, equal);
+    double value = atof(item.c_str() + equal + 1);
+    if (key == "loss") {
+      impairment.loss_rate = value;
+    } else if (key == "reorder") {
+      impairment.reorder_rate = value;
+    } else if (key == "latency") {
+      impairment.latency_ms = (int)value;
+    } else if (key == "jitter") {
+      impairment.jitter_ms = (int)value;
+    } else if (key == "bandwidth") {
+      impairment.bandwidth_kbps = (int)value;
+    } else if (key == "video_ratio") {
+      impairment.video_size_ratio = value;
+    } else if (key == "queue") {
+      impairment.max_queue_ms = (int)value;
+    }
+  }
+  return impairment;
+}
+
+void SetLoopbackImpairment(const LoopbackImpairment& impairment) {
+  LoopbackHub::Instance().SetImpairment(impairment);
+}
+
+LoopbackImpairment GetLoopbackImpairment() {
+  return LoopbackHub::Instance().GetImpairment();
+}
+
+LoopbackStats GetLoopbackStats() { return LoopbackHub::Instance().GetStats(); }
+
+std::vector<std::string> GetLoopbackHosts() {
+  return LoopbackHub::Instance().GetHosts();
+}
+}  // namespace crossdesk
+
+using crossdesk::LoopbackHub;
+
+PeerPtr* CreatePeer(const Params* params) {
+  if (!params) {
+    return nullptr;
+  }
+
+  Peer* peer = new Peer();
+  peer->params = *params;
+  peer->user_id = params->user_id ? params->user_id : "";
+  size_t at_pos = peer->user_id.find('@');
+  // viewers join as C-<id>, hosts bring id@password or nothing on first run
+  peer->host = peer->user_id.empty() || at_pos != std::string::npos;
+  peer->id = peer->user_id.substr(0, at_pos);
+  if (at_pos != std::string::npos) {
+    peer->password = peer->user_id.substr(at_pos + 1);
+  }
+  peer->params.user_id = nullptr;
+  LoopbackHub::Instance().Register(peer);
+  return peer;
+}
+
+int Init(PeerPtr* peer) {
+  if (!peer) {
+    return -1;
+  }
+  LoopbackHub::Instance().SignalIn(peer);
+  return 0;
+}
+
+int JoinConnection(PeerPtr* peer, const char* transmission_id) {
+  if (!peer || !transmission_id) {
+    return -1;
+  }
+  return LoopbackHub::Instance().Join(peer, transmission_id);
+}
+
+int LeaveConnection(PeerPtr* peer, const char* transmission_id) {
+  if (!peer || !transmission_id) {
+    return -1;
+  }
+  LoopbackHub::Instance().Leave(peer, transmission_id);
+  return 0;
+}
+
+int DestroyPeer(PeerPtr** peer) {
+  if (!peer || !*peer) {
+    return -1;
+  }
+  LoopbackHub::Instance().Unregister(*peer);
+  delete *peer;
+  *peer = nullptr;
+  return 0;
+}
+
+int AddVideoStream(PeerPtr* peer, const char* stream_id) {
+  return peer ? 0 : -1;
+}
+
+int AddAudioStream(PeerPtr* peer, const char* stream_id) {
+  return peer ? 0 : -1;
+}
+
+int AddDataStream(PeerPtr* peer, const char* data_label) {
+  return peer ? 0 : -1;
+}
+
+int SendVideoFrame(PeerPtr* peer, const XVideoFrame* video_frame,
+                   const char* stream_id) {
+  if (!peer || !video_frame || !video_frame->data) {
+    return -1;
+  }
+  LoopbackHub::Instance().Send(
+      peer, crossdesk::kVideoStream, video_frame->data, video_frame->size,
+      video_frame->width, video_frame->height, video_frame->captured_timestamp);
+  return 0;
+}
+
+int SendAudioFrame(PeerPtr* peer, const char* data, size_t size,
+                   const char* stream_id) {
+  if (!peer || !data) {
+    return -1;
+  }
+  LoopbackHub::Instance().Send(peer, crossdesk::kAudioStream, data, size, 0, 0,
+                               0);
+  return 0;
+}
+
+int SendDataFrame(PeerPtr* peer, const char* data, size_t size,
+                  const char* data_label) {
+  if (!peer || !data) {
+    return -1;
+  }
+  LoopbackHub::Instance().Send(peer, crossdesk::kDataStream, data, size, 0, 0,
+                               0);
+  return 0;
+}
+
+int64_t GetSystemTimeMicros(PeerPtr* peer) {
+  // one process, so host and viewer share the clock
+  return crossdesk::NowUs();
+}
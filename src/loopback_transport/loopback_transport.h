@@ -0,0 +1,66 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _LOOPBACK_TRANSPORT_H_
+#define _LOOPBACK_TRANSPORT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// impairment applied from the first CreatePeer on, see ParseLoopbackImpairment
+#define LOOPBACK_IMPAIRMENT_ENV "CROSSDESK_LOOPBACK_IMPAIRMENT"
+
+namespace crossdesk {
+
+// In-process stand-in for minirtc, linked instead of it when building with
+// --loopback_transport=y. It implements the same CreatePeer/Init/
+// JoinConnection/Send*Frame/LeaveConnection/DestroyPeer functions, so Render
+// and Server run unchanged. Every peer in the process joins one hub, hosts
+// get an id and password without a signal server, and frames travel raw to
+// the other side through a simulated link.
+//
+// Only media frames (video, audio) are lost, held back or tail dropped. Data
+// frames stay reliable and ordered like the data channel, they only pay
+// latency, jitter and bandwidth.
+struct LoopbackImpairment {
+  double loss_rate = 0.0;
+  double reorder_rate = 0.0;
+  int latency_ms = 0;
+  int jitter_ms = 0;
+  // 0 means unlimited
+  int bandwidth_kbps = 0;
+  // share of the raw NV12 size charged against the bandwidth, stands in for
+  // the encoder, e.g. 0.02 for a typical desktop stream
+  double video_size_ratio = 1.0;
+  // media queued for longer than this behind the bandwidth cap is dropped
+  int max_queue_ms = 500;
+};
+
+struct LoopbackStats {
+  uint64_t frames_sent = 0;
+  uint64_t frames_delivered = 0;
+  uint64_t frames_lost = 0;
+  uint64_t frames_reordered = 0;
+  uint64_t bytes_delivered = 0;
+};
+
+// "loss=0.02,reorder=0.01,latency=30,jitter=10,bandwidth=4000,
+// video_ratio=0.02,queue=500", unknown keys are ignored
+LoopbackImpairment ParseLoopbackImpairment(const std::string& spec);
+
+// applies to frames sent from now on
+void SetLoopbackImpairment(const LoopbackImpairment& impairment);
+
+LoopbackImpairment GetLoopbackImpairment();
+
+// totals over all links since the process started
+LoopbackStats GetLoopbackStats();
+
+// id@password of every host peer, lets in-process viewers find their host
+std::vector<std::string> GetLoopbackHosts();
+}  // namespace crossdesk
+#endif
@@ -0,0 +1,50 @@
+#include "metrics_server.h"
+
+#include <httplib.h>
+
+#include "metrics.h"
+#include "rd_log.h"
+
+namespace crossdesk {
+
+MetricsServer::MetricsServer() {}
+
+MetricsServer::~MetricsServer() { Stop(); }
+
+int MetricsServer::Start(int port) {
+  if (server_) {
+    return 0;
+  }
+
+  server_ = std::make_unique<httplib::Server>();
+  // scrapes are rare, one worker is plenty and keeps the footprint small
+  server_->new_task_queue = [] { return new httplib::ThreadPool(1); };
+  server_->Get("/metrics",
+               [](const httplib::Request&, httplib::Response& res) {
+                 res.set_content(MetricsRegistry::Instance().Serialize(),
+                                 "text/plain; version=0.0.4; charset=utf-8");
+               });
+
+  if (!server_->bind_to_port("127.0.0.1", port)) {
+    LOG_ERROR("Failed to bind metrics endpoint to 127.0.0.1:{}", port);
+    server_.reset();
+    return -1;
+  }
+
+  thread_ = std::thread([this] { server_->listen_after_bind(); });
+  LOG_INFO("Metrics endpoint listening on http://127.0.0.1:{}/metrics", port);
+  return 0;
+}
+
+void MetricsServer::Stop() {
+  if (!server_) {
+    return;
+  }
+
+  server_->stop();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  server_.reset();
+}
+}  // namespace crossdesk
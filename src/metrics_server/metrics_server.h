@@ -0,0 +1,35 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _METRICS_SERVER_H_
+#define _METRICS_SERVER_H_
+
+#include <memory>
+#include <thread>
+
+namespace httplib {
+class Server;
+}
+
+namespace crossdesk {
+
+// Serves the metrics registry as GET /metrics on 127.0.0.1 only. Exposing it
+// further is left to a reverse proxy or an ssh tunnel.
+class MetricsServer {
+ public:
+  MetricsServer();
+  ~MetricsServer();
+
+ public:
+  int Start(int port);
+  void Stop();
+
+ private:
+  std::unique_ptr<httplib::Server> server_;
+  std::thread thread_;
+};
+}  // namespace crossdesk
+#endif
@@ -0,0 +1,26 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _REMOTE_ACTION_CODEC_H_
+#define _REMOTE_ACTION_CODEC_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "device_controller.h"
+
+namespace crossdesk {
+
+// Binary form of a RemoteAction, only host information carries a payload.
+std::vector<char> SerializeRemoteAction(const RemoteAction& action);
+
+// host information is allocated, release it with FreeRemoteAction
+bool DeserializeRemoteAction(const char* data, size_t size, RemoteAction& out);
+
+// frees what DeserializeRemoteAction or RemoteAction::FromJson allocated
+void FreeRemoteAction(RemoteAction& action);
+}  // namespace crossdesk
+#endif
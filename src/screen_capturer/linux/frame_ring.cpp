@@ -0,0 +1,303 @@
+#include "frame_ring.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#include "rd_log.h"
+
+#define FRAME_RING_MAGIC 0x43444652  // CDFR
+#define FRAME_RING_VERSION 1
+// slot data starts page aligned, which also suits the SIMD paths in libyuv
+#define FRAME_RING_ALIGNMENT 4096
+
+namespace crossdesk {
+
+namespace {
+
+enum SlotState : uint32_t { kFree = 0, kWriting, kReady, kReading };
+
+struct RingDisplay {
+  char name[32];
+  int32_t left;
+  int32_t top;
+  int32_t right;
+  int32_t bottom;
+};
+
+struct RingSlot {
+  std::atomic<uint32_t> state;
+  int32_t width;
+  int32_t height;
+  int32_t size;
+  int32_t display_index;
+};
+
+size_t AlignUp(size_t value) {
+  return (value + FRAME_RING_ALIGNMENT - 1) / FRAME_RING_ALIGNMENT *
+         FRAME_RING_ALIGNMENT;
+}
+
+}  // namespace
+
+struct FrameRing::Header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t slot_size;
+  uint64_t data_offset;
+  uint32_t display_count;
+  RingDisplay displays[FRAME_RING_MAX_DISPLAYS];
+
+  std::atomic<uint32_t> running;
+  std::atomic<uint32_t> show_cursor;
+  std::atomic<int32_t> display_index;
+
+  // newest published slot, -1 once the reader took it
+  std::atomic<int32_t> latest_slot;
+  RingSlot slots[FRAME_RING_SLOTS];
+};
+
+FrameRing::FrameRing() {}
+
+FrameRing::~FrameRing() { Close(); }
+
+int FrameRing::Create(const std::string& name,
+                      const std::vector<DisplayInfo>& displays) {
+  Close();
+
+  size_t slot_size = 0;
+  for (const auto& display : displays) {
+    size_t frame_size = (size_t)display.width * display.height * 3 / 2;
+    if (frame_size > slot_size) {
+      slot_size = frame_size;
+    }
+  }
+  slot_size = AlignUp(slot_size);
+  size_t data_offset = AlignUp(sizeof(Header));
+  size_t mapped_size = data_offset + slot_size * FRAME_RING_SLOTS;
+
+  name_ = "/" + name;
+  // a previous helper may have left it behind when it died
+  shm_unlink(name_.c_str());
+  int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    LOG_ERROR("Failed to create frame ring [{}], errno {}", name_, errno);
+    return -1;
+  }
+  if (ftruncate(fd, mapped_size) != 0) {
+    LOG_ERROR("Failed to size frame ring [{}] to {} bytes", name_,
+              mapped_size);
+    close(fd);
+    shm_unlink(name_.c_str());
+    return -1;
+  }
+  void* mapped =
+      mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    shm_unlink(name_.c_str());
+    return -1;
+  }
+
+  // only the header is touched here, slot pages are faulted in on first use
+  // value initialized, which zeroes the atomics along with everything else
+  header_ = new (mapped) Header();
+  header_->version = FRAME_RING_VERSION;
+  header_->slot_size = slot_size;
+  header_->data_offset = data_offset;
+  header_->display_count = displays.size() < FRAME_RING_MAX_DISPLAYS
+                               ? (uint32_t)displays.size()
+                               : FRAME_RING_MAX_DISPLAYS;
+  for (uint32_t i = 0; i < header_->display_count; i++) {
+    RingDisplay& display = header_->displays[i];
+    strncpy(display.name, displays[i].name.c_str(), sizeof(display.name) - 1);
+    display.left = displays[i].left;
+    display.top = displays[i].top;
+    display.right = displays[i].right;
+    display.bottom = displays[i].bottom;
+  }
+  header_->latest_slot = -1;
+  mapped_size_ = mapped_size;
+  owner_ = true;
+  write_slot_ = -1;
+  next_write_slot_ = 0;
+
+  // published last, Open treats the ring as ready once it sees the magic
+  std::atomic_thread_fence(std::memory_order_release);
+  header_->magic = FRAME_RING_MAGIC;
+  return 0;
+}
+
+int FrameRing::Open(const std::string& name) {
+  Close();
+
+  name_ = "/" + name;
+  int fd = shm_open(name_.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+    close(fd);
+    return -1;
+  }
+  void* mapped =
+      mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return -1;
+  }
+
+  header_ = (Header*)mapped;
+  mapped_size_ = st.st_size;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (header_->magic != FRAME_RING_MAGIC ||
+      header_->version != FRAME_RING_VERSION ||
+      header_->data_offset + header_->slot_size * FRAME_RING_SLOTS >
+          mapped_size_) {
+    Close();
+    return -1;
+  }
+  read_slot_ = -1;
+  return 0;
+}
+
+void FrameRing::Close() {
+  if (!header_) {
+    return;
+  }
+
+  munmap(header_, mapped_size_);
+  if (owner_) {
+    shm_unlink(name_.c_str());
+  }
+  header_ = nullptr;
+  mapped_size_ = 0;
+  owner_ = false;
+}
+
+std::vector<DisplayInfo> FrameRing::GetDisplayInfoList() const {
+  std::vector<DisplayInfo> displays;
+  if (!header_) {
+    return displays;
+  }
+
+  for (uint32_t i = 0;
+       i < header_->display_count && i < FRAME_RING_MAX_DISPLAYS; i++) {
+    const RingDisplay& display = header_->displays[i];
+    char name[sizeof(display.name)];
+    memcpy(name, display.name, sizeof(name));
+    name[sizeof(name) - 1] = '\0';
+    displays.push_back(DisplayInfo(nullptr, name, i == 0, display.left,
+                                   display.top, display.right,
+                                   display.bottom));
+  }
+  return displays;
+}
+
+void FrameRing::SetRunning(bool running, bool show_cursor) {
+  if (!header_) {
+    return;
+  }
+  header_->show_cursor = show_cursor ? 1 : 0;
+  header_->running = running ? 1 : 0;
+}
+
+void FrameRing::SetDisplayIndex(int display_index) {
+  if (header_) {
+    header_->display_index = display_index;
+  }
+}
+
+bool FrameRing::IsRunning() const { return header_ && header_->running; }
+
+bool FrameRing::ShowCursor() const { return header_ && header_->show_cursor; }
+
+int FrameRing::DisplayIndex() const {
+  return header_ ? header_->display_index.load() : 0;
+}
+
+unsigned char* FrameRing::AcquireWriteSlot(int size) {
+  if (!header_ || size <= 0 || (uint64_t)size > header_->slot_size) {
+    return nullptr;
+  }
+
+  for (int i = 0; i < FRAME_RING_SLOTS; i++) {
+    int slot = (next_write_slot_ + i) % FRAME_RING_SLOTS;
+    std::atomic<uint32_t>& state = header_->slots[slot].state;
+    uint32_t expected = kFree;
+    if (!state.compare_exchange_strong(expected, kWriting,
+                                       std::memory_order_acquire)) {
+      // an unread frame is stale by now, only the reader's slot is off limits
+      expected = kReady;
+      if (!state.compare_exchange_strong(expected, kWriting,
+                                         std::memory_order_acquire)) {
+        continue;
+      }
+    }
+
+    write_slot_ = slot;
+    next_write_slot_ = (slot + 1) % FRAME_RING_SLOTS;
+    header_->slots[slot].size = size;
+    return (unsigned char*)header_ + header_->data_offset +
+           header_->slot_size * slot;
+  }
+  return nullptr;
+}
+
+void FrameRing::Publish(int width, int height, int display_index) {
+  if (!header_ || write_slot_ < 0) {
+    return;
+  }
+
+  RingSlot& slot = header_->slots[write_slot_];
+  slot.width = width;
+  slot.height = height;
+  slot.display_index = display_index;
+  slot.state.store(kReady, std::memory_order_release);
+  header_->latest_slot.store(write_slot_, std::memory_order_release);
+  write_slot_ = -1;
+}
+
+bool FrameRing::AcquireReadSlot(Frame* frame) {
+  if (!header_ || read_slot_ >= 0) {
+    return false;
+  }
+
+  int slot = header_->latest_slot.exchange(-1, std::memory_order_acquire);
+  if (slot < 0 || slot >= FRAME_RING_SLOTS) {
+    return false;
+  }
+  std::atomic<uint32_t>& state = header_->slots[slot].state;
+  uint32_t expected = kReady;
+  // the writer may have reclaimed it meanwhile, a newer frame is on its way
+  if (!state.compare_exchange_strong(expected, kReading,
+                                     std::memory_order_acquire)) {
+    return false;
+  }
+
+  read_slot_ = slot;
+  const RingSlot& ring_slot = header_->slots[slot];
+  frame->data = (unsigned char*)header_ + header_->data_offset +
+                header_->slot_size * slot;
+  frame->size = ring_slot.size;
+  frame->width = ring_slot.width;
+  frame->height = ring_slot.height;
+  frame->display_index = ring_slot.display_index;
+  return true;
+}
+
+void FrameRing::ReleaseReadSlot() {
+  if (!header_ || read_slot_ < 0) {
+    return;
+  }
+  header_->slots[read_slot_].state.store(kFree, std::memory_order_release);
+  read_slot_ = -1;
+}
+}  // namespace crossdesk
@@ -0,0 +1,77 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _FRAME_RING_H_
+#define _FRAME_RING_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "display_info.h"
+
+#define FRAME_RING_SLOTS 3
+#define FRAME_RING_MAX_DISPLAYS 8
+
+namespace crossdesk {
+
+// NV12 frames shared between the capture helper process and the capturer in
+// the main process. One writer and one reader, newest frame wins: the writer
+// never waits, it overwrites a published frame nobody picked up yet and only
+// skips the slot the reader currently holds. Signalling is left to the
+// caller, the ring only tracks slot ownership.
+class FrameRing {
+ public:
+  struct Frame {
+    unsigned char* data = nullptr;
+    int size = 0;
+    int width = 0;
+    int height = 0;
+    int display_index = 0;
+  };
+
+ public:
+  FrameRing();
+  ~FrameRing();
+
+  // helper side, slots are sized for the largest display
+  int Create(const std::string& name, const std::vector<DisplayInfo>& displays);
+  // capturer side, fails until the helper finished Create
+  int Open(const std::string& name);
+  void Close();
+  bool IsOpen() const { return header_ != nullptr; }
+
+  std::vector<DisplayInfo> GetDisplayInfoList() const;
+
+  // control, written by the capturer and polled by the helper
+  void SetRunning(bool running, bool show_cursor);
+  void SetDisplayIndex(int display_index);
+  bool IsRunning() const;
+  bool ShowCursor() const;
+  int DisplayIndex() const;
+
+  // helper side, nullptr when the frame does not fit or every slot is busy
+  unsigned char* AcquireWriteSlot(int size);
+  void Publish(int width, int height, int display_index);
+
+  // capturer side, hands out the newest unread frame until ReleaseReadSlot
+  bool AcquireReadSlot(Frame* frame);
+  void ReleaseReadSlot();
+
+ private:
+  struct Header;
+
+ private:
+  Header* header_ = nullptr;
+  size_t mapped_size_ = 0;
+  bool owner_ = false;
+  std::string name_;
+  int write_slot_ = -1;
+  int next_write_slot_ = 0;
+  int read_slot_ = -1;
+};
+}  // namespace crossdesk
+#endif
@@ -0,0 +1,120 @@
+#include "screen_capture_helper.h"
+
+#include <sys/prctl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "frame_ring.h"
+#include "path_manager.h"
+#include "rd_log.h"
+#include "screen_capturer_x11.h"
+
+#define CONTROL_POLL_INTERVAL_MS 20
+
+namespace crossdesk {
+
+static void Notify(int event_fd) {
+  uint64_t value = 1;
+  // a failed write only means the reader is far behind, nothing to do
+  ssize_t ret = write(event_fd, &value, sizeof(value));
+  (void)ret;
+}
+
+int RunScreenCaptureHelper(int argc, char* argv[]) {
+  if (argc < 5) {
+    LOG_ERROR("Capture helper started without ring, eventfd and fps");
+    return 1;
+  }
+  std::string ring_name = argv[2];
+  int event_fd = atoi(argv[3]);
+  int fps = atoi(argv[4]);
+
+  // never outlive the capturer that started us
+  pid_t parent = getppid();
+  prctl(PR_SET_PDEATHSIG, SIGKILL);
+  if (getppid() != parent) {
+    return 1;
+  }
+
+  FrameRing ring;
+  std::vector<DisplayInfo> display_info_list;
+  ScreenCapturerX11 capturer;
+  int init_ret = capturer.Init(
+      fps, [&ring, &display_info_list, event_fd](
+               unsigned char* data, int size, int width, int height,
+               const char* display_name) {
+        int display_index = 0;
+        for (size_t i = 0; i < display_info_list.size(); i++) {
+          if (display_info_list[i].name == display_name) {
+            display_index = (int)i;
+            break;
+          }
+        }
+        ring.Publish(width, height, display_index);
+        Notify(event_fd);
+      });
+  if (0 != init_ret) {
+    LOG_ERROR("Capture helper failed to init X11 capturer");
+    return 1;
+  }
+
+  display_info_list = capturer.GetDisplayInfoList();
+  if (0 != ring.Create(ring_name, display_info_list)) {
+    capturer.Destroy();
+    return 1;
+  }
+  capturer.SetFrameBufferProvider(
+      [&ring](int size) { return ring.AcquireWriteSlot(size); });
+  LOG_INFO("Capture helper ready with {} display(s)", display_info_list.size());
+  // the first signal tells the capturer the ring exists
+  Notify(event_fd);
+
+  bool running = false;
+  bool show_cursor = false;
+  int display_index = 0;
+  while (getppid() == parent) {
+    int wanted_display_index = ring.DisplayIndex();
+    if (wanted_display_index != display_index) {
+      display_index = wanted_display_index;
+      capturer.SwitchTo(display_index);
+    }
+
+    bool wanted_running = ring.IsRunning();
+    bool wanted_show_cursor = ring.ShowCursor();
+    if (running && (!wanted_running || wanted_show_cursor != show_cursor)) {
+      capturer.Stop();
+      running = false;
+    }
+    if (!running && wanted_running) {
+      capturer.Start(wanted_show_cursor);
+      running = true;
+      show_cursor = wanted_show_cursor;
+    }
+
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(CONTROL_POLL_INTERVAL_MS));
+  }
+
+  capturer.Destroy();
+  ring.Close();
+  return 0;
+}
+
+bool MaybeRunScreenCaptureHelper(int argc, char* argv[], int* exit_code) {
+  if (argc < 2 || strcmp(argv[1], SCREEN_CAPTURE_HELPER_ARG) != 0) {
+    return false;
+  }
+
+  PathManager path_manager("CrossDesk");
+  InitLogger(path_manager.GetLogPath().string());
+  *exit_code = RunScreenCaptureHelper(argc, argv);
+  ShutdownLogger();
+  return true;
+}
+}  // namespace crossdesk
@@ -0,0 +1,25 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _SCREEN_CAPTURE_HELPER_H_
+#define _SCREEN_CAPTURE_HELPER_H_
+
+// argv[1] of the helper process, followed by ring name, eventfd and fps
+#define SCREEN_CAPTURE_HELPER_ARG "--capture-helper"
+
+namespace crossdesk {
+
+// Body of the helper process ScreenCapturerIsolated starts. Captures with
+// ScreenCapturerX11 straight into the frame ring and returns once the
+// parent is gone.
+int RunScreenCaptureHelper(int argc, char* argv[]);
+
+// isolated screen capture runs in a copy of the executable that started it,
+// every main calls this first. Returns true if this process is the helper,
+// exit_code is set once it finished then
+bool MaybeRunScreenCaptureHelper(int argc, char* argv[], int* exit_code);
+}  // namespace crossdesk
+#endif
@@ -0,0 +1,268 @@
+#include "screen_capturer_isolated.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "rd_log.h"
+#include "screen_capture_helper.h"
+
+#define HELPER_READY_TIMEOUT_MS 5000
+#define HELPER_RESPAWN_INTERVAL_MS 1000
+// X11 delivers on a fixed cadence, this much silence means the helper hangs
+#define HELPER_STALL_TIMEOUT_MS 5000
+#define RECEIVE_POLL_INTERVAL_MS 100
+
+namespace crossdesk {
+
+static int64_t ElapsedMs(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - since)
+      .count();
+}
+
+static void DrainEvents(int event_fd) {
+  uint64_t count = 0;
+  while (read(event_fd, &count, sizeof(count)) > 0) {
+  }
+}
+
+ScreenCapturerIsolated::ScreenCapturerIsolated() {}
+
+ScreenCapturerIsolated::~ScreenCapturerIsolated() { Destroy(); }
+
+int ScreenCapturerIsolated::Init(const int fps, cb_desktop_data cb) {
+  fps_ = fps;
+  callback_ = cb;
+  ring_name_ = "crossdesk-capture-" + std::to_string(getpid());
+  event_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (event_fd_ < 0) {
+    LOG_ERROR("Failed to create eventfd for the capture helper");
+    return -1;
+  }
+
+  if (0 != SpawnHelper()) {
+    close(event_fd_);
+    event_fd_ = -1;
+    return -1;
+  }
+
+  thread_running_ = true;
+  thread_ = std::thread([this]() { ReceiveLoop(); });
+  return 0;
+}
+
+int ScreenCapturerIsolated::Destroy() {
+  thread_running_ = false;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  StopHelper();
+  if (event_fd_ >= 0) {
+    close(event_fd_);
+    event_fd_ = -1;
+  }
+  return 0;
+}
+
+int ScreenCapturerIsolated::Start(bool show_cursor) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  running_ = true;
+  show_cursor_ = show_cursor;
+  last_frame_time_ = std::chrono::steady_clock::now();
+  ApplyControl();
+  return 0;
+}
+
+int ScreenCapturerIsolated::Stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  running_ = false;
+  ApplyControl();
+  return 0;
+}
+
+int ScreenCapturerIsolated::Pause(int monitor_index) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  paused_ = true;
+  ApplyControl();
+  return 0;
+}
+
+int ScreenCapturerIsolated::Resume(int monitor_index) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  paused_ = false;
+  last_frame_time_ = std::chrono::steady_clock::now();
+  ApplyControl();
+  return 0;
+}
+
+int ScreenCapturerIsolated::SwitchTo(int monitor_index) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  display_index_ = monitor_index;
+  ApplyControl();
+  return 0;
+}
+
+std::vector<DisplayInfo> ScreenCapturerIsolated::GetDisplayInfoList() {
+  // replaced on every respawn of the helper
+  std::lock_guard<std::mutex> lock(mutex_);
+  return display_info_list_;
+}
+
+void ScreenCapturerIsolated::ApplyControl() {
+  ring_.SetDisplayIndex(display_index_);
+  ring_.SetRunning(running_ && !paused_, show_cursor_);
+}
+
+int ScreenCapturerIsolated::SpawnHelper() {
+  last_spawn_time_ = std::chrono::steady_clock::now();
+
+  char exe_path[PATH_MAX];
+  ssize_t count = readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
+  if (count <= 0) {
+    LOG_ERROR("Failed to locate the executable for the capture helper");
+    return -1;
+  }
+  exe_path[count] = '\0';
+  // everything exec needs is prepared before fork, the child of a
+  // multithreaded process may only make async signal safe calls
+  std::string event_fd = std::to_string(event_fd_);
+  std::string fps = std::to_string(fps_);
+
+  DrainEvents(event_fd_);
+  pid_t pid = fork();
+  if (pid < 0) {
+    LOG_ERROR("Failed to fork the capture helper");
+    return -1;
+  }
+  if (pid == 0) {
+    // the helper inherits the eventfd and nothing else
+    fcntl(event_fd_, F_SETFD, 0);
+    execl(exe_path, exe_path, SCREEN_CAPTURE_HELPER_ARG, ring_name_.c_str(),
+          event_fd.c_str(), fps.c_str(), nullptr);
+    _exit(127);
+  }
+
+  // the helper signals once its ring exists. Waiting happens without the
+  // lock, only installing the ring takes it
+  while (ElapsedMs(last_spawn_time_) < HELPER_READY_TIMEOUT_MS) {
+    struct pollfd pfd = {event_fd_, POLLIN, 0};
+    if (poll(&pfd, 1, RECEIVE_POLL_INTERVAL_MS) > 0) {
+      DrainEvents(event_fd_);
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (0 == ring_.Open(ring_name_)) {
+        // both sides have it mapped, unlinking now leaves nothing behind in
+        // /dev/shm whichever process dies first
+        shm_unlink(("/" + ring_name_).c_str());
+        helper_pid_ = pid;
+        // a respawn after a monitor change brings a new layout
+        display_info_list_ = ring_.GetDisplayInfoList();
+        if (display_index_ >= (int)display_info_list_.size()) {
+          display_index_ = 0;
+        }
+        ApplyControl();
+        last_frame_time_ = std::chrono::steady_clock::now();
+        LOG_INFO("Capture helper [{}] ready in {} ms", helper_pid_,
+                 ElapsedMs(last_spawn_time_));
+        return 0;
+      }
+    }
+    if (ReapHelper(pid, false)) {
+      return -1;
+    }
+  }
+
+  LOG_ERROR("Capture helper [{}] not ready after {} ms", pid,
+            HELPER_READY_TIMEOUT_MS);
+  ReapHelper(pid, true);
+  return -1;
+}
+
+void ScreenCapturerIsolated::StopHelper() {
+  ring_.Close();
+  if (helper_pid_ > 0) {
+    ReapHelper(helper_pid_, true);
+    helper_pid_ = -1;
+  }
+}
+
+bool ScreenCapturerIsolated::HelperExited() {
+  if (helper_pid_ <= 0) {
+    return true;
+  }
+  if (!ReapHelper(helper_pid_, false)) {
+    return false;
+  }
+  helper_pid_ = -1;
+  ring_.Close();
+  return true;
+}
+
+bool ScreenCapturerIsolated::ReapHelper(pid_t pid, bool kill_first) {
+  if (kill_first) {
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    return true;
+  }
+
+  int status = 0;
+  if (waitpid(pid, &status, WNOHANG) != pid) {
+    return false;
+  }
+  if (WIFSIGNALED(status)) {
+    LOG_ERROR("Capture helper [{}] crashed with signal {}", pid,
+              WTERMSIG(status));
+  } else {
+    LOG_ERROR("Capture helper [{}] exited with code {}", pid,
+              WEXITSTATUS(status));
+  }
+  return true;
+}
+
+void ScreenCapturerIsolated::ReceiveLoop() {
+  while (thread_running_) {
+    struct pollfd pfd = {event_fd_, POLLIN, 0};
+    if (poll(&pfd, 1, RECEIVE_POLL_INTERVAL_MS) > 0) {
+      DrainEvents(event_fd_);
+    }
+
+    bool helper_gone = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      helper_gone = HelperExited();
+    }
+    if (helper_gone) {
+      // peers keep their streams, they only see a gap until it is back
+      if (ElapsedMs(last_spawn_time_) >= HELPER_RESPAWN_INTERVAL_MS) {
+        SpawnHelper();
+      }
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    FrameRing::Frame frame;
+    if (ring_.AcquireReadSlot(&frame)) {
+      // the callback reads the shared slot directly, no copy on the way
+      if (running_ && !paused_ && callback_ && frame.display_index >= 0 &&
+          frame.display_index < (int)display_info_list_.size()) {
+        callback_(frame.data, frame.size, frame.width, frame.height,
+                  display_info_list_[frame.display_index].name.c_str());
+      }
+      ring_.ReleaseReadSlot();
+      last_frame_time_ = std::chrono::steady_clock::now();
+    } else if (running_ && !paused_ &&
+               ElapsedMs(last_frame_time_) >= HELPER_STALL_TIMEOUT_MS) {
+      LOG_ERROR("Capture helper [{}] sent nothing for {} ms, restarting it",
+                helper_pid_, ElapsedMs(last_frame_time_));
+      StopHelper();
+    }
+  }
+}
+}  // namespace crossdesk
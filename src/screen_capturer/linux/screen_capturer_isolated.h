@@ -0,0 +1,81 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _SCREEN_CAPTURER_ISOLATED_H_
+#define _SCREEN_CAPTURER_ISOLATED_H_
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_ring.h"
+#include "screen_capturer.h"
+
+namespace crossdesk {
+
+// Runs ScreenCapturerX11 in a helper process, see screen_capture_helper.h.
+// Frames arrive through a shared memory FrameRing and are handed to the
+// callback in place, so a crash in X11 or libyuv only costs a few frames:
+// the helper is restarted while peer connections stay up.
+class ScreenCapturerIsolated : public ScreenCapturer {
+ public:
+  ScreenCapturerIsolated();
+  ~ScreenCapturerIsolated();
+
+ public:
+  int Init(const int fps, cb_desktop_data cb) override;
+  int Destroy() override;
+  int Start(bool show_cursor) override;
+  int Stop() override;
+
+  int Pause(int monitor_index) override;
+  int Resume(int monitor_index) override;
+
+  int SwitchTo(int monitor_index) override;
+
+  std::vector<DisplayInfo> GetDisplayInfoList() override;
+
+ private:
+  // takes the lock only to install the ring, call it without
+  int SpawnHelper();
+  void StopHelper();
+  bool HelperExited();
+  // returns true once pid is gone, with kill_first it is killed and waited
+  static bool ReapHelper(pid_t pid, bool kill_first);
+  void ApplyControl();
+  void ReceiveLoop();
+
+ private:
+  int fps_ = 60;
+  cb_desktop_data callback_;
+  std::vector<DisplayInfo> display_info_list_;
+  std::string ring_name_;
+  int event_fd_ = -1;
+
+  // guards the ring, the helper and the control state, the callback runs
+  // under it so Stop returns only once no frame is being delivered
+  std::mutex mutex_;
+  FrameRing ring_;
+  pid_t helper_pid_ = -1;
+  std::chrono::steady_clock::time_point last_frame_time_;
+  bool running_ = false;
+  bool paused_ = false;
+  bool show_cursor_ = false;
+  int display_index_ = 0;
+
+  // only used by SpawnHelper, on the receive thread once Init returned
+  std::chrono::steady_clock::time_point last_spawn_time_;
+
+  std::thread thread_;
+  std::atomic<bool> thread_running_{false};
+};
+}  // namespace crossdesk
+#endif
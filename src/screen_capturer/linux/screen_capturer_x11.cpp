@@ -10,10 +10,14 @@
 
 #include "libyuv.h"
 #include "rd_log.h"
+#include "trace.h"
 
 namespace crossdesk {
 
-ScreenCapturerX11::ScreenCapturerX11() {}
+ScreenCapturerX11::ScreenCapturerX11()
+    : grab_seconds_(MetricsRegistry::Instance().GetHistogram(
+          "crossdesk_capture_grab_seconds", "Time spent grabbing one frame",
+          {0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1})) {}
 
 ScreenCapturerX11::~ScreenCapturerX11() { Destroy(); }
 
@@ -79,8 +83,7 @@ int ScreenCapturerX11::Init(const int fps, cb_desktop_data cb) {
   fps_ = fps;
   callback_ = cb;
 
-  y_plane_.resize(width_ * height_);
-  uv_plane_.resize((width_ / 2) * (height_ / 2) * 2);
+  nv12_.resize(width_ * height_ * 3 / 2);
 
   return 0;
 }
@@ -88,8 +91,7 @@ int ScreenCapturerX11::Init(const int fps, cb_desktop_data cb) {
 int ScreenCapturerX11::Destroy() {
   Stop();
 
-  y_plane_.clear();
-  uv_plane_.clear();
+  nv12_.clear();
 
   if (screen_res_) {
     XRRFreeScreenResources(screen_res_);
@@ -109,6 +111,7 @@ int ScreenCapturerX11::Start(bool show_cursor) {
   running_ = true;
   paused_ = false;
   thread_ = std::thread([this]() {
+    Tracer::Instance().SetThreadName("x11_capture");
     while (running_) {
       if (!paused_) OnFrame();
     }
@@ -138,18 +141,24 @@ int ScreenCapturerX11::SwitchTo(int monitor_index) {
   return 0;
 }
 
+void ScreenCapturerX11::SetFrameBufferProvider(
+    frame_buffer_provider provider) {
+  frame_buffer_provider_ = provider;
+}
+
 std::vector<DisplayInfo> ScreenCapturerX11::GetDisplayInfoList() {
   return display_info_list_;
 }
 
 void ScreenCapturerX11::OnFrame() {
   if (!display_) {
-    LOG_ERROR("Display is not initialized");
+    LOG_ERROR_THROTTLED(1000, "Display is not initialized");
     return;
   }
 
   if (monitor_index_ < 0 || monitor_index_ >= display_info_list_.size()) {
-    LOG_ERROR("Invalid monitor index: {}", monitor_index_.load());
+    LOG_ERROR_THROTTLED(1000, "Invalid monitor index: {}",
+                        monitor_index_.load());
     return;
   }
 
@@ -158,12 +167,22 @@ void ScreenCapturerX11::OnFrame() {
   width_ = display_info_list_[monitor_index_].width;
   height_ = display_info_list_[monitor_index_].height;
 
-  XImage* image = XGetImage(display_, root_, left_, top_, width_, height_,
-                            AllPlanes, ZPixmap);
+  TRACE_SCOPE("capture_frame");
+  XImage* image = nullptr;
+  {
+    TRACE_SCOPE("x11_grab");
+    auto grab_start = std::chrono::steady_clock::now();
+    image = XGetImage(display_, root_, left_, top_, width_, height_, AllPlanes,
+                      ZPixmap);
+    grab_seconds_->Observe(std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - grab_start)
+                               .count());
+  }
   if (!image) return;
 
   // if enable show cursor, draw cursor
   if (show_cursor_) {
+    TRACE_SCOPE("x11_cursor");
     Window root_return, child_return;
     int root_x, root_y, win_x, win_y;
     unsigned int mask;
@@ -176,31 +195,45 @@ void ScreenCapturerX11::OnFrame() {
     }
   }
 
-  bool needs_copy = image->bytes_per_line != width_ * 4;
-  std::vector<uint8_t> argb_buf;
-  uint8_t* src_argb = nullptr;
-
-  if (needs_copy) {
-    argb_buf.resize(width_ * height_ * 4);
-    for (int y = 0; y < height_; ++y) {
-      memcpy(&argb_buf[y * width_ * 4], image->data + y * image->bytes_per_line,
-             width_ * 4);
-    }
-    src_argb = argb_buf.data();
+  // converted in place, the callback gets the very buffer libyuv wrote
+  int frame_size = width_ * height_ * 3 / 2;
+  uint8_t* nv12 = nullptr;
+  if (frame_buffer_provider_) {
+    nv12 = frame_buffer_provider_(frame_size);
   } else {
-    src_argb = reinterpret_cast<uint8_t*>(image->data);
+    if ((int)nv12_.size() < frame_size) {
+      nv12_.resize(frame_size);
+    }
+    nv12 = nv12_.data();
+  }
+  if (!nv12) {
+    XDestroyImage(image);
+    return;
   }
 
-  libyuv::ARGBToNV12(src_argb, width_ * 4, y_plane_.data(), width_,
-                     uv_plane_.data(), width_, width_, height_);
+  {
+    TRACE_SCOPE("x11_convert");
+    bool needs_copy = image->bytes_per_line != width_ * 4;
+    std::vector<uint8_t> argb_buf;
+    uint8_t* src_argb = nullptr;
+
+    if (needs_copy) {
+      argb_buf.resize(width_ * height_ * 4);
+      for (int y = 0; y < height_; ++y) {
+        memcpy(&argb_buf[y * width_ * 4],
+               image->data + y * image->bytes_per_line, width_ * 4);
+      }
+      src_argb = argb_buf.data();
+    } else {
+      src_argb = reinterpret_cast<uint8_t*>(image->data);
+    }
 
-  std::vector<uint8_t> nv12;
-  nv12.reserve(y_plane_.size() + uv_plane_.size());
-  nv12.insert(nv12.end(), y_plane_.begin(), y_plane_.end());
-  nv12.insert(nv12.end(), uv_plane_.begin(), uv_plane_.end());
+    libyuv::ARGBToNV12(src_argb, width_ * 4, nv12, width_,
+                       nv12 + width_ * height_, width_, width_, height_);
+  }
 
   if (callback_) {
-    callback_(nv12.data(), width_ * height_ * 3 / 2, width_, height_,
+    callback_(nv12, frame_size, width_, height_,
               display_info_list_[monitor_index_].name.c_str());
   }
 
@@ -223,24 +256,35 @@ void ScreenCapturerX11::DrawCursor(XImage* image, int x, int y) {
     return;
   }
 
-  int cursor_width = cursor_image->width;
-  int cursor_height = cursor_image->height;
+  // ZPixmap of a TrueColor root is 32 bit ARGB in memory, the layout OnFrame
+  // hands to ARGBToNV12 as well, so no XGetPixel/XPutPixel per pixel
+  BlendCursor(reinterpret_cast<uint8_t*>(image->data), image->bytes_per_line,
+              image->width, image->height, cursor_image->pixels,
+              cursor_image->width, cursor_image->height,
+              x - cursor_image->xhot, y - cursor_image->yhot);
 
-  int draw_x = x - cursor_image->xhot;
-  int draw_y = y - cursor_image->yhot;
+  XFree(cursor_image);
+}
 
-  // draw cursor on image
+void ScreenCapturerX11::BlendCursor(uint8_t* argb, int stride, int width,
+                                    int height,
+                                    const unsigned long* cursor_pixels,
+                                    int cursor_width, int cursor_height,
+                                    int draw_x, int draw_y) {
   for (int cy = 0; cy < cursor_height; ++cy) {
+    int img_y = draw_y + cy;
+    if (img_y < 0 || img_y >= height) {
+      continue;
+    }
+    uint32_t* row = reinterpret_cast<uint32_t*>(argb + img_y * stride);
+
     for (int cx = 0; cx < cursor_width; ++cx) {
       int img_x = draw_x + cx;
-      int img_y = draw_y + cy;
-
-      if (img_x < 0 || img_x >= image->width || img_y < 0 ||
-          img_y >= image->height) {
+      if (img_x < 0 || img_x >= width) {
         continue;
       }
 
-      unsigned long cursor_pixel = cursor_image->pixels[cy * cursor_width + cx];
+      unsigned long cursor_pixel = cursor_pixels[cy * cursor_width + cx];
       unsigned char a = (cursor_pixel >> 24) & 0xFF;
 
       // if alpha is 0, skip
@@ -248,7 +292,7 @@ void ScreenCapturerX11::DrawCursor(XImage* image, int x, int y) {
         continue;
       }
 
-      unsigned long img_pixel = XGetPixel(image, img_x, img_y);
+      uint32_t img_pixel = row[img_x];
 
       unsigned char img_r = (img_pixel >> 16) & 0xFF;
       unsigned char img_g = (img_pixel >> 8) & 0xFF;
@@ -277,11 +321,8 @@ void ScreenCapturerX11::DrawCursor(XImage* image, int x, int y) {
       }
 
       // set pixel
-      unsigned long new_pixel = (final_r << 16) | (final_g << 8) | final_b;
-      XPutPixel(image, img_x, img_y, new_pixel);
+      row[img_x] = (final_r << 16) | (final_g << 8) | final_b;
     }
   }
-
-  XFree(cursor_image);
 }
 }  // namespace crossdesk
\ No newline at end of file
@@ -17,17 +17,24 @@ struct _XImage;
 typedef struct _XImage XImage;
 
 #include <atomic>
+#include <cstdint>
 #include <cstring>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <thread>
 #include <vector>
 
+#include "metrics.h"
 #include "screen_capturer.h"
 
 namespace crossdesk {
 
 class ScreenCapturerX11 : public ScreenCapturer {
+ public:
+  // returns where the next NV12 frame of size bytes goes, nullptr drops it
+  typedef std::function<unsigned char*(int size)> frame_buffer_provider;
+
  public:
   ScreenCapturerX11();
   ~ScreenCapturerX11();
@@ -46,6 +53,15 @@ class ScreenCapturerX11 : public ScreenCapturer {
   std::vector<DisplayInfo> GetDisplayInfoList() override;
 
   void OnFrame();
+  // lets the capture helper convert straight into shared memory, call
+  // before Start
+  void SetFrameBufferProvider(frame_buffer_provider provider);
+
+  // alpha blends an XFixes cursor image into a 32 bit ARGB frame, draw_x and
+  // draw_y are where the cursor's top left corner lands
+  static void BlendCursor(uint8_t* argb, int stride, int width, int height,
+                          const unsigned long* cursor_pixels, int cursor_width,
+                          int cursor_height, int draw_x, int draw_y);
 
  private:
   void DrawCursor(XImage* image, int x, int y);
@@ -67,8 +83,10 @@ class ScreenCapturerX11 : public ScreenCapturer {
   cb_desktop_data callback_;
   std::vector<DisplayInfo> display_info_list_;
 
-  std::vector<uint8_t> y_plane_;
-  std::vector<uint8_t> uv_plane_;
+  frame_buffer_provider frame_buffer_provider_;
+  std::vector<uint8_t> nv12_;
+
+  std::shared_ptr<Histogram> grab_seconds_;
 };
 }  // namespace crossdesk
 #endif
\ No newline at end of file
@@ -431,7 +431,8 @@ void ScreenCapturerSckImpl::OnNewCVPixelBuffer(CVPixelBufferRef pixelBuffer,
 
   CVReturn status = CVPixelBufferLockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
   if (status != kCVReturnSuccess) {
-    LOG_ERROR("Failed to lock CVPixelBuffer base address: %d", status);
+    LOG_ERROR_THROTTLED(1000, "Failed to lock CVPixelBuffer base address: {}",
+                        status);
     return;
   }
 
@@ -529,7 +530,7 @@ void ScreenCapturerSckImpl::StartOrReconfigureCapturer() {
 
   CFArrayRef attachmentsArray = CMSampleBufferGetSampleAttachmentsArray(sampleBuffer, false);
   if (!attachmentsArray || CFArrayGetCount(attachmentsArray) == 0) {
-    LOG_ERROR("Discarding frame with no attachments");
+    LOG_ERROR_EVERY_N(100, "Discarding frame with no attachments");
     CFRelease(pixelBuffer);
     return;
   }
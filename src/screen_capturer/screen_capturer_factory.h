@@ -10,6 +10,10 @@
 #ifdef _WIN32
 #include "screen_capturer_wgc.h"
 #elif __linux__
+#include <cstdlib>
+#include <cstring>
+
+#include "screen_capturer_isolated.h"
 #include "screen_capturer_x11.h"
 #elif __APPLE__
 // #include "screen_capturer_avf.h"
@@ -27,6 +31,11 @@ class ScreenCapturerFactory {
 #ifdef _WIN32
     return new ScreenCapturerWgc();
 #elif __linux__
+    // capture in a helper process, a crash there only costs a few frames
+    const char* isolated = getenv("CROSSDESK_ISOLATED_CAPTURE");
+    if (isolated && strcmp(isolated, "1") == 0) {
+      return new ScreenCapturerIsolated();
+    }
     return new ScreenCapturerX11();
 #elif __APPLE__
     // return new ScreenCapturerAvf();
@@ -267,13 +267,14 @@ void ScreenCapturerWgc::OnFrame(const WgcSession::wgc_session_frame& frame,
 
   if (on_data_) {
     if (id < 0 || id >= static_cast<int>(display_info_list_.size())) {
-      LOG_ERROR("WGC OnFrame invalid display index: {}", id);
+      LOG_ERROR_THROTTLED(1000, "WGC OnFrame invalid display index: {}", id);
       return;
     }
 
     if (!frame.data || frame.row_pitch == 0) {
-      LOG_ERROR("WGC OnFrame received invalid frame: data={}, row_pitch={}",
-                (void*)frame.data, frame.row_pitch);
+      LOG_ERROR_THROTTLED(
+          1000, "WGC OnFrame received invalid frame: data={}, row_pitch={}",
+          (void*)frame.data, frame.row_pitch);
       return;
     }
 
@@ -289,7 +290,8 @@ void ScreenCapturerWgc::OnFrame(const WgcSession::wgc_session_frame& frame,
     int even_height = static_cast<int>(frame.height) & ~1;
 
     if (even_width <= 0 || even_height <= 0) {
-      LOG_ERROR(
+      LOG_ERROR_THROTTLED(
+          1000,
           "WGC OnFrame invalid frame size after adjust: width={} "
           "(frame.width={}, max_by_pitch={}), height={}",
           logical_width, frame.width, max_width_by_pitch, frame.height);
@@ -0,0 +1,97 @@
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "rd_log.h"
+#include "server.h"
+#ifdef __linux__
+#include "screen_capture_helper.h"
+#endif
+
+static crossdesk::Server* g_server = nullptr;
+
+static void OnSignal(int signal) {
+  // only flips an atomic, the loop notices it and does the teardown
+  if (g_server) {
+    g_server->Stop();
+  }
+}
+
+static void PrintUsage(const char* program) {
+  std::cout
+      << "Usage: " << program << " [options]\n"
+      << "Serve this host's screen, speaker and input without any window.\n"
+      << "Values not given here are read from config.ini.\n\n"
+      << "  --server <host>        self-hosted signal server\n"
+      << "  --port <port>          signal server port\n"
+      << "  --coturn-port <port>   coturn server port\n"
+      << "  --cert <path>          certificate of the self-hosted server\n"
+      << "  --password <password>  fixed connection password\n"
+      << "  --fps <30|60>          capture frame rate\n"
+      << "  --metrics-port <port>  Prometheus endpoint, 0 disables it\n"
+      << "  --show-cursor          draw the cursor into captured frames\n"
+      << "  --help                 show this message\n";
+}
+
+int main(int argc, char* argv[]) {
+#ifdef __linux__
+  int helper_exit_code = 0;
+  if (crossdesk::MaybeRunScreenCaptureHelper(argc, argv, &helper_exit_code)) {
+    return helper_exit_code;
+  }
+#endif
+
+  crossdesk::Server::Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--help" || arg == "-h") {
+      PrintUsage(argv[0]);
+      return 0;
+    } else if (arg == "--show-cursor") {
+      options.show_cursor = true;
+    } else if (arg == "--server" && has_value) {
+      options.signal_server_host = argv[++i];
+    } else if (arg == "--port" && has_value) {
+      options.signal_server_port = atoi(argv[++i]);
+    } else if (arg == "--coturn-port" && has_value) {
+      options.coturn_server_port = atoi(argv[++i]);
+    } else if (arg == "--cert" && has_value) {
+      options.cert_file_path = argv[++i];
+    } else if (arg == "--password" && has_value) {
+      options.password = argv[++i];
+    } else if (arg == "--fps" && has_value) {
+      options.fps = atoi(argv[++i]);
+    } else if (arg == "--metrics-port" && has_value) {
+      options.metrics_port = atoi(argv[++i]);
+    } else {
+      std::cerr << "Unknown or incomplete option: " << arg << "\n";
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  // minirtc keeps the password in a 17 byte id@password buffer
+  if (options.password.size() > 6) {
+    std::cerr << "Password must not be longer than 6 characters\n";
+    return 1;
+  }
+
+  int ret = 0;
+  {
+    crossdesk::Server server(options);
+    g_server = &server;
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    ret = server.Run();
+
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    g_server = nullptr;
+  }
+  crossdesk::ShutdownLogger();
+  return ret == 0 ? 0 : 1;
+}
@@ -0,0 +1,534 @@
+#include "server.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "rd_log.h"
+#include "remote_action_codec.h"
+
+namespace crossdesk {
+
+static bool IsClosedStatus(ConnectionStatus status) {
+  return status == ConnectionStatus::Closed ||
+         status == ConnectionStatus::Failed ||
+         status == ConnectionStatus::Disconnected;
+}
+
+Server::Server(const Options& options)
+    : options_(options), host_session_(audio_label_, data_label_) {}
+
+Server::~Server() {}
+
+int Server::Run() {
+  if (0 != Initialize()) {
+    Cleanup();
+    return -1;
+  }
+
+  while (!stop_) {
+    // a failed creation is retried, but not in a tight loop
+    if (!peer_ && std::chrono::steady_clock::now() - last_peer_creation_time_ >=
+                      std::chrono::seconds(1)) {
+      CreateConnectionPeer();
+    }
+
+    UpdateInteractions();
+
+    // sleeps until a callback has news, the timeout only drives retries
+    std::unique_lock<std::mutex> lock(mutex_);
+    wakeup_cv_.wait_for(lock, std::chrono::milliseconds(500),
+                        [this]() { return wakeup_ || stop_; });
+    wakeup_ = false;
+  }
+
+  Cleanup();
+  return 0;
+}
+
+void Server::Stop() {
+  // no lock here so signal handlers may call it, the loop polls stop_
+  stop_ = true;
+}
+
+void Server::Wakeup() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wakeup_ = true;
+  }
+  wakeup_cv_.notify_one();
+}
+
+int Server::Initialize() {
+  path_manager_ = std::make_unique<PathManager>("CrossDesk");
+  std::string cert_path =
+      (path_manager_->GetCertPath() / "crossdesk.cn_root.crt").string();
+  cache_path_ = path_manager_->GetCachePath().string();
+  log_path_ = path_manager_->GetLogPath().string();
+  config_center_ =
+      std::make_unique<ConfigCenter>(cache_path_ + "/config.ini", cert_path);
+
+  InitLogger(log_path_);
+  LOG_INFO("CrossDesk server version: {}", CROSSDESK_VERSION);
+
+  int fps = 30;
+  if (options_.fps > 0) {
+    fps = options_.fps >= 60 ? 60 : 30;
+  } else {
+    fps = config_center_->GetVideoFrameRate() ==
+                  ConfigCenter::VIDEO_FRAME_RATE::FPS_30
+              ? 30
+              : 60;
+  }
+  host_session_.SetFps(fps);
+
+  int metrics_port = options_.metrics_port >= 0
+                         ? options_.metrics_port
+                         : config_center_->GetMetricsPort();
+  if (metrics_port > 0) {
+    metrics_server_.Start(metrics_port);
+  }
+
+  LoadClientId();
+
+  // the capturer is kept for the whole run, viewers only start and stop it
+  screen_capturer_ = (ScreenCapturer*)screen_capturer_factory_.Create();
+  LOG_INFO("Init screen capturer with {} fps", fps);
+  int screen_capturer_init_ret = screen_capturer_->Init(
+      fps, [this](unsigned char* data, int size, int width, int height,
+                  const char* display_name) -> void {
+        host_session_.OnScreenFrame(data, size, width, height, display_name);
+      });
+  if (0 != screen_capturer_init_ret) {
+    LOG_ERROR("Init screen capturer failed");
+    screen_capturer_->Destroy();
+    delete screen_capturer_;
+    screen_capturer_ = nullptr;
+    return -1;
+  }
+  display_info_list_ = screen_capturer_->GetDisplayInfoList();
+  for (size_t i = 0; i < display_info_list_.size(); i++) {
+    LOG_INFO("Local display [{}:{}]", i + 1, display_info_list_[i].name);
+  }
+  host_session_.SetDisplayInfoList(display_info_list_);
+  host_session_.SetScreenCapturer(screen_capturer_);
+
+  keyboard_capturer_ = (KeyboardCapturer*)device_controller_factory_.Create(
+      DeviceControllerFactory::Device::Keyboard);
+  host_session_.SetKeyboardCapturer(keyboard_capturer_);
+
+  return 0;
+}
+
+void Server::Cleanup() {
+  DestroyConnectionPeer();
+
+  host_session_.SetScreenCapturer(nullptr);
+  host_session_.SetKeyboardCapturer(nullptr);
+  if (screen_capturer_) {
+    screen_capturer_->Destroy();
+    delete screen_capturer_;
+    screen_capturer_ = nullptr;
+  }
+
+  if (speaker_capturer_) {
+    speaker_capturer_->Destroy();
+    delete speaker_capturer_;
+    speaker_capturer_ = nullptr;
+  }
+
+  StopMouseController();
+
+  if (keyboard_capturer_) {
+    delete keyboard_capturer_;
+    keyboard_capturer_ = nullptr;
+  }
+
+  metrics_server_.Stop();
+}
+
+int Server::LoadClientId() {
+  std::ifstream file(cache_path_ + "/server_id");
+  std::string client_id_with_password;
+  if (!file || !std::getline(file, client_id_with_password)) {
+    return -1;
+  }
+
+  std::string id = client_id_with_password.substr(
+      0, client_id_with_password.find('@'));
+  if (!options_.password.empty() && !id.empty()) {
+    client_id_with_password = id + "@" + options_.password;
+  }
+
+  strncpy(client_id_, id.c_str(), sizeof(client_id_) - 1);
+  client_id_[sizeof(client_id_) - 1] = '\0';
+  strncpy(client_id_with_password_, client_id_with_password.c_str(),
+          sizeof(client_id_with_password_) - 1);
+  client_id_with_password_[sizeof(client_id_with_password_) - 1] = '\0';
+  return 0;
+}
+
+int Server::SaveClientId() {
+  std::ofstream file(cache_path_ + "/server_id", std::ios::trunc);
+  if (!file) {
+    LOG_ERROR("Failed to save client id into [{}]", cache_path_);
+    return -1;
+  }
+  file << client_id_with_password_ << "\n";
+  return 0;
+}
+
+int Server::CreateConnectionPeer() {
+  last_peer_creation_time_ = std::chrono::steady_clock::now();
+  params_.use_cfg_file = false;
+
+  std::string signal_server_ip;
+  int signal_server_port;
+  int coturn_server_port;
+  std::string tls_cert_path;
+
+  if (!options_.signal_server_host.empty() || config_center_->IsSelfHosted()) {
+    signal_server_ip = !options_.signal_server_host.empty()
+                           ? options_.signal_server_host
+                           : config_center_->GetSignalServerHost();
+    signal_server_port = options_.signal_server_port > 0
+                             ? options_.signal_server_port
+                             : config_center_->GetSignalServerPort();
+    coturn_server_port = options_.coturn_server_port > 0
+                             ? options_.coturn_server_port
+                             : config_center_->GetCoturnServerPort();
+    tls_cert_path = !options_.cert_file_path.empty()
+                        ? options_.cert_file_path
+                        : config_center_->GetCertFilePath();
+  } else {
+    signal_server_ip = config_center_->GetDefaultServerHost();
+    signal_server_port = config_center_->GetDefaultSignalServerPort();
+    coturn_server_port = config_center_->GetDefaultCoturnServerPort();
+    tls_cert_path = config_center_->GetDefaultCertFilePath();
+  }
+
+  strncpy((char*)params_.signal_server_ip, signal_server_ip.c_str(),
+          sizeof(params_.signal_server_ip) - 1);
+  params_.signal_server_ip[sizeof(params_.signal_server_ip) - 1] = '\0';
+  params_.signal_server_port = signal_server_port;
+  strncpy((char*)params_.stun_server_ip, signal_server_ip.c_str(),
+          sizeof(params_.stun_server_ip) - 1);
+  params_.stun_server_ip[sizeof(params_.stun_server_ip) - 1] = '\0';
+  params_.stun_server_port = coturn_server_port;
+  strncpy((char*)params_.turn_server_ip, signal_server_ip.c_str(),
+          sizeof(params_.turn_server_ip) - 1);
+  params_.turn_server_ip[sizeof(params_.turn_server_ip) - 1] = '\0';
+  params_.turn_server_port = coturn_server_port;
+  strncpy((char*)params_.turn_server_username, "crossdesk",
+          sizeof(params_.turn_server_username) - 1);
+  params_.turn_server_username[sizeof(params_.turn_server_username) - 1] = '\0';
+  strncpy((char*)params_.turn_server_password, "crossdeskpw",
+          sizeof(params_.turn_server_password) - 1);
+  params_.turn_server_password[sizeof(params_.turn_server_password) - 1] = '\0';
+  strncpy(params_.tls_cert_path, tls_cert_path.c_str(),
+          sizeof(params_.tls_cert_path) - 1);
+  params_.tls_cert_path[sizeof(params_.tls_cert_path) - 1] = '\0';
+
+  strncpy(params_.log_path, log_path_.c_str(), sizeof(params_.log_path) - 1);
+  params_.log_path[sizeof(params_.log_path) - 1] = '\0';
+  params_.hardware_acceleration = config_center_->IsHardwareVideoCodec();
+  params_.av1_encoding = config_center_->GetVideoEncodeFormat() ==
+                         ConfigCenter::VIDEO_ENCODE_FORMAT::AV1;
+  params_.enable_turn = config_center_->IsEnableTurn();
+  params_.enable_srtp = config_center_->IsEnableSrtp();
+  params_.video_quality =
+      static_cast<VideoQuality>(config_center_->GetVideoQuality());
+  // a host never receives media, only input and control messages
+  params_.on_receive_video_buffer = nullptr;
+  params_.on_receive_audio_buffer = nullptr;
+  params_.on_receive_data_buffer = OnReceiveDataBufferCb;
+  params_.on_receive_video_frame = nullptr;
+  params_.on_signal_status = OnSignalStatusCb;
+  params_.on_connection_status = OnConnectionStatusCb;
+  params_.net_status_report = NetStatusReport;
+
+  params_.user_id = client_id_with_password_;
+  params_.user_data = this;
+
+  peer_ = CreatePeer(&params_);
+  if (!peer_) {
+    LOG_ERROR("Create peer instance failed, signal server [{}:{}]",
+              signal_server_ip, signal_server_port);
+    return -1;
+  }
+  Init(peer_);
+  host_session_.SetPeer(peer_);
+  LOG_INFO("Peer init finish, signal server [{}:{}]", signal_server_ip,
+           signal_server_port);
+
+  for (auto& display_info : display_info_list_) {
+    AddVideoStream(peer_, display_info.name.c_str());
+  }
+  AddAudioStream(peer_, audio_label_.c_str());
+  AddDataStream(peer_, data_label_.c_str());
+
+  return 0;
+}
+
+void Server::DestroyConnectionPeer() {
+  if (!peer_) {
+    return;
+  }
+
+  LOG_INFO("[{}] Leave connection", client_id_);
+  LeaveConnection(peer_, client_id_);
+  host_session_.SetPeer(nullptr);
+  DestroyPeer(&peer_);
+
+  host_session_.Reset();
+  StopScreenCapturer();
+  StopSpeakerCapturer();
+  StopMouseController();
+}
+
+void Server::UpdateInteractions() {
+  bool recreate_peer = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    recreate_peer = recreate_peer_;
+    recreate_peer_ = false;
+  }
+
+  if (recreate_peer) {
+    // the next loop iteration joins again with the new credentials
+    DestroyConnectionPeer();
+    last_peer_creation_time_ = {};
+    return;
+  }
+
+  bool any_connected = host_session_.AnyViewerConnected();
+  if (any_connected && !screen_capturer_started_ && screen_capturer_) {
+    bool show_cursor = options_.show_cursor || host_session_.AllViewersWeb();
+    LOG_INFO("Start screen capturer, show cursor: {}", show_cursor);
+    screen_capturer_->Start(show_cursor);
+    screen_capturer_started_ = true;
+  } else if (!any_connected && screen_capturer_started_) {
+    StopScreenCapturer();
+  }
+
+  if (any_connected && !mouse_controller_) {
+    StartMouseController();
+  } else if (!any_connected && mouse_controller_) {
+    StopMouseController();
+  }
+
+  bool audio_format_changed = host_session_.TakeAudioFormatChanged();
+  if (audio_format_changed && speaker_capturer_) {
+    // the capturer only takes its format in Init
+    speaker_capturer_->Stop();
+    speaker_capturer_->Destroy();
+    delete speaker_capturer_;
+    speaker_capturer_ = nullptr;
+    if (speaker_capturer_started_) {
+      speaker_capturer_started_ = false;
+      StartSpeakerCapturer();
+    }
+  }
+  if (audio_format_changed) {
+    host_session_.SendAudioFormat();
+  }
+
+  bool audio_wanted = host_session_.AudioWanted();
+  if (audio_wanted && !speaker_capturer_started_) {
+    StartSpeakerCapturer();
+  } else if (!audio_wanted && speaker_capturer_started_) {
+    StopSpeakerCapturer();
+  }
+
+  host_session_.SendPendingHostInfo();
+}
+
+void Server::StopScreenCapturer() {
+  if (screen_capturer_ && screen_capturer_started_) {
+    LOG_INFO("Stop screen capturer");
+    screen_capturer_->Stop();
+  }
+  screen_capturer_started_ = false;
+}
+
+int Server::StartSpeakerCapturer() {
+  if (!speaker_capturer_) {
+    int channels = 1;
+    int frame_duration_ms = 10;
+    host_session_.GetAudioFormat(&channels, &frame_duration_ms);
+
+    speaker_capturer_ = (SpeakerCapturer*)speaker_capturer_factory_.Create();
+    LOG_INFO("Init speaker capturer with {} channel(s), {} ms frames",
+             channels, frame_duration_ms);
+    speaker_capturer_channels_ = channels;
+    int speaker_capturer_init_ret = speaker_capturer_->Init(
+        [this](unsigned char* data, size_t size, const char* audio_name)
+            -> void { host_session_.OnSpeakerFrame(data, size); },
+        channels, frame_duration_ms);
+    if (0 != speaker_capturer_init_ret) {
+      speaker_capturer_->Destroy();
+      delete speaker_capturer_;
+      speaker_capturer_ = nullptr;
+      return -1;
+    }
+  }
+
+  host_session_.ResetAudio(speaker_capturer_channels_);
+  speaker_capturer_->Start();
+  speaker_capturer_started_ = true;
+  return 0;
+}
+
+void Server::StopSpeakerCapturer() {
+  if (speaker_capturer_ && speaker_capturer_started_) {
+    speaker_capturer_->Stop();
+  }
+  speaker_capturer_started_ = false;
+}
+
+int Server::StartMouseController() {
+  mouse_controller_ = (MouseController*)device_controller_factory_.Create(
+      DeviceControllerFactory::Device::Mouse);
+  if (0 != mouse_controller_->Init(display_info_list_)) {
+    LOG_ERROR("Init mouse controller failed");
+    mouse_controller_->Destroy();
+    delete mouse_controller_;
+    mouse_controller_ = nullptr;
+    return -1;
+  }
+  host_session_.SetMouseController(mouse_controller_);
+  return 0;
+}
+
+void Server::StopMouseController() {
+  if (mouse_controller_) {
+    host_session_.SetMouseController(nullptr);
+    mouse_controller_->Destroy();
+    delete mouse_controller_;
+    mouse_controller_ = nullptr;
+  }
+}
+
+void Server::OnReceiveDataBufferCb(const char* data, size_t size,
+                                   const char* user_id, size_t user_id_size,
+                                   void* user_data) {
+  Server* server = (Server*)user_data;
+  if (!server) {
+    return;
+  }
+
+  std::string json_str(data, size);
+  RemoteAction remote_action;
+  try {
+    remote_action.from_json(json_str);
+  } catch (const std::exception& e) {
+    LOG_ERROR("Failed to parse RemoteAction JSON: {}", e.what());
+    return;
+  }
+
+  std::string remote_id(user_id, user_id_size);
+  server->host_session_.OnDataMessage(remote_id, remote_action);
+  if (remote_action.type == ControlType::audio_capture ||
+      remote_action.type == ControlType::audio_format) {
+    server->Wakeup();
+  }
+  // nothing a viewer sends is kept, host information included
+  FreeRemoteAction(remote_action);
+}
+
+void Server::OnSignalStatusCb(SignalStatus status, const char* user_id,
+                              size_t user_id_size, void* user_data) {
+  Server* server = (Server*)user_data;
+  if (!server) {
+    return;
+  }
+
+  std::string client_id(user_id, user_id_size);
+  if (client_id != server->client_id_) {
+    return;
+  }
+
+  if (SignalStatus::SignalConnected == status) {
+    LOG_INFO("[{}] connected to signal server", client_id);
+  } else if (SignalStatus::SignalFailed == status) {
+    LOG_ERROR("[{}] failed to connect to signal server", client_id);
+  } else if (SignalStatus::SignalReconnecting == status) {
+    LOG_WARN("[{}] reconnecting to signal server", client_id);
+  } else if (SignalStatus::SignalServerClosed == status) {
+    LOG_WARN("[{}] signal server closed", client_id);
+  }
+}
+
+void Server::OnConnectionStatusCb(ConnectionStatus status, const char* user_id,
+                                  const size_t user_id_size, void* user_data) {
+  Server* server = (Server*)user_data;
+  if (!server) {
+    return;
+  }
+
+  std::string remote_id(user_id, user_id_size);
+  server->host_session_.OnConnectionStatus(remote_id, status);
+
+  if (status == ConnectionStatus::Connected) {
+    LOG_INFO("[{}] viewer connected", remote_id);
+  } else if (IsClosedStatus(status)) {
+    LOG_INFO("[{}] viewer left", remote_id);
+    MetricsRegistry::Instance().RemoveSeries(MetricLabel("session", remote_id));
+  }
+  server->Wakeup();
+}
+
+void Server::NetStatusReport(const char* client_id, size_t client_id_size,
+                             TraversalMode mode,
+                             const XNetTrafficStats* net_traffic_stats,
+                             const char* user_id, const size_t user_id_size,
+                             void* user_data) {
+  Server* server = (Server*)user_data;
+  if (!server) {
+    return;
+  }
+
+  std::string remote_id(user_id, user_id_size);
+  if (net_traffic_stats && !remote_id.empty()) {
+    HostSession::UpdateTrafficMetrics(remote_id, *net_traffic_stats);
+  }
+
+  // the signal server hands out id@password the first time we join
+  if (strchr(client_id, '@') == nullptr || strchr(user_id, '-') != nullptr) {
+    return;
+  }
+
+  const char* at_pos = strchr(client_id, '@');
+  std::string id(client_id, at_pos - client_id);
+  std::string password = at_pos + 1;
+
+  strncpy(server->client_id_, id.c_str(), sizeof(server->client_id_) - 1);
+  server->client_id_[sizeof(server->client_id_) - 1] = '\0';
+
+  if (!server->options_.password.empty() &&
+      password != server->options_.password) {
+    // rejoin with our own password, as resetting it from the GUI does
+    std::string client_id_with_password = id + "@" + server->options_.password;
+    strncpy(server->client_id_with_password_, client_id_with_password.c_str(),
+            sizeof(server->client_id_with_password_) - 1);
+    {
+      std::lock_guard<std::mutex> lock(server->mutex_);
+      server->recreate_peer_ = true;
+    }
+    server->Wakeup();
+  } else {
+    strncpy(server->client_id_with_password_, client_id,
+            sizeof(server->client_id_with_password_) - 1);
+    if (server->options_.password.empty()) {
+      // headless, stdout is the only place an operator can read it from
+      std::cout << "CrossDesk id: " << id << ", password: " << password
+                << std::endl;
+    }
+  }
+  server->client_id_with_password_[sizeof(server->client_id_with_password_) -
+                                   1] = '\0';
+
+  LOG_INFO("Use client id [{}] and save id into cache file", id);
+  server->SaveClientId();
+}
+}  // namespace crossdesk
@@ -0,0 +1,133 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "config_center.h"
+#include "device_controller_factory.h"
+#include "display_info.h"
+#include "host_session.h"
+#include "metrics_server.h"
+#include "minirtc.h"
+#include "path_manager.h"
+#include "screen_capturer_factory.h"
+#include "speaker_capturer_factory.h"
+
+namespace crossdesk {
+
+// Host side of a CrossDesk session without any window: it only serves its
+// screen, speaker and input to viewers. Everything the GUI would show is
+// logged instead. Settings come from config.ini, Options override them.
+class Server {
+ public:
+  struct Options {
+    // empty or 0 keeps the value from config.ini
+    std::string signal_server_host;
+    int signal_server_port = 0;
+    int coturn_server_port = 0;
+    std::string cert_file_path;
+    // fixed password instead of the one handed out by the signal server
+    std::string password;
+    int fps = 0;
+    // -1 keeps config.ini, 0 disables the endpoint
+    int metrics_port = -1;
+    bool show_cursor = false;
+  };
+
+ public:
+  explicit Server(const Options& options);
+  ~Server();
+
+ public:
+  // blocks until Stop is called
+  int Run();
+  // safe to call from any thread and from signal handlers
+  void Stop();
+
+ private:
+  int Initialize();
+  void Cleanup();
+  int LoadClientId();
+  int SaveClientId();
+  int CreateConnectionPeer();
+  void DestroyConnectionPeer();
+  void Wakeup();
+
+  // applies the session state collected by the callbacks, loop thread only
+  void UpdateInteractions();
+
+  void StopScreenCapturer();
+  int StartSpeakerCapturer();
+  void StopSpeakerCapturer();
+  int StartMouseController();
+  void StopMouseController();
+
+  static void OnReceiveDataBufferCb(const char* data, size_t size,
+                                    const char* user_id, size_t user_id_size,
+                                    void* user_data);
+
+  static void OnSignalStatusCb(SignalStatus status, const char* user_id,
+                               size_t user_id_size, void* user_data);
+
+  static void OnConnectionStatusCb(ConnectionStatus status, const char* user_id,
+                                   size_t user_id_size, void* user_data);
+
+  static void NetStatusReport(const char* client_id, size_t client_id_size,
+                              TraversalMode mode,
+                              const XNetTrafficStats* net_traffic_stats,
+                              const char* user_id, const size_t user_id_size,
+                              void* user_data);
+
+ private:
+  Options options_;
+  std::unique_ptr<PathManager> path_manager_;
+  std::unique_ptr<ConfigCenter> config_center_;
+  std::string cache_path_;
+  std::string log_path_;
+
+  Params params_;
+  PeerPtr* peer_ = nullptr;
+  std::chrono::steady_clock::time_point last_peer_creation_time_;
+  const std::string audio_label_ = "audio";
+  const std::string data_label_ = "data";
+  // handed to minirtc as is, so fixed buffers rather than strings
+  char client_id_[10] = "";
+  char client_id_with_password_[17] = "";
+  HostSession host_session_;
+
+  ScreenCapturerFactory screen_capturer_factory_;
+  SpeakerCapturerFactory speaker_capturer_factory_;
+  DeviceControllerFactory device_controller_factory_;
+  ScreenCapturer* screen_capturer_ = nullptr;
+  SpeakerCapturer* speaker_capturer_ = nullptr;
+  MouseController* mouse_controller_ = nullptr;
+  // only injects keys, the server never hooks the local keyboard
+  KeyboardCapturer* keyboard_capturer_ = nullptr;
+  std::vector<DisplayInfo> display_info_list_;
+  bool screen_capturer_started_ = false;
+  bool speaker_capturer_started_ = false;
+  int speaker_capturer_channels_ = 1;
+
+  // written by the minirtc callbacks, applied by the loop
+  std::mutex mutex_;
+  std::condition_variable wakeup_cv_;
+  bool wakeup_ = false;
+  std::atomic<bool> stop_{false};
+  bool recreate_peer_ = false;
+
+  MetricsServer metrics_server_;
+};
+}  // namespace crossdesk
+#endif
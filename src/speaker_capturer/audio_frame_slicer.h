@@ -0,0 +1,79 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _AUDIO_FRAME_SLICER_H_
+#define _AUDIO_FRAME_SLICER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace crossdesk {
+
+// Cuts an arbitrary sized byte stream into fixed size frames without
+// allocating after construction. Whole frames are handed out straight from
+// the caller's buffer, only a frame that straddles two Push() calls is
+// assembled in the internal staging buffer.
+class AudioFrameSlicer {
+ public:
+  explicit AudioFrameSlicer(size_t frame_size_bytes)
+      : frame_size_(frame_size_bytes), staging_(frame_size_bytes) {}
+
+ public:
+  // on_frame is called as on_frame(const uint8_t* frame, size_t size)
+  template <typename OnFrame>
+  void Push(const uint8_t* data, size_t len, OnFrame&& on_frame) {
+    if (frame_size_ == 0) {
+      return;
+    }
+
+    if (staged_ > 0) {
+      size_t fill = frame_size_ - staged_;
+      if (len < fill) {
+        memcpy(staging_.data() + staged_, data, len);
+        staged_ += len;
+        return;
+      }
+
+      memcpy(staging_.data() + staged_, data, fill);
+      on_frame(staging_.data(), frame_size_);
+      staged_ = 0;
+      data += fill;
+      len -= fill;
+    }
+
+    while (len >= frame_size_) {
+      on_frame(data, frame_size_);
+      data += frame_size_;
+      len -= frame_size_;
+    }
+
+    if (len > 0) {
+      memcpy(staging_.data(), data, len);
+      staged_ = len;
+    }
+  }
+
+  void Reset() { staged_ = 0; }
+
+  // not safe while Push() may run on another thread
+  void SetFrameSize(size_t frame_size_bytes) {
+    frame_size_ = frame_size_bytes;
+    staging_.resize(frame_size_bytes);
+    staged_ = 0;
+  }
+
+  size_t FrameSize() const { return frame_size_; }
+  size_t Staged() const { return staged_; }
+
+ private:
+  size_t frame_size_ = 0;
+  std::vector<uint8_t> staging_;
+  size_t staged_ = 0;
+};
+}  // namespace crossdesk
+#endif
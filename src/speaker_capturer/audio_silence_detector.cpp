@@ -0,0 +1,145 @@
+#include "audio_silence_detector.h"
+
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_SILENCE_DETECTOR_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AUDIO_SILENCE_DETECTOR_NEON 1
+#endif
+
+namespace crossdesk {
+
+AudioSilenceDetector::AudioSilenceDetector(int sample_rate, int hangover_ms,
+                                           int comfort_interval_ms,
+                                           int rms_threshold_dbfs,
+                                           int peak_threshold_dbfs)
+    : sample_rate_(sample_rate > 0 ? sample_rate : 48000),
+      hangover_ms_(hangover_ms),
+      comfort_interval_ms_(comfort_interval_ms) {
+  rms_threshold_ = 32768.0 * std::pow(10.0, rms_threshold_dbfs / 20.0);
+  peak_threshold_ =
+      (int)(32768.0 * std::pow(10.0, peak_threshold_dbfs / 20.0));
+}
+
+AudioSilenceDetector::~AudioSilenceDetector() {}
+
+void AudioSilenceDetector::Analyze(const int16_t* samples, size_t count,
+                                   int* peak, uint64_t* sum_squares_4) {
+  size_t i = 0;
+  int max_abs = 0;
+  uint64_t sum = 0;
+
+  // samples are shifted right by 2 before squaring so that a pair of squares
+  // always fits into a positive int32 lane
+#if defined(AUDIO_SILENCE_DETECTOR_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  __m128i peak_v = zero;
+  __m128i sum_v = zero;
+  for (; i + 8 <= count; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(samples + i));
+    // saturating negate keeps -32768 at 32767
+    __m128i abs_v = _mm_max_epi16(v, _mm_subs_epi16(zero, v));
+    peak_v = _mm_max_epi16(peak_v, abs_v);
+
+    __m128i shifted = _mm_srai_epi16(v, 2);
+    __m128i squares = _mm_madd_epi16(shifted, shifted);
+    sum_v = _mm_add_epi64(sum_v, _mm_unpacklo_epi32(squares, zero));
+    sum_v = _mm_add_epi64(sum_v, _mm_unpackhi_epi32(squares, zero));
+  }
+
+  alignas(16) int16_t peak_lanes[8];
+  alignas(16) uint64_t sum_lanes[2];
+  _mm_store_si128((__m128i*)peak_lanes, peak_v);
+  _mm_store_si128((__m128i*)sum_lanes, sum_v);
+  for (int lane = 0; lane < 8; ++lane) {
+    max_abs = peak_lanes[lane] > max_abs ? peak_lanes[lane] : max_abs;
+  }
+  sum = sum_lanes[0] + sum_lanes[1];
+#elif defined(AUDIO_SILENCE_DETECTOR_NEON)
+  int16x8_t peak_v = vdupq_n_s16(0);
+  int64x2_t sum_v = vdupq_n_s64(0);
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t v = vld1q_s16(samples + i);
+    peak_v = vmaxq_s16(peak_v, vqabsq_s16(v));
+
+    int16x8_t shifted = vshrq_n_s16(v, 2);
+    int32x4_t low =
+        vmull_s16(vget_low_s16(shifted), vget_low_s16(shifted));
+    int32x4_t high =
+        vmull_s16(vget_high_s16(shifted), vget_high_s16(shifted));
+    sum_v = vpadalq_s32(sum_v, low);
+    sum_v = vpadalq_s32(sum_v, high);
+  }
+
+  int16_t peak_lanes[8];
+  vst1q_s16(peak_lanes, peak_v);
+  for (int lane = 0; lane < 8; ++lane) {
+    max_abs = peak_lanes[lane] > max_abs ? peak_lanes[lane] : max_abs;
+  }
+  sum = (uint64_t)(vgetq_lane_s64(sum_v, 0) + vgetq_lane_s64(sum_v, 1));
+#endif
+
+  for (; i < count; ++i) {
+    int value = samples[i];
+    int abs_value = value < 0 ? -value : value;
+    abs_value = abs_value > 32767 ? 32767 : abs_value;
+    max_abs = abs_value > max_abs ? abs_value : max_abs;
+
+    int shifted = value >> 2;
+    sum += (uint64_t)(shifted * shifted);
+  }
+
+  *peak = max_abs;
+  *sum_squares_4 = sum;
+}
+
+AudioSilenceDetector::Action AudioSilenceDetector::Process(
+    const int16_t* samples, size_t count) {
+  if (!samples || count == 0) {
+    return Action::kSend;
+  }
+
+  int peak = 0;
+  uint64_t sum_squares_4 = 0;
+  Analyze(samples, count, &peak, &sum_squares_4);
+  double rms = 4.0 * std::sqrt((double)sum_squares_4 / count);
+
+  if (rms >= rms_threshold_ || peak >= peak_threshold_) {
+    silent_samples_ = 0;
+    in_dtx_ = false;
+    return Action::kSend;
+  }
+
+  silent_samples_ += count / channels_;
+  if (!in_dtx_) {
+    // keep sending through the hangover so word endings are not clipped
+    if (silent_samples_ * 1000 < (uint64_t)hangover_ms_ * sample_rate_) {
+      return Action::kSend;
+    }
+
+    in_dtx_ = true;
+    since_comfort_samples_ = 0;
+    return Action::kComfort;
+  }
+
+  since_comfort_samples_ += count / channels_;
+  if (since_comfort_samples_ * 1000 >=
+      (uint64_t)comfort_interval_ms_ * sample_rate_) {
+    since_comfort_samples_ = 0;
+    return Action::kComfort;
+  }
+
+  return Action::kSuppress;
+}
+
+void AudioSilenceDetector::Reset() {
+  silent_samples_ = 0;
+  since_comfort_samples_ = 0;
+  in_dtx_ = false;
+}
+}  // namespace crossdesk
@@ -0,0 +1,57 @@
+/*
+ * @Author: DI JUNKUN
+ * @Date: 2026-10-19
+ * Copyright (c) 2026 by DI JUNKUN, All Rights Reserved.
+ */
+
+#ifndef _AUDIO_SILENCE_DETECTOR_H_
+#define _AUDIO_SILENCE_DETECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace crossdesk {
+
+// Discontinuous transmission for captured S16 audio. A frame is silent when
+// both its rms and its peak are below the thresholds. Once silence lasted
+// longer than the hangover, frames are suppressed and only a comfort marker
+// is requested every comfort_interval_ms so the receiver knows the gap is
+// intended rather than loss.
+class AudioSilenceDetector {
+ public:
+  enum class Action { kSend, kSuppress, kComfort };
+
+ public:
+  AudioSilenceDetector(int sample_rate = 48000, int hangover_ms = 300,
+                       int comfort_interval_ms = 1000,
+                       int rms_threshold_dbfs = -60,
+                       int peak_threshold_dbfs = -40);
+  ~AudioSilenceDetector();
+
+ public:
+  Action Process(const int16_t* samples, size_t count);
+  void Reset();
+
+  bool InDtx() const { return in_dtx_; }
+  // Process() counts interleaved samples, timing needs frames
+  void SetChannels(int channels) { channels_ = channels > 0 ? channels : 1; }
+
+  // peak absolute sample and sum of squares of samples / 4, vectorized
+  static void Analyze(const int16_t* samples, size_t count, int* peak,
+                      uint64_t* sum_squares_4);
+
+ private:
+  const int sample_rate_;
+  const int hangover_ms_;
+  const int comfort_interval_ms_;
+  int channels_ = 1;
+  double rms_threshold_ = 0;
+  int peak_threshold_ = 0;
+
+  // both in per channel samples, so frame size does not matter
+  uint64_t silent_samples_ = 0;
+  uint64_t since_comfort_samples_ = 0;
+  bool in_dtx_ = false;
+};
+}  // namespace crossdesk
+#endif
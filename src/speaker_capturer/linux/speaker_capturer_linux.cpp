@@ -2,10 +2,10 @@
 
 #include <pulse/error.h>
 #include <pulse/introspect.h>
+#include <pulse/rtclock.h>
 
-#include <condition_variable>
-#include <iostream>
-#include <thread>
+#include <algorithm>
+#include <chrono>
 
 #include "rd_log.h"
 
@@ -13,250 +13,412 @@ namespace crossdesk {
 
 constexpr int kSampleRate = 48000;
 constexpr pa_sample_format_t kFormat = PA_SAMPLE_S16LE;
-constexpr int kChannels = 1;
-constexpr size_t kFrameSizeBytes = 480 * sizeof(int16_t);
+constexpr pa_usec_t kHistogramReportIntervalUs = 10 * PA_USEC_PER_SEC;
+constexpr pa_usec_t kMinReconnectDelayUs = PA_USEC_PER_SEC / 2;
+constexpr pa_usec_t kMaxReconnectDelayUs = 30 * PA_USEC_PER_SEC;
 
 SpeakerCapturerLinux::SpeakerCapturerLinux()
-    : inited_(false), paused_(false), stop_flag_(false) {}
-SpeakerCapturerLinux::~SpeakerCapturerLinux() {
-  Stop();
-  Destroy();
+    : inited_(false),
+      paused_(false),
+      stop_flag_(false),
+      frame_slicer_(0),
+      read_callback_seconds_(MetricsRegistry::Instance().GetHistogram(
+          "crossdesk_speaker_read_callback_seconds",
+          "Time spent in the PulseAudio record stream read callback",
+          {0.00005, 0.0001, 0.0002, 0.0005, 0.001, 0.002, 0.005, 0.01,
+           0.02})) {
+  // the series is shared with earlier capturers
+  reported_count_ = read_callback_seconds_->Count();
+  reported_sum_ = read_callback_seconds_->Sum();
 }
+SpeakerCapturerLinux::~SpeakerCapturerLinux() { Destroy(); }
 
-int SpeakerCapturerLinux::Init(speaker_data_cb cb) {
+int SpeakerCapturerLinux::Init(speaker_data_cb cb, int channels,
+                               int frame_duration_ms) {
   if (inited_) return 0;
   cb_ = cb;
+  channels_ = channels == 2 ? 2 : 1;
+  if (frame_duration_ms != 20 && frame_duration_ms != 40) {
+    frame_duration_ms = 10;
+  }
+  frame_size_bytes_ =
+      kSampleRate * frame_duration_ms / 1000 * channels_ * sizeof(int16_t);
+  frame_slicer_.SetFrameSize(frame_size_bytes_);
+
+  mainloop_ = pa_threaded_mainloop_new();
+  if (!mainloop_) {
+    LOG_ERROR("Failed to create PA mainloop");
+    return -1;
+  }
+
+  if (ConnectContext() != 0) {
+    pa_threaded_mainloop_free(mainloop_);
+    mainloop_ = nullptr;
+    return -1;
+  }
+
+  if (pa_threaded_mainloop_start(mainloop_) < 0) {
+    LOG_ERROR("Failed to start mainloop");
+    pa_context_disconnect(context_);
+    pa_context_unref(context_);
+    context_ = nullptr;
+    pa_threaded_mainloop_free(mainloop_);
+    mainloop_ = nullptr;
+    return -1;
+  }
+
   inited_ = true;
   return 0;
 }
 
 int SpeakerCapturerLinux::Destroy() {
+  Stop();
+
+  if (mainloop_) {
+    pa_threaded_mainloop_lock(mainloop_);
+    if (reconnect_event_) {
+      pa_threaded_mainloop_get_api(mainloop_)->time_free(reconnect_event_);
+      reconnect_event_ = nullptr;
+    }
+    if (context_) {
+      pa_context_set_state_callback(context_, nullptr, nullptr);
+      pa_context_set_subscribe_callback(context_, nullptr, nullptr);
+      pa_context_disconnect(context_);
+    }
+    pa_threaded_mainloop_unlock(mainloop_);
+
+    pa_threaded_mainloop_stop(mainloop_);
+
+    if (context_) {
+      pa_context_unref(context_);
+      context_ = nullptr;
+    }
+    pa_threaded_mainloop_free(mainloop_);
+    mainloop_ = nullptr;
+  }
+
+  monitor_name_.clear();
   inited_ = false;
   return 0;
 }
 
-std::string SpeakerCapturerLinux::GetDefaultMonitorSourceName() {
-  std::string monitor_name;
-  std::mutex mtx;
-  std::condition_variable cv;
-  bool ready = false;
+int SpeakerCapturerLinux::ConnectContext() {
+  pa_mainloop_api* api = pa_threaded_mainloop_get_api(mainloop_);
+  context_ = pa_context_new(api, "SpeakerCapturer");
+  if (!context_) {
+    LOG_ERROR("Failed to create PA context");
+    return -1;
+  }
 
-  pa_mainloop* mainloop = pa_mainloop_new();
-  pa_mainloop_api* api = pa_mainloop_get_api(mainloop);
-  pa_context* context = pa_context_new(api, "GetMonitor");
+  pa_context_set_state_callback(
+      context_,
+      [](pa_context*, void* userdata) {
+        static_cast<SpeakerCapturerLinux*>(userdata)->OnContextState();
+      },
+      this);
+  pa_context_set_subscribe_callback(
+      context_,
+      [](pa_context*, pa_subscription_event_type_t type, uint32_t,
+         void* userdata) {
+        static_cast<SpeakerCapturerLinux*>(userdata)->OnSubscribeEvent(type);
+      },
+      this);
+
+  // the server may come up after us, NOFAIL waits for it instead of failing
+  if (pa_context_connect(context_, nullptr, PA_CONTEXT_NOFAIL, nullptr) < 0) {
+    LOG_ERROR("Failed to connect context: {}",
+              pa_strerror(pa_context_errno(context_)));
+    pa_context_set_state_callback(context_, nullptr, nullptr);
+    pa_context_set_subscribe_callback(context_, nullptr, nullptr);
+    pa_context_unref(context_);
+    context_ = nullptr;
+    return -1;
+  }
+  return 0;
+}
 
-  struct CallbackState {
-    std::string* name;
-    std::mutex* mtx;
-    std::condition_variable* cv;
-    bool* ready;
-  } state{&monitor_name, &mtx, &cv, &ready};
+void SpeakerCapturerLinux::ScheduleReconnect() {
+  if (reconnect_event_) {
+    return;
+  }
 
-  pa_context_set_state_callback(
-      context,
-      [](pa_context* c, void* userdata) {
-        auto* state = static_cast<CallbackState*>(userdata);
-        if (pa_context_get_state(c) == PA_CONTEXT_READY) {
-          pa_operation* operation = pa_context_get_server_info(
-              c,
-              [](pa_context*, const pa_server_info* info, void* userdata) {
-                auto* state = static_cast<CallbackState*>(userdata);
-                if (info && info->default_sink_name) {
-                  *(state->name) =
-                      std::string(info->default_sink_name) + ".monitor";
-                }
-                {
-                  std::lock_guard<std::mutex> lock(*(state->mtx));
-                  *(state->ready) = true;
-                }
-                state->cv->notify_one();
-              },
-              userdata);
-          if (operation) {
-            pa_operation_unref(operation);
-          }
-        }
+  reconnect_delay_us_ =
+      reconnect_delay_us_ == 0
+          ? kMinReconnectDelayUs
+          : std::min(reconnect_delay_us_ * 2, kMaxReconnectDelayUs);
+  LOG_INFO("Reconnecting to the sound server in {} ms",
+           reconnect_delay_us_ / PA_USEC_PER_MSEC);
+  // a mainloop timer, so the failed context can be dropped off its own stack
+  reconnect_event_ = pa_context_rttime_new(
+      context_, pa_rtclock_now() + reconnect_delay_us_,
+      [](pa_mainloop_api*, pa_time_event*, const struct timeval*,
+         void* userdata) {
+        static_cast<SpeakerCapturerLinux*>(userdata)->Reconnect();
       },
-      &state);
+      this);
+}
 
-  pa_context_connect(context, nullptr, PA_CONTEXT_NOFLAGS, nullptr);
+void SpeakerCapturerLinux::Reconnect() {
+  pa_threaded_mainloop_get_api(mainloop_)->time_free(reconnect_event_);
+  reconnect_event_ = nullptr;
+
+  // the record stream belongs to the old context, it is created again once
+  // the new one finds the default sink
+  ReleaseStream();
+  monitor_name_.clear();
+  if (context_) {
+    pa_context_set_state_callback(context_, nullptr, nullptr);
+    pa_context_set_subscribe_callback(context_, nullptr, nullptr);
+    pa_context_disconnect(context_);
+    pa_context_unref(context_);
+    context_ = nullptr;
+  }
 
-  std::thread loop_thread([&]() {
-    int ret = 0;
-    pa_mainloop_run(mainloop, &ret);
-  });
+  if (ConnectContext() != 0) {
+    // no context left to hang the timer on, retried on the next Start
+    LOG_ERROR("Failed to reconnect to the sound server");
+  }
+}
 
-  {
-    std::unique_lock<std::mutex> lock(mtx);
-    cv.wait_for(lock, std::chrono::seconds(2), [&] { return ready; });
+void SpeakerCapturerLinux::OnContextState() {
+  switch (pa_context_get_state(context_)) {
+    case PA_CONTEXT_READY: {
+      reconnect_delay_us_ = 0;
+      pa_operation* operation = pa_context_subscribe(
+          context_,
+          (pa_subscription_mask_t)(PA_SUBSCRIPTION_MASK_SERVER |
+                                   PA_SUBSCRIPTION_MASK_SINK),
+          nullptr, nullptr);
+      if (operation) {
+        pa_operation_unref(operation);
+      }
+      QueryDefaultSink();
+      break;
+    }
+    case PA_CONTEXT_FAILED:
+    case PA_CONTEXT_TERMINATED:
+      // Destroy drops the callback before disconnecting, so this is always
+      // the server going away, e.g. a PulseAudio or PipeWire restart
+      LOG_ERROR("PA context failed: {}",
+                pa_strerror(pa_context_errno(context_)));
+      ScheduleReconnect();
+      break;
+    default:
+      break;
   }
+}
 
-  pa_context_disconnect(context);
-  pa_context_unref(context);
-  pa_mainloop_quit(mainloop, 0);
-  loop_thread.join();
-  pa_mainloop_free(mainloop);
+void SpeakerCapturerLinux::OnSubscribeEvent(pa_subscription_event_type_t type) {
+  int facility = type & PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
+  int event = type & PA_SUBSCRIPTION_EVENT_TYPE_MASK;
 
-  return monitor_name;
+  // sink change events also fire on every volume change, only added and
+  // removed sinks can move the default
+  if (facility == PA_SUBSCRIPTION_EVENT_SERVER ||
+      (facility == PA_SUBSCRIPTION_EVENT_SINK &&
+       event != PA_SUBSCRIPTION_EVENT_CHANGE)) {
+    QueryDefaultSink();
+  }
 }
 
-int SpeakerCapturerLinux::Start() {
-  if (!inited_ || mainloop_thread_.joinable()) return -1;
-  stop_flag_ = false;
-
-  mainloop_thread_ = std::thread([this]() {
-    std::string monitor_name = GetDefaultMonitorSourceName();
-    if (monitor_name.empty()) {
-      LOG_ERROR("Failed to get monitor source");
-      return;
-    }
+void SpeakerCapturerLinux::QueryDefaultSink() {
+  pa_operation* operation = pa_context_get_server_info(
+      context_,
+      [](pa_context*, const pa_server_info* info, void* userdata) {
+        static_cast<SpeakerCapturerLinux*>(userdata)->OnServerInfo(info);
+      },
+      this);
+  if (operation) {
+    pa_operation_unref(operation);
+  }
+}
+
+void SpeakerCapturerLinux::OnServerInfo(const pa_server_info* info) {
+  if (!info || !info->default_sink_name) {
+    LOG_WARN("No default sink");
+    return;
+  }
+
+  std::string monitor_name = std::string(info->default_sink_name) + ".monitor";
+  if (monitor_name == monitor_name_) {
+    return;
+  }
 
-    mainloop_ = pa_threaded_mainloop_new();
-    pa_mainloop_api* api = pa_threaded_mainloop_get_api(mainloop_);
-    context_ = pa_context_new(api, "SpeakerCapturer");
-
-    pa_context_set_state_callback(
-        context_,
-        [](pa_context* c, void* userdata) {
-          auto self = static_cast<SpeakerCapturerLinux*>(userdata);
-          pa_context_state_t state = pa_context_get_state(c);
-          if (state == PA_CONTEXT_READY || state == PA_CONTEXT_FAILED ||
-              state == PA_CONTEXT_TERMINATED) {
-            pa_threaded_mainloop_signal(self->mainloop_, 0);
+  LOG_INFO("Default monitor source changed [{}] -> [{}]", monitor_name_,
+           monitor_name);
+  monitor_name_ = monitor_name;
+
+  if (stream_ && pa_stream_get_state(stream_) == PA_STREAM_READY) {
+    // keep the stream and just move it, the frame pipeline never notices
+    pa_operation* operation = pa_context_move_source_output_by_name(
+        context_, pa_stream_get_index(stream_), monitor_name_.c_str(),
+        [](pa_context* c, int success, void*) {
+          if (!success) {
+            LOG_ERROR("Failed to move record stream: {}",
+                      pa_strerror(pa_context_errno(c)));
           }
         },
-        this);
-
-    if (pa_threaded_mainloop_start(mainloop_) < 0) {
-      LOG_ERROR("Failed to start mainloop");
-      Cleanup();
-      return;
+        nullptr);
+    if (operation) {
+      pa_operation_unref(operation);
     }
+  } else if (capturing_) {
+    // not connected yet or failed on the old source, start over
+    ReleaseStream();
+    CreateStream();
+  }
+}
 
-    pa_threaded_mainloop_lock(mainloop_);
-
-    if (pa_context_connect(context_, nullptr, PA_CONTEXT_NOFLAGS, nullptr) <
-        0) {
-      LOG_ERROR("Failed to connect context");
-      pa_threaded_mainloop_unlock(mainloop_);
-      Cleanup();
-      return;
-    }
+int SpeakerCapturerLinux::CreateStream() {
+  pa_sample_spec ss = {kFormat, kSampleRate, (uint8_t)channels_};
+  stream_ = pa_stream_new(context_, "Capture", &ss, nullptr);
+  if (!stream_) {
+    LOG_ERROR("Failed to create stream: {}",
+              pa_strerror(pa_context_errno(context_)));
+    return -1;
+  }
 
-    while (true) {
-      pa_context_state_t state = pa_context_get_state(context_);
-      if (state == PA_CONTEXT_READY) break;
-      if (!PA_CONTEXT_IS_GOOD(state) || stop_flag_) {
-        pa_threaded_mainloop_unlock(mainloop_);
-        Cleanup();
-        return;
-      }
-      pa_threaded_mainloop_wait(mainloop_);
-    }
+  pa_stream_set_read_callback(
+      stream_,
+      [](pa_stream* s, size_t len, void* u) {
+        static_cast<SpeakerCapturerLinux*>(u)->OnStreamRead(s, len);
+      },
+      this);
+  pa_stream_set_state_callback(
+      stream_,
+      [](pa_stream* s, void*) {
+        if (pa_stream_get_state(s) == PA_STREAM_FAILED) {
+          LOG_ERROR("Record stream failed: {}",
+                    pa_strerror(pa_context_errno(pa_stream_get_context(s))));
+        }
+      },
+      nullptr);
+
+  pa_buffer_attr attr = {.maxlength = (uint32_t)-1,
+                         .tlength = 0,
+                         .prebuf = 0,
+                         .minreq = 0,
+                         .fragsize = (uint32_t)frame_size_bytes_};
+
+  if (pa_stream_connect_record(stream_, monitor_name_.c_str(), &attr,
+                               PA_STREAM_ADJUST_LATENCY) < 0) {
+    LOG_ERROR("Failed to connect stream: {}",
+              pa_strerror(pa_context_errno(context_)));
+    pa_stream_unref(stream_);
+    stream_ = nullptr;
+    return -1;
+  }
 
-    pa_sample_spec ss = {kFormat, kSampleRate, kChannels};
-    stream_ = pa_stream_new(context_, "Capture", &ss, nullptr);
-
-    pa_stream_set_read_callback(
-        stream_,
-        [](pa_stream* s, size_t len, void* u) {
-          auto self = static_cast<SpeakerCapturerLinux*>(u);
-          if (self->paused_ || self->stop_flag_) return;
-
-          const void* data = nullptr;
-          if (pa_stream_peek(s, &data, &len) < 0 || !data) return;
-
-          const uint8_t* p = static_cast<const uint8_t*>(data);
-          self->frame_cache_.insert(self->frame_cache_.end(), p, p + len);
-
-          while (self->frame_cache_.size() >= kFrameSizeBytes) {
-            std::vector<uint8_t> temp_frame(
-                self->frame_cache_.begin(),
-                self->frame_cache_.begin() + kFrameSizeBytes);
-            self->cb_(temp_frame.data(), kFrameSizeBytes, "audio");
-            self->frame_cache_.erase(
-                self->frame_cache_.begin(),
-                self->frame_cache_.begin() + kFrameSizeBytes);
-          }
+  return 0;
+}
 
-          pa_stream_drop(s);
-        },
-        this);
+void SpeakerCapturerLinux::ReleaseStream() {
+  if (stream_) {
+    pa_stream_set_read_callback(stream_, nullptr, nullptr);
+    pa_stream_set_state_callback(stream_, nullptr, nullptr);
+    pa_stream_disconnect(stream_);
+    pa_stream_unref(stream_);
+    stream_ = nullptr;
+  }
 
-    pa_buffer_attr attr = {.maxlength = (uint32_t)-1,
-                           .tlength = 0,
-                           .prebuf = 0,
-                           .minreq = 0,
-                           .fragsize = (uint32_t)kFrameSizeBytes};
-
-    if (pa_stream_connect_record(stream_, monitor_name.c_str(), &attr,
-                                 PA_STREAM_ADJUST_LATENCY) < 0) {
-      LOG_ERROR("Failed to connect stream");
-      pa_threaded_mainloop_unlock(mainloop_);
-      Cleanup();
-      return;
-    }
+  frame_slicer_.Reset();
+}
 
-    while (true) {
-      pa_stream_state_t s = pa_stream_get_state(stream_);
-      if (s == PA_STREAM_READY) break;
-      if (!PA_STREAM_IS_GOOD(s) || stop_flag_) {
-        pa_threaded_mainloop_unlock(mainloop_);
-        Cleanup();
-        return;
-      }
-      pa_threaded_mainloop_wait(mainloop_);
-    }
+int SpeakerCapturerLinux::Start() {
+  if (!inited_) return -1;
 
+  int ret = 0;
+  pa_threaded_mainloop_lock(mainloop_);
+  if (!context_ && ConnectContext() != 0) {
     pa_threaded_mainloop_unlock(mainloop_);
+    return -1;
+  }
+  if (!capturing_) {
+    capturing_ = true;
+    stop_flag_ = false;
+
+    // before the context is ready the stream is created by OnServerInfo
+    if (pa_context_get_state(context_) == PA_CONTEXT_READY &&
+        !monitor_name_.empty()) {
+      ret = CreateStream();
+    }
 
-    while (!stop_flag_)
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-  });
+    report_event_ = pa_context_rttime_new(
+        context_, pa_rtclock_now() + kHistogramReportIntervalUs,
+        [](pa_mainloop_api*, pa_time_event* e, const struct timeval*,
+           void* userdata) {
+          static_cast<SpeakerCapturerLinux*>(userdata)->OnReportTimer(e);
+        },
+        this);
+  }
+  pa_threaded_mainloop_unlock(mainloop_);
 
-  return 0;
+  return ret;
 }
 
-int SpeakerCapturerLinux::Stop() {
-  stop_flag_ = true;
+void SpeakerCapturerLinux::OnStreamRead(pa_stream* stream, size_t len) {
+  auto start = std::chrono::steady_clock::now();
 
-  if (mainloop_) {
-    pa_threaded_mainloop_lock(mainloop_);
-    pa_threaded_mainloop_signal(mainloop_, 0);
-    pa_threaded_mainloop_unlock(mainloop_);
+  const void* data = nullptr;
+  if (pa_stream_peek(stream, &data, &len) < 0) {
+    return;
   }
 
-  if (mainloop_thread_.joinable()) {
-    mainloop_thread_.join();
+  // a hole in the stream still has to be dropped
+  if (data && !paused_ && !stop_flag_) {
+    frame_slicer_.Push(static_cast<const uint8_t*>(data), len,
+                       [this](const uint8_t* frame, size_t size) {
+                         cb_(const_cast<unsigned char*>(frame), size, "audio");
+                       });
   }
 
-  Cleanup();
-  return 0;
+  if (len > 0) {
+    pa_stream_drop(stream);
+  }
+
+  read_callback_seconds_->Observe(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count());
 }
 
-void SpeakerCapturerLinux::Cleanup() {
-  if (mainloop_) {
-    pa_threaded_mainloop_stop(mainloop_);
-    pa_threaded_mainloop_lock(mainloop_);
+void SpeakerCapturerLinux::OnReportTimer(pa_time_event* event) {
+  LogReadCallbackDuration();
+  if (!context_) {
+    return;
+  }
+  pa_context_rttime_restart(context_, event,
+                            pa_rtclock_now() + kHistogramReportIntervalUs);
+}
 
-    if (stream_) {
-      pa_stream_disconnect(stream_);
-      pa_stream_unref(stream_);
-      stream_ = nullptr;
-    }
+void SpeakerCapturerLinux::LogReadCallbackDuration() {
+  uint64_t count = read_callback_seconds_->Count() - reported_count_;
+  double sum = read_callback_seconds_->Sum() - reported_sum_;
+  reported_count_ += count;
+  reported_sum_ += sum;
+  if (count > 0) {
+    LOG_INFO("Speaker read callback duration: n={} avg={}us", count,
+             (int64_t)(sum / count * 1000000));
+  }
+}
 
-    if (context_) {
-      pa_context_disconnect(context_);
-      pa_context_unref(context_);
-      context_ = nullptr;
-    }
+int SpeakerCapturerLinux::Stop() {
+  stop_flag_ = true;
 
-    pa_threaded_mainloop_unlock(mainloop_);
-    pa_threaded_mainloop_free(mainloop_);
-    mainloop_ = nullptr;
+  if (!mainloop_) {
+    return 0;
   }
 
-  frame_cache_.clear();
+  pa_threaded_mainloop_lock(mainloop_);
+  capturing_ = false;
+  ReleaseStream();
+  if (report_event_) {
+    pa_threaded_mainloop_get_api(mainloop_)->time_free(report_event_);
+    report_event_ = nullptr;
+  }
+  pa_threaded_mainloop_unlock(mainloop_);
+
+  LogReadCallbackDuration();
+  return 0;
 }
 
 int SpeakerCapturerLinux::Pause() {
@@ -268,4 +430,4 @@ int SpeakerCapturerLinux::Resume() {
   paused_ = false;
   return 0;
 }
-}  // namespace crossdesk
\ No newline at end of file
+}  // namespace crossdesk
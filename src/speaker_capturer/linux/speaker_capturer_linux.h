@@ -11,11 +11,11 @@
 
 #include <atomic>
 #include <functional>
-#include <mutex>
+#include <memory>
 #include <string>
-#include <thread>
-#include <vector>
 
+#include "audio_frame_slicer.h"
+#include "metrics.h"
 #include "speaker_capturer.h"
 
 namespace crossdesk {
@@ -25,7 +25,7 @@ class SpeakerCapturerLinux : public SpeakerCapturer {
   SpeakerCapturerLinux();
   ~SpeakerCapturerLinux();
 
-  int Init(speaker_data_cb cb) override;
+  int Init(speaker_data_cb cb, int channels, int frame_duration_ms) override;
   int Destroy() override;
   int Start() override;
   int Stop() override;
@@ -34,23 +34,49 @@ class SpeakerCapturerLinux : public SpeakerCapturer {
   int Resume();
 
  private:
-  std::string GetDefaultMonitorSourceName();
-  void Cleanup();
+  // all of these run on the PA thread or with the mainloop locked
+  int ConnectContext();
+  void ScheduleReconnect();
+  void Reconnect();
+  void OnContextState();
+  void OnSubscribeEvent(pa_subscription_event_type_t type);
+  void QueryDefaultSink();
+  void OnServerInfo(const pa_server_info* info);
+  int CreateStream();
+  void ReleaseStream();
+  void OnStreamRead(pa_stream* stream, size_t len);
+  void OnReportTimer(pa_time_event* event);
+  void LogReadCallbackDuration();
 
  private:
   speaker_data_cb cb_ = nullptr;
+  int channels_ = 1;
+  size_t frame_size_bytes_ = 0;
 
   std::atomic<bool> inited_;
   std::atomic<bool> paused_;
   std::atomic<bool> stop_flag_;
 
-  std::thread mainloop_thread_;
+  // one context for the lifetime of the capturer, Start/Stop only create and
+  // release the record stream
   pa_threaded_mainloop* mainloop_ = nullptr;
   pa_context* context_ = nullptr;
   pa_stream* stream_ = nullptr;
+  pa_time_event* report_event_ = nullptr;
+  // a restarted sound server leaves the context failed, it is replaced after
+  // a growing delay
+  pa_time_event* reconnect_event_ = nullptr;
+  pa_usec_t reconnect_delay_us_ = 0;
+  // monitor source of the current default sink
+  std::string monitor_name_;
+  bool capturing_ = false;
 
-  std::mutex state_mtx_;
-  std::vector<uint8_t> frame_cache_;
+  // only touched on the PA thread
+  AudioFrameSlicer frame_slicer_;
+  std::shared_ptr<Histogram> read_callback_seconds_;
+  // totals at the last log line, the log shows the interval since
+  uint64_t reported_count_ = 0;
+  double reported_sum_ = 0;
 };
 }  // namespace crossdesk
-#endif
\ No newline at end of file
+#endif
@@ -10,6 +10,7 @@
 #include <thread>
 #include <vector>
 
+#include "audio_frame_slicer.h"
 #include "speaker_capturer.h"
 
 namespace crossdesk {
@@ -20,7 +21,7 @@ class SpeakerCapturerMacosx : public SpeakerCapturer {
   ~SpeakerCapturerMacosx();
 
  public:
-  virtual int Init(speaker_data_cb cb);
+  virtual int Init(speaker_data_cb cb, int channels, int frame_duration_ms);
   virtual int Destroy();
   virtual int Start();
   virtual int Stop();
@@ -31,6 +32,9 @@ class SpeakerCapturerMacosx : public SpeakerCapturer {
  public:
   speaker_data_cb cb_ = nullptr;
   bool inited_ = false;
+  int channels_ = 1;
+  // only touched on the capture queue
+  AudioFrameSlicer frame_slicer_{0};
 
   class Impl;
   Impl* impl_ = nullptr;
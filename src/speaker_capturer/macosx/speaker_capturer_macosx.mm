@@ -37,57 +37,66 @@ class SpeakerCapturerMacosx;
       CMAudioFormatDescriptionGetStreamBasicDescription(formatDesc);
 
   if (_owner->cb_ && dataPtr && length > 0 && asbd) {
-    std::vector<short> out_pcm16;
+    int channels = asbd->mChannelsPerFrame;
+    std::vector<short> pcm16;
     if (asbd->mFormatFlags & kAudioFormatFlagIsFloat) {
-      int channels = asbd->mChannelsPerFrame;
       int samples = (int)(length / sizeof(float));
       float* floatData = (float*)dataPtr;
-      std::vector<short> pcm16(samples);
+      pcm16.resize(samples);
       for (int i = 0; i < samples; ++i) {
         float v = floatData[i];
         if (v > 1.0f) v = 1.0f;
         if (v < -1.0f) v = -1.0f;
         pcm16[i] = (short)(v * 32767.0f);
       }
-
-      if (channels > 1) {
-        int mono_samples = samples / channels;
-        out_pcm16.resize(mono_samples);
-        for (int i = 0; i < mono_samples; ++i) {
-          int sum = 0;
-          for (int c = 0; c < channels; ++c) {
-            sum += pcm16[i * channels + c];
-          }
-          out_pcm16[i] = sum / channels;
-        }
-      } else {
-        out_pcm16 = std::move(pcm16);
-      }
     } else if (asbd->mBitsPerChannel == 16) {
-      int channels = asbd->mChannelsPerFrame;
       int samples = (int)(length / 2);
       short* src = (short*)dataPtr;
-      if (channels > 1) {
-        int mono_samples = samples / channels;
-        out_pcm16.resize(mono_samples);
-        for (int i = 0; i < mono_samples; ++i) {
+      pcm16.assign(src, src + samples);
+    }
+
+    // multichannel buffers come one plane per channel, interleave them
+    if (channels > 1 && (asbd->mFormatFlags & kAudioFormatFlagIsNonInterleaved)) {
+      int frames = (int)pcm16.size() / channels;
+      std::vector<short> interleaved(pcm16.size());
+      for (int i = 0; i < frames; ++i) {
+        for (int c = 0; c < channels; ++c) {
+          interleaved[i * channels + c] = pcm16[c * frames + i];
+        }
+      }
+      pcm16 = std::move(interleaved);
+    }
+
+    // convert to the channel count requested in Init
+    int out_channels = _owner->channels_;
+    std::vector<short> out_pcm16;
+    if (channels == out_channels) {
+      out_pcm16 = std::move(pcm16);
+    } else if (channels > 0) {
+      int frames = (int)pcm16.size() / channels;
+      out_pcm16.resize((size_t)frames * out_channels);
+      for (int i = 0; i < frames; ++i) {
+        if (out_channels == 1) {
           int sum = 0;
           for (int c = 0; c < channels; ++c) {
-            sum += src[i * channels + c];
+            sum += pcm16[i * channels + c];
           }
           out_pcm16[i] = sum / channels;
+        } else {
+          for (int c = 0; c < out_channels; ++c) {
+            out_pcm16[i * out_channels + c] =
+                pcm16[i * channels + (c < channels ? c : channels - 1)];
+          }
         }
-      } else {
-        out_pcm16.assign(src, src + samples);
       }
     }
 
-    size_t frame_bytes = 960;  // 480 * 2
-    size_t total_bytes = out_pcm16.size() * sizeof(short);
-    unsigned char* p = (unsigned char*)out_pcm16.data();
-    for (size_t offset = 0; offset + frame_bytes <= total_bytes; offset += frame_bytes) {
-      _owner->cb_(p + offset, frame_bytes, "audio");
-    }
+    crossdesk::SpeakerCapturerMacosx* owner = _owner;
+    owner->frame_slicer_.Push(
+        (const uint8_t*)out_pcm16.data(), out_pcm16.size() * sizeof(short),
+        [owner](const uint8_t* frame, size_t size) {
+          owner->cb_((unsigned char*)frame, size, "audio");
+        });
   }
 }
 
@@ -132,16 +141,23 @@ SpeakerCapturerMacosx::~SpeakerCapturerMacosx() {
   impl_ = nullptr;
 }
 
-int SpeakerCapturerMacosx::Init(speaker_data_cb cb) {
+int SpeakerCapturerMacosx::Init(speaker_data_cb cb, int channels,
+                                int frame_duration_ms) {
   if (inited_) {
     return 0;
   }
   cb_ = cb;
+  channels_ = channels == 2 ? 2 : 1;
+  if (frame_duration_ms != 20 && frame_duration_ms != 40) {
+    frame_duration_ms = 10;
+  }
+  frame_slicer_.SetFrameSize(48000 * frame_duration_ms / 1000 * channels_ *
+                             sizeof(short));
 
   impl_->config = [[SCStreamConfiguration alloc] init];
   impl_->config.capturesAudio = YES;
   impl_->config.sampleRate = 48000;
-  impl_->config.channelCount = 1;
+  impl_->config.channelCount = channels_;
 
   dispatch_semaphore_t sema = dispatch_semaphore_create(0);
   __block NSError* error = nil;
@@ -20,7 +20,9 @@ class SpeakerCapturer {
   virtual ~SpeakerCapturer() {}
 
  public:
-  virtual int Init(speaker_data_cb cb) = 0;
+  // frames handed to cb are 48 kHz S16 interleaved, frame_duration_ms long
+  virtual int Init(speaker_data_cb cb, int channels = 1,
+                   int frame_duration_ms = 10) = 0;
   virtual int Destroy() = 0;
   virtual int Start() = 0;
   virtual int Stop() = 0;
@@ -25,9 +25,8 @@ void data_callback(ma_device* pDevice, void* pOutput, const void* pInput,
              fp_);
     }
 
-    ptr->GetCallback()((unsigned char*)pInput,
-                       frameCount * ma_get_bytes_per_frame(format_, channels_),
-                       "audio");
+    ptr->OnData(pInput,
+                frameCount * ma_get_bytes_per_frame(format_, channels_));
   }
 
   (void)pOutput;
@@ -37,6 +36,15 @@ SpeakerCapturerWasapi::speaker_data_cb SpeakerCapturerWasapi::GetCallback() {
   return cb_;
 }
 
+void SpeakerCapturerWasapi::OnData(const void* data, size_t size) {
+  // WASAPI periods do not line up with our frame size
+  frame_slicer_.Push(static_cast<const uint8_t*>(data), size,
+                     [this](const uint8_t* frame, size_t frame_size) {
+                       cb_(const_cast<unsigned char*>(frame), frame_size,
+                           "audio");
+                     });
+}
+
 SpeakerCapturerWasapi::SpeakerCapturerWasapi() {}
 
 SpeakerCapturerWasapi::~SpeakerCapturerWasapi() {
@@ -45,12 +53,19 @@ SpeakerCapturerWasapi::~SpeakerCapturerWasapi() {
   }
 }
 
-int SpeakerCapturerWasapi::Init(speaker_data_cb cb) {
+int SpeakerCapturerWasapi::Init(speaker_data_cb cb, int channels,
+                                int frame_duration_ms) {
   if (inited_) {
     return 0;
   }
 
   cb_ = cb;
+  channels_ = channels == 2 ? 2 : 1;
+  if (frame_duration_ms != 20 && frame_duration_ms != 40) {
+    frame_duration_ms = 10;
+  }
+  frame_slicer_.SetFrameSize(sample_rate_ * frame_duration_ms / 1000 *
+                             ma_get_bytes_per_frame(format_, channels_));
 
   if (SAVE_AUDIO_FILE) {
     fopen_s(&fp_, "system_audio.pcm", "wb");
@@ -97,6 +112,7 @@ int SpeakerCapturerWasapi::Stop() {
 
 int SpeakerCapturerWasapi::Destroy() {
   ma_device_uninit(&device_);
+  inited_ = false;
   return 0;
 }
 
@@ -7,6 +7,7 @@
 #ifndef _SPEAKER_CAPTURER_WASAPI_H_
 #define _SPEAKER_CAPTURER_WASAPI_H_
 
+#include "audio_frame_slicer.h"
 #include "speaker_capturer.h"
 
 namespace crossdesk {
@@ -17,7 +18,7 @@ class SpeakerCapturerWasapi : public SpeakerCapturer {
   ~SpeakerCapturerWasapi();
 
  public:
-  virtual int Init(speaker_data_cb cb);
+  virtual int Init(speaker_data_cb cb, int channels, int frame_duration_ms);
   virtual int Destroy();
   virtual int Start();
   virtual int Stop();
@@ -26,9 +27,11 @@ class SpeakerCapturerWasapi : public SpeakerCapturer {
   int Resume();
 
   speaker_data_cb GetCallback();
+  void OnData(const void* data, size_t size);
 
  private:
   speaker_data_cb cb_ = nullptr;
+  AudioFrameSlicer frame_slicer_{0};
 
  private:
   bool inited_ = false;
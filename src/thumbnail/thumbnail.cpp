@@ -5,11 +5,14 @@
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 
+#include <algorithm>
 #include <chrono>
+#include <climits>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -23,12 +26,31 @@
 
 namespace crossdesk {
 
-bool LoadTextureFromMemory(const void* data, size_t data_size,
-                           SDL_Renderer* renderer, SDL_Texture** out_texture,
+// generations and image versions share one counter, so they stay unique
+// across Thumbnail instances
+static std::atomic<uint64_t> thumbnail_sequence{0};
+
+static uint64_t NextSequence() { return ++thumbnail_sequence; }
+
+static std::vector<std::string> SplitFields(const std::string& line,
+                                            char delimiter) {
+  std::vector<std::string> fields;
+  std::string field;
+  std::istringstream stream(line);
+  while (std::getline(stream, field, delimiter)) {
+    fields.push_back(field);
+  }
+  if (!line.empty() && line.back() == delimiter) {
+    fields.push_back("");
+  }
+  return fields;
+}
+
+bool DecodeImageFromMemory(const void* data, size_t data_size,
+                           std::vector<unsigned char>* out_rgba,
                            int* out_width, int* out_height) {
   int image_width = 0;
   int image_height = 0;
-  int channels = 4;
   unsigned char* image_data =
       stbi_load_from_memory((const unsigned char*)data, (int)data_size,
                             &image_width, &image_height, NULL, 4);
@@ -37,33 +59,16 @@ bool LoadTextureFromMemory(const void* data, size_t data_size,
     return false;
   }
 
-  // ABGR
-  int pitch = image_width * channels;
-  SDL_Surface* surface =
-      SDL_CreateSurfaceFrom(image_width, image_height, SDL_PIXELFORMAT_RGBA32,
-                            (void*)image_data, pitch);
-  if (surface == nullptr) {
-    LOG_ERROR("Failed to create SDL surface: [{}]", SDL_GetError());
-    return false;
-  }
-
-  SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-  if (texture == nullptr) {
-    LOG_ERROR("Failed to create SDL texture: [{}]", SDL_GetError());
-  }
-
-  *out_texture = texture;
+  out_rgba->assign(image_data, image_data + image_width * image_height * 4);
   *out_width = image_width;
   *out_height = image_height;
-
-  SDL_DestroySurface(surface);
   stbi_image_free(image_data);
 
   return true;
 }
 
-bool LoadTextureFromFile(const char* file_name, SDL_Renderer* renderer,
-                         SDL_Texture** out_texture, int* out_width,
+bool DecodeImageFromFile(const char* file_name,
+                         std::vector<unsigned char>* out_rgba, int* out_width,
                          int* out_height) {
   std::filesystem::path file_path(file_name);
   if (!std::filesystem::exists(file_path)) return false;
@@ -73,14 +78,33 @@ bool LoadTextureFromFile(const char* file_name, SDL_Renderer* renderer,
   size_t file_size = file.tellg();
   file.seekg(0, std::ios::beg);
   if (file_size == -1) return false;
-  char* file_data = new char[file_size];
-  if (!file_data) return false;
-  file.read(file_data, file_size);
-  bool ret = LoadTextureFromMemory(file_data, file_size, renderer, out_texture,
-                                   out_width, out_height);
-  delete[] file_data;
-
-  return ret;
+  std::vector<char> file_data(file_size);
+  file.read(file_data.data(), file_size);
+  return DecodeImageFromMemory(file_data.data(), file_size, out_rgba,
+                               out_width, out_height);
+}
+
+bool CreateTextureFromRgba(const unsigned char* rgba, int width, int height,
+                           SDL_Renderer* renderer, SDL_Texture** out_texture) {
+  // ABGR
+  int channels = 4;
+  int pitch = width * channels;
+  SDL_Surface* surface = SDL_CreateSurfaceFrom(
+      width, height, SDL_PIXELFORMAT_RGBA32, (void*)rgba, pitch);
+  if (surface == nullptr) {
+    LOG_ERROR("Failed to create SDL surface: [{}]", SDL_GetError());
+    return false;
+  }
+
+  SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+  if (texture == nullptr) {
+    LOG_ERROR("Failed to create SDL texture: [{}]", SDL_GetError());
+  }
+
+  *out_texture = texture;
+  SDL_DestroySurface(surface);
+
+  return texture != nullptr;
 }
 
 void ScaleNv12ToABGR(char* src, int src_w, int src_h, int dst_w, int dst_h,
@@ -136,6 +160,7 @@ Thumbnail::Thumbnail(std::string save_path) {
   RAND_bytes(aes128_key_, sizeof(aes128_key_));
   RAND_bytes(aes128_iv_, sizeof(aes128_iv_));
   std::filesystem::create_directories(save_path_);
+  generation_ = NextSequence();
 }
 
 Thumbnail::Thumbnail(std::string save_path, unsigned char* aes128_key,
@@ -147,6 +172,7 @@ Thumbnail::Thumbnail(std::string save_path, unsigned char* aes128_key,
   memcpy(aes128_key_, aes128_key, sizeof(aes128_key_));
   memcpy(aes128_iv_, aes128_iv, sizeof(aes128_iv_));
   std::filesystem::create_directories(save_path_);
+  generation_ = NextSequence();
 }
 
 Thumbnail::~Thumbnail() {
@@ -182,20 +208,46 @@ int Thumbnail::SaveToThumbnail(const char* yuv420p, int width, int height,
     }
   }
 
-  std::string image_file_name;
   if (password.empty()) {
     return 0;
-  } else {
-    // delete the old thumbnail
-    std::string filename_with_remote_id = remote_id;
-    DeleteThumbnail(filename_with_remote_id);
   }
 
   std::string cipher_password = AES_encrypt(password, aes128_key_, aes128_iv_);
-  image_file_name = remote_id + 'Y' + host_name + '@' + cipher_password;
+  std::string image_file_name =
+      remote_id + 'Y' + host_name + '@' + cipher_password;
   std::string file_path = save_path_ + image_file_name;
-  stbi_write_png(file_path.data(), thumbnail_width_, thumbnail_height_, 4,
-                 rgba_buffer_, thumbnail_width_ * 4);
+  std::lock_guard<std::mutex> lock(files_mutex_);
+  LoadIndex();
+  // replaces the old thumbnail
+  RemoveEntries(remote_id);
+  if (!stbi_write_png(file_path.data(), thumbnail_width_, thumbnail_height_, 4,
+                      rgba_buffer_, thumbnail_width_ * 4)) {
+    LOG_ERROR("Failed to write thumbnail [{}]", remote_id);
+    WriteIndex();
+    generation_ = NextSequence();
+    return -1;
+  }
+
+  IndexEntry entry;
+  entry.file_name = image_file_name;
+  entry.remote_id = remote_id;
+  entry.host_name = host_name;
+  entry.cipher_password = cipher_password;
+  entry.version = NextSequence();
+  entry.width = thumbnail_width_;
+  entry.height = thumbnail_height_;
+  std::error_code ec;
+  entry.file_size = std::filesystem::file_size(file_path, ec);
+  index_.insert(index_.begin(), entry);
+  WriteIndex();
+
+  // the next reload takes it from memory instead of decoding the png
+  const unsigned char* rgba = (const unsigned char*)rgba_buffer_;
+  CacheImage(remote_id, entry.version,
+             std::vector<unsigned char>(
+                 rgba, rgba + thumbnail_width_ * thumbnail_height_ * 4),
+             thumbnail_width_, thumbnail_height_);
+  generation_ = NextSequence();
 
   return 0;
 }
@@ -205,87 +257,318 @@ int Thumbnail::LoadThumbnail(
     std::vector<std::pair<std::string, Thumbnail::RecentConnection>>&
         recent_connections,
     int* width, int* height) {
+  std::vector<DecodedThumbnail> decoded;
+  DecodeThumbnails(&decoded);
+  return UploadThumbnails(renderer, decoded, recent_connections, width,
+                          height, INT_MAX);
+}
+
+int Thumbnail::DecodeThumbnails(std::vector<DecodedThumbnail>* decoded) {
+  decoded->clear();
+
+  std::vector<IndexEntry> entries;
+  {
+    std::lock_guard<std::mutex> lock(files_mutex_);
+    LoadIndex();
+    entries = index_;
+    for (const auto& entry : entries) {
+      decoded->emplace_back();
+      decoded->back().version = entry.version;
+      FindCachedImage(entry.remote_id, entry.version, &decoded->back());
+    }
+  }
+
+  if (entries.empty()) {
+    return -1;
+  }
+
+  // file io, decryption and decoding run without the lock, a save or delete
+  // meanwhile only bumps the generation and triggers another reload
+  for (size_t i = 0; i < entries.size(); i++) {
+    const IndexEntry& entry = entries[i];
+    DecodedThumbnail& thumbnail = (*decoded)[i];
+    if (entry.cipher_password.empty()) {
+      thumbnail.name = entry.remote_id + 'N' + entry.host_name;
+    } else {
+      thumbnail.name =
+          entry.remote_id + 'Y' + entry.host_name + "@" +
+          AES_decrypt(entry.cipher_password, aes128_key_, aes128_iv_);
+    }
+
+    if (!thumbnail.rgba.empty()) {
+      continue;
+    }
+
+    // an entry whose image fails to decode is still listed, without texture
+    std::string image_path = save_path_ + entry.file_name;
+    if (!DecodeImageFromFile(image_path.c_str(), &thumbnail.rgba,
+                             &thumbnail.width, &thumbnail.height)) {
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(files_mutex_);
+    bool current = std::any_of(index_.begin(), index_.end(),
+                               [&entry](const IndexEntry& it) {
+                                 return it.version == entry.version;
+                               });
+    if (current) {
+      CacheImage(entry.remote_id, entry.version, thumbnail.rgba,
+                 thumbnail.width, thumbnail.height);
+    }
+  }
+  return 0;
+}
+
+int Thumbnail::UploadThumbnails(
+    SDL_Renderer* renderer, std::vector<DecodedThumbnail>& decoded,
+    std::vector<std::pair<std::string, Thumbnail::RecentConnection>>&
+        recent_connections,
+    int* width, int* height, int max_uploads) {
+  std::vector<std::pair<std::string, Thumbnail::RecentConnection>> updated;
+  int uploads = 0;
+  int waiting = 0;
+  for (auto& thumbnail : decoded) {
+    updated.emplace_back(
+        std::make_pair(thumbnail.name, Thumbnail::RecentConnection()));
+    if (thumbnail.rgba.empty()) {
+      continue;
+    }
+
+    Thumbnail::RecentConnection& connection = updated.back().second;
+    auto existing = std::find_if(
+        recent_connections.begin(), recent_connections.end(),
+        [&thumbnail](const auto& it) {
+          return it.first == thumbnail.name && it.second.texture &&
+                 it.second.version == thumbnail.version;
+        });
+    if (existing != recent_connections.end()) {
+      // moved over, the leftovers are destroyed below
+      connection.texture = existing->second.texture;
+      connection.version = thumbnail.version;
+      existing->second.texture = nullptr;
+    } else if (uploads < max_uploads) {
+      uploads++;
+      if (CreateTextureFromRgba(thumbnail.rgba.data(), thumbnail.width,
+                                thumbnail.height, renderer,
+                                &connection.texture)) {
+        connection.version = thumbnail.version;
+      }
+    } else {
+      waiting++;
+      continue;
+    }
+    *width = thumbnail.width;
+    *height = thumbnail.height;
+  }
+
   for (auto& it : recent_connections) {
     if (it.second.texture != nullptr) {
       SDL_DestroyTexture(it.second.texture);
       it.second.texture = nullptr;
     }
   }
-  recent_connections.clear();
+  recent_connections.swap(updated);
+
+  if (decoded.empty()) {
+    return -1;
+  }
+  return waiting;
+}
+
+int Thumbnail::DeleteThumbnail(const std::string& filename_keyword) {
+  std::lock_guard<std::mutex> lock(files_mutex_);
+  LoadIndex();
+  if (RemoveEntries(filename_keyword) > 0) {
+    WriteIndex();
+    generation_ = NextSequence();
+  }
+
+  return 0;
+}
+
+int Thumbnail::LoadIndex() {
+  if (index_loaded_) {
+    return 0;
+  }
+  index_loaded_ = true;
+  index_.clear();
+
+  std::ifstream file(save_path_ + THUMBNAIL_INDEX_FILE);
+  if (!file) {
+    // thumbnails saved before the index existed
+    return RebuildIndexFromDirectory();
+  }
+
+  std::string line;
+  if (!std::getline(file, line) || line != THUMBNAIL_INDEX_HEADER) {
+    LOG_ERROR("Unknown thumbnail index format, rebuilding it");
+    file.close();
+    return RebuildIndexFromDirectory();
+  }
+
+  // file_name \t remote_id \t host_name \t cipher_password \t width \t
+  // height \t file_size
+  while (std::getline(file, line)) {
+    std::vector<std::string> fields = SplitFields(line, '\t');
+    if (fields.size() != 7 || fields[0].empty() || fields[1].empty()) {
+      LOG_ERROR("Invalid thumbnail index entry");
+      continue;
+    }
+
+    IndexEntry entry;
+    entry.file_name = fields[0];
+    entry.remote_id = fields[1];
+    entry.host_name = fields[2];
+    entry.cipher_password = fields[3];
+    entry.width = atoi(fields[4].c_str());
+    entry.height = atoi(fields[5].c_str());
+    entry.file_size = strtoull(fields[6].c_str(), nullptr, 10);
+    entry.version = NextSequence();
+    index_.push_back(entry);
+  }
+  return 0;
+}
+
+int Thumbnail::WriteIndex() {
+  std::string index_path = save_path_ + THUMBNAIL_INDEX_FILE;
+  std::string tmp_path = index_path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::trunc);
+    if (!file) {
+      LOG_ERROR("Failed to write thumbnail index [{}]", tmp_path);
+      return -1;
+    }
+
+    file << THUMBNAIL_INDEX_HEADER << "\n";
+    for (const auto& entry : index_) {
+      file << entry.file_name << '\t' << entry.remote_id << '\t'
+           << entry.host_name << '\t' << entry.cipher_password << '\t'
+           << entry.width << '\t' << entry.height << '\t' << entry.file_size
+           << "\n";
+    }
+    if (!file) {
+      LOG_ERROR("Failed to write thumbnail index [{}]", tmp_path);
+      return -1;
+    }
+  }
+
+  // a crash midway leaves the previous index in place
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, index_path, ec);
+  if (ec) {
+    LOG_ERROR("Failed to replace thumbnail index: [{}]", ec.message());
+    return -1;
+  }
+  return 0;
+}
 
+int Thumbnail::RebuildIndexFromDirectory() {
   std::vector<std::filesystem::path> image_paths =
       FindThumbnailPath(save_path_);
 
-  if (image_paths.size() == 0) {
-    return -1;
-  } else {
-    for (int i = 0; i < image_paths.size(); i++) {
-      // size_t pos1 = image_paths[i].string().find('/') + 1;
-      std::string cipher_image_name = image_paths[i].filename().string();
-      std::string remote_id;
-      std::string cipher_password;
-      std::string remote_host_name;
-      std::string original_image_name;
-
-      if ('Y' == cipher_image_name[9] && cipher_image_name.size() >= 16) {
-        size_t pos_y = cipher_image_name.find('Y');
-        size_t pos_at = cipher_image_name.find('@');
-
-        if (pos_y == std::string::npos || pos_at == std::string::npos ||
-            pos_y >= pos_at) {
-          LOG_ERROR("Invalid filename");
-          continue;
-        }
-
-        remote_id = cipher_image_name.substr(0, pos_y);
-        remote_host_name =
-            cipher_image_name.substr(pos_y + 1, pos_at - pos_y - 1);
-        cipher_password = cipher_image_name.substr(pos_at + 1);
-
-        original_image_name =
-            remote_id + 'Y' + remote_host_name + "@" +
-            AES_decrypt(cipher_password, aes128_key_, aes128_iv_);
-      } else {
-        size_t pos_n = cipher_image_name.find('N');
-        // size_t pos_at = cipher_image_name.find('@');
-
-        if (pos_n == std::string::npos) {
-          LOG_ERROR("Invalid filename");
-          continue;
-        }
-
-        remote_id = cipher_image_name.substr(0, pos_n);
-        remote_host_name = cipher_image_name.substr(pos_n + 1);
-
-        original_image_name =
-            remote_id + 'N' + remote_host_name + "@" +
-            AES_decrypt(cipher_password, aes128_key_, aes128_iv_);
+  for (const auto& image_path : image_paths) {
+    std::string cipher_image_name = image_path.filename().string();
+    IndexEntry entry;
+    entry.file_name = cipher_image_name;
+
+    // remote id length is 9
+    if (cipher_image_name.size() >= 16 && 'Y' == cipher_image_name[9]) {
+      size_t pos_y = cipher_image_name.find('Y');
+      size_t pos_at = cipher_image_name.find('@');
+
+      if (pos_y == std::string::npos || pos_at == std::string::npos ||
+          pos_y >= pos_at) {
+        LOG_ERROR("Invalid filename");
+        continue;
       }
 
-      std::string image_path = save_path_ + cipher_image_name;
-      recent_connections.emplace_back(
-          std::make_pair(original_image_name, Thumbnail::RecentConnection()));
-      LoadTextureFromFile(image_path.c_str(), renderer,
-                          &(recent_connections[i].second.texture), width,
-                          height);
+      entry.remote_id = cipher_image_name.substr(0, pos_y);
+      entry.host_name = cipher_image_name.substr(pos_y + 1, pos_at - pos_y - 1);
+      entry.cipher_password = cipher_image_name.substr(pos_at + 1);
+    } else {
+      size_t pos_n = cipher_image_name.find('N');
+
+      if (pos_n == std::string::npos || pos_n == 0) {
+        LOG_ERROR("Invalid filename");
+        continue;
+      }
+
+      entry.remote_id = cipher_image_name.substr(0, pos_n);
+      entry.host_name = cipher_image_name.substr(pos_n + 1);
     }
-    return 0;
+
+    std::error_code ec;
+    entry.file_size = std::filesystem::file_size(image_path, ec);
+    entry.version = NextSequence();
+    index_.push_back(entry);
   }
-  return 0;
+
+  if (!index_.empty()) {
+    LOG_INFO("Rebuilt thumbnail index with {} entries", index_.size());
+  }
+  return WriteIndex();
 }
 
-int Thumbnail::DeleteThumbnail(const std::string& filename_keyword) {
-  for (const auto& entry : std::filesystem::directory_iterator(save_path_)) {
-    if (entry.is_regular_file()) {
-      const std::string filename = entry.path().filename().string();
-      std::string id_hostname = filename_keyword.substr(0, filename.find('@'));
-      if (filename.find(id_hostname) != std::string::npos) {
-        std::filesystem::remove(entry.path());
-      }
+int Thumbnail::RemoveEntries(const std::string& filename_keyword) {
+  int removed = 0;
+  for (auto it = index_.begin(); it != index_.end();) {
+    if (0 == filename_keyword.compare(0, it->remote_id.size(), it->remote_id)) {
+      std::error_code ec;
+      std::filesystem::remove(save_path_ + it->file_name, ec);
+      EraseCachedImage(it->remote_id);
+      it = index_.erase(it);
+      removed++;
+    } else {
+      ++it;
     }
   }
+  return removed;
+}
+
+void Thumbnail::CacheImage(const std::string& remote_id, uint64_t version,
+                           std::vector<unsigned char> rgba, int width,
+                           int height) {
+  auto it = cache_.find(remote_id);
+  if (it == cache_.end()) {
+    cache_lru_.push_front(remote_id);
+    it = cache_.emplace(remote_id, CachedImage()).first;
+  } else {
+    cache_lru_.splice(cache_lru_.begin(), cache_lru_, it->second.lru_it);
+  }
 
-  return 0;
+  CachedImage& image = it->second;
+  image.version = version;
+  image.rgba = std::move(rgba);
+  image.width = width;
+  image.height = height;
+  image.lru_it = cache_lru_.begin();
+
+  while (cache_.size() > THUMBNAIL_CACHE_CAPACITY) {
+    cache_.erase(cache_lru_.back());
+    cache_lru_.pop_back();
+  }
+}
+
+bool Thumbnail::FindCachedImage(const std::string& remote_id, uint64_t version,
+                                DecodedThumbnail* thumbnail) {
+  auto it = cache_.find(remote_id);
+  if (it == cache_.end() || it->second.version != version) {
+    return false;
+  }
+
+  cache_lru_.splice(cache_lru_.begin(), cache_lru_, it->second.lru_it);
+  thumbnail->rgba = it->second.rgba;
+  thumbnail->width = it->second.width;
+  thumbnail->height = it->second.height;
+  return true;
+}
+
+void Thumbnail::EraseCachedImage(const std::string& remote_id) {
+  auto it = cache_.find(remote_id);
+  if (it != cache_.end()) {
+    cache_lru_.erase(it->second.lru_it);
+    cache_.erase(it);
+  }
 }
 
 std::vector<std::filesystem::path> Thumbnail::FindThumbnailPath(
@@ -297,22 +580,29 @@ std::vector<std::filesystem::path> Thumbnail::FindThumbnailPath(
     return thumbnails_path;
   }
 
+  // one stat per file, not one per comparison
+  std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>>
+      dated_paths;
   for (const auto& entry : std::filesystem::directory_iterator(directory)) {
-    if (entry.is_regular_file()) {
-      thumbnails_path.push_back(entry.path());
+    std::string filename = entry.path().filename().string();
+    if (entry.is_regular_file() &&
+        0 != filename.compare(0, strlen(THUMBNAIL_INDEX_FILE),
+                              THUMBNAIL_INDEX_FILE)) {
+      dated_paths.emplace_back(entry.last_write_time(), entry.path());
     }
   }
 
-  std::sort(thumbnails_path.begin(), thumbnails_path.end(),
-            [](const std::filesystem::path& a, const std::filesystem::path& b) {
-              return std::filesystem::last_write_time(a) >
-                     std::filesystem::last_write_time(b);
-            });
+  std::sort(dated_paths.begin(), dated_paths.end(),
+            [](const auto& a, const auto& b) { return a.first > b.first; });
+  for (auto& it : dated_paths) {
+    thumbnails_path.push_back(std::move(it.second));
+  }
 
   return thumbnails_path;
 }
 
 int Thumbnail::DeleteAllFilesInDirectory() {
+  std::lock_guard<std::mutex> lock(files_mutex_);
   if (std::filesystem::exists(save_path_) &&
       std::filesystem::is_directory(save_path_)) {
     for (const auto& entry : std::filesystem::directory_iterator(save_path_)) {
@@ -320,6 +610,11 @@ int Thumbnail::DeleteAllFilesInDirectory() {
         std::filesystem::remove(entry.path());
       }
     }
+    index_.clear();
+    index_loaded_ = true;
+    cache_.clear();
+    cache_lru_.clear();
+    generation_ = NextSequence();
     return 0;
   }
   return -1;
@@ -378,6 +673,10 @@ std::string Thumbnail::AES_encrypt(const std::string& plaintext,
 
   EVP_CIPHER_CTX_free(ctx);
 
+  // the reported length counts the terminator, which must not reach the index
+  if (hex_str_len > 0 && hex_str[hex_str_len - 1] == '\0') {
+    hex_str_len--;
+  }
   std::string str(reinterpret_cast<char*>(hex_str), hex_str_len);
   return str;
 }
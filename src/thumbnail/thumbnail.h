@@ -9,13 +9,27 @@
 
 #include <SDL3/SDL.h>
 
+#include <atomic>
 #include <filesystem>
+#include <list>
 #include <map>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+// one line per thumbnail in display order, newest first
+#define THUMBNAIL_INDEX_FILE "index"
+#define THUMBNAIL_INDEX_HEADER "crossdesk-thumbnails 1"
+// decoded images kept in memory, keyed by remote id
+#define THUMBNAIL_CACHE_CAPACITY 32
+
 namespace crossdesk {
 
+// fits an NV12 frame into dst_w x dst_h RGBA, the bars left over are black
+void ScaleNv12ToABGR(char* src, int src_w, int src_h, int dst_w, int dst_h,
+                     char* dst_rgba);
+
 class Thumbnail {
  public:
   struct RecentConnection {
@@ -24,6 +38,17 @@ class Thumbnail {
     std::string remote_host_name;
     std::string password;
     bool remember_password = false;
+    // version of the image behind texture, unchanged ones are not uploaded
+    uint64_t version = 0;
+  };
+
+  // a thumbnail read and decoded from disk, ready to become a texture
+  struct DecodedThumbnail {
+    std::string name;
+    uint64_t version = 0;
+    std::vector<unsigned char> rgba;
+    int width = 0;
+    int height = 0;
   };
 
  public:
@@ -46,6 +71,23 @@ class Thumbnail {
           recent_connections,
       int* width, int* height);
 
+  // changes with every save and delete, a reload is only needed when it
+  // differs from the one the current list was decoded at
+  uint64_t GetGeneration() const { return generation_; }
+
+  // LoadThumbnail in two halves: decoding reads the index, decrypts the
+  // passwords and decodes the images missing from the cache and may run on
+  // any thread, uploading creates the textures on the thread owning renderer
+  int DecodeThumbnails(std::vector<DecodedThumbnail>* decoded);
+  // rebuilds recent_connections in index order, keeping the textures of
+  // unchanged entries and creating at most max_uploads new ones per call,
+  // returns how many are still waiting for a texture
+  int UploadThumbnails(
+      SDL_Renderer* renderer, std::vector<DecodedThumbnail>& decoded,
+      std::vector<std::pair<std::string, Thumbnail::RecentConnection>>&
+          recent_connections,
+      int* width, int* height, int max_uploads);
+
   int DeleteThumbnail(const std::string& filename_keyword);
 
   int DeleteAllFilesInDirectory();
@@ -67,6 +109,39 @@ class Thumbnail {
   }
 
  private:
+  struct IndexEntry {
+    std::string file_name;
+    std::string remote_id;
+    std::string host_name;
+    // hex AES, empty for connections saved without password
+    std::string cipher_password;
+    uint64_t version = 0;
+    int width = 0;
+    int height = 0;
+    uint64_t file_size = 0;
+  };
+
+  struct CachedImage {
+    uint64_t version = 0;
+    std::vector<unsigned char> rgba;
+    int width = 0;
+    int height = 0;
+    std::list<std::string>::iterator lru_it;
+  };
+
+  // callers hold files_mutex_
+  int LoadIndex();
+  int WriteIndex();
+  int RebuildIndexFromDirectory();
+  // drops every entry and file whose remote id filename_keyword starts
+  // with, returns how many went
+  int RemoveEntries(const std::string& filename_keyword);
+  void CacheImage(const std::string& remote_id, uint64_t version,
+                  std::vector<unsigned char> rgba, int width, int height);
+  bool FindCachedImage(const std::string& remote_id, uint64_t version,
+                       DecodedThumbnail* thumbnail);
+  void EraseCachedImage(const std::string& remote_id);
+
   std::vector<std::filesystem::path> FindThumbnailPath(
       const std::filesystem::path& directory);
 
@@ -86,6 +161,15 @@ class Thumbnail {
   unsigned char aes128_iv_[16];
   unsigned char ciphertext_[64];
   unsigned char decryptedtext_[64];
+
+  // background decoding races with saves and deletes on the UI thread
+  std::mutex files_mutex_;
+  std::vector<IndexEntry> index_;
+  bool index_loaded_ = false;
+  std::unordered_map<std::string, CachedImage> cache_;
+  // most recently used first
+  std::list<std::string> cache_lru_;
+  std::atomic<uint64_t> generation_{0};
 };
 }  // namespace crossdesk
 #endif
\ No newline at end of file
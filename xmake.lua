@@ -13,6 +13,12 @@ option("USE_CUDA")
     set_description("Use CUDA for hardware codec acceleration")
 option_end()
 
+option("loopback_transport")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Link the in-process loopback transport instead of minirtc")
+option_end()
+
 add_rules("mode.release", "mode.debug")
 set_languages("c++17")
 set_encodings("utf-8")
@@ -44,8 +50,8 @@ if is_os("windows") then
 elseif is_os("linux") then
     add_links("pulse-simple", "pulse")
     add_requires("libyuv") 
-    add_syslinks("pthread", "dl")
-    add_links("SDL3", "asound", "X11", "Xtst", "Xrandr", "Xfixes")
+    add_syslinks("pthread", "dl", "rt")
+    add_links("SDL3", "asound", "X11", "Xtst", "Xrandr", "Xfixes", "Xi")
     add_cxflags("-Wno-unused-variable")   
 elseif is_os("macosx") then
     add_links("SDL3")
@@ -80,7 +86,7 @@ target("path_manager")
 
 target("screen_capturer")
     set_kind("object")
-    add_deps("rd_log", "common")
+    add_deps("rd_log", "common", "path_manager")
     add_includedirs("src/screen_capturer", {public = true})
     if is_os("windows") then
         add_packages("libyuv")
@@ -98,7 +104,8 @@ target("screen_capturer")
 
 target("speaker_capturer")
     set_kind("object")
-    add_deps("rd_log")
+    add_deps("rd_log", "common")
+    add_files("src/speaker_capturer/*.cpp")
     add_includedirs("src/speaker_capturer", {public = true})
     if is_os("windows") then
         add_packages("miniaudio")
@@ -113,6 +120,12 @@ target("speaker_capturer")
         add_includedirs("src/speaker_capturer/linux", {public = true})
     end
 
+target("audio_playout")
+    set_kind("object")
+    add_deps("rd_log")
+    add_files("src/audio_playout/*.cpp")
+    add_includedirs("src/audio_playout", {public = true})
+
 target("device_controller")
     set_kind("object")
     add_deps("rd_log", "common")
@@ -134,6 +147,13 @@ target("device_controller")
          "src/device_controller/keyboard/linux", {public = true})
     end
 
+target("remote_action")
+    set_kind("object")
+    add_deps("rd_log", "common")
+    add_files("src/remote_action/*.cpp")
+    add_includedirs("src/remote_action", "src/device_controller",
+        {public = true})
+
 target("thumbnail")
     set_kind("object")
     add_packages("libyuv", "openssl3")
@@ -168,13 +188,47 @@ target("version_checker")
     add_files("src/version_checker/*.cpp")
     add_includedirs("src/version_checker", {public = true})
 
+target("metrics_server")
+    set_kind("object")
+    add_packages("cpp-httplib")
+    add_deps("rd_log", "common")
+    add_files("src/metrics_server/*.cpp")
+    add_includedirs("src/metrics_server", {public = true})
+
+-- peers talk to each other inside one process, no signal server needed
+local transport = has_config("loopback_transport") and "loopback_transport" or "minirtc"
+
+if has_config("loopback_transport") then
+    target("loopback_transport")
+        set_kind("object")
+        add_deps("rd_log")
+        add_files("src/loopback_transport/*.cpp")
+        add_includedirs("src/loopback_transport", {public = true})
+        on_load(function (target)
+            -- minirtc's headers only, linking it would clash with ours
+            import("core.project.project")
+            local minirtc = project.target("minirtc")
+            if minirtc then
+                target:add("includedirs", minirtc:get("includedirs"), {public = true})
+            end
+        end)
+end
+
+target("host")
+    set_kind("object")
+    add_deps("rd_log", "common", transport, "screen_capturer",
+        "speaker_capturer", "device_controller")
+    add_files("src/host/*.cpp")
+    add_includedirs("src/host", {public = true})
+
 target("gui")
     set_kind("object")
     add_packages("libyuv")
     add_defines("CROSSDESK_VERSION=\"" .. (get_config("CROSSDESK_VERSION") or "Unknown") .. "\"")
-    add_deps("rd_log", "common", "assets", "config_center", "minirtc", 
+    add_deps("rd_log", "common", "assets", "config_center", transport,
         "path_manager", "screen_capturer", "speaker_capturer", 
-        "device_controller", "thumbnail", "version_checker")
+        "audio_playout", "device_controller", "remote_action", "thumbnail",
+        "version_checker", "metrics_server", "host")
     add_files("src/gui/*.cpp", "src/gui/panels/*.cpp", "src/gui/toolbars/*.cpp",
         "src/gui/windows/*.cpp")
     add_includedirs("src/gui", "src/gui/panels", "src/gui/toolbars",
@@ -190,4 +244,36 @@ target("crossdesk")
     set_kind("binary")
     add_deps("rd_log", "common", "gui")
     add_files("src/app/*.cpp")
-    add_includedirs("src/app", {public = true})
\ No newline at end of file
+    add_includedirs("src/app", {public = true})
+
+-- xmake build bench_kernels && xmake run bench_kernels > kernels.json
+target("bench_kernels")
+    set_kind("binary")
+    set_default(false)
+    add_packages("libyuv")
+    add_deps("rd_log", "common", "remote_action", "thumbnail",
+        "screen_capturer", "speaker_capturer", "device_controller")
+    add_files("src/bench/bench_kernels.cpp")
+
+target("server")
+    set_kind("object")
+    add_defines("CROSSDESK_VERSION=\"" .. (get_config("CROSSDESK_VERSION") or "Unknown") .. "\"")
+    add_deps("rd_log", "common", "config_center", transport, "path_manager",
+        "screen_capturer", "speaker_capturer", "device_controller",
+        "remote_action", "metrics_server", "host")
+    add_files("src/server/server.cpp")
+    add_includedirs("src/server", {public = true})
+
+target("crossdesk-server")
+    set_kind("binary")
+    add_deps("rd_log", "common", "server")
+    add_files("src/server/main.cpp")
+
+if has_config("loopback_transport") then
+    -- host plus N in-process viewers, xmake f --loopback_transport=y
+    target("bench_viewers")
+        set_kind("binary")
+        set_default(false)
+        add_deps("rd_log", "common", "server")
+        add_files("src/bench/bench_viewers.cpp")
+end